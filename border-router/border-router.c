@@ -0,0 +1,28 @@
+#include "contiki.h"
+#include "sys/log.h"
+
+#if MAC_CONF_WITH_TSCH
+#include "net/mac/tsch/tsch.h"
+#endif
+
+#define LOG_MODULE "RPL BR"
+#define LOG_LEVEL LOG_LEVEL_INFO
+
+PROCESS(garden_border_router, "Smart Garden Border Router");
+AUTOSTART_PROCESSES(&garden_border_router);
+
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(garden_border_router, ev, data)
+{
+  PROCESS_BEGIN();
+
+#if MAC_CONF_WITH_TSCH
+  // the RPL root is the TSCH time source of the whole network
+  tsch_set_coordinator(1);
+#endif
+
+  LOG_INFO("Smart Garden Border Router started\n");
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -6,6 +6,15 @@
 #include "routing/routing.h"
 #include "coap-engine.h"
 #include "coap-blocking-api.h"
+#include "net/ipv6/uip-ds6.h"
+#include "net/linkaddr.h"
+#include "stamp.h"
+
+#if WITH_OSCORE
+#include "oscore.h"
+#include "oscore-keys.h"
+#include "lib/csprng.h"
+#endif
 
 #include "sys/log.h"
 #define LOG_MODULE "coap device"
@@ -14,6 +23,11 @@
 #define SERVER_EP "coap://[fd00::1]:5683"
 #define START_INTERVAL 1
 #define REGISTRATION_INTERVAL 1
+// the registration is renewed on this period; the backend expires a node that
+// stops answering and takes it back, or at its new address, on the next one
+#ifndef REGISTRATION_REFRESH
+#define REGISTRATION_REFRESH 300
+#endif
 
 // actuator resources
 extern coap_resource_t res_fertilizer;
@@ -32,6 +46,83 @@ void cc_heater_resource_init(void);
 // service URL
 static char *service_url = "/registration";
 
+// garden zone of this node (make ZONE=n), for the group commands
+#ifndef COAP_DEVICE_ZONE
+#define COAP_DEVICE_ZONE 1
+#endif
+
+/*
+ * Group commands: a PUT to ff05::5347:<zone>:<type> reaches every node with that
+ * actuator type in the zone, zone 0 is the whole garden. Types follow the order
+ * of the registration payload (CoapGroupCommander.TYPES on the backend).
+ */
+#define GROUP_PREFIX 0x5347
+#define ALL_ZONES    0
+#define GROUP_TYPES  5
+
+static void
+join_groups(void)
+{
+  uip_ipaddr_t group;
+  uint16_t type;
+
+  for(type = 1; type <= GROUP_TYPES; type++) {
+    uip_ip6addr(&group, 0xff05, 0, 0, 0, 0, GROUP_PREFIX, COAP_DEVICE_ZONE, type);
+    if(uip_ds6_maddr_add(&group) == NULL) LOG_WARN("Cannot join zone group %u\n", type);
+    uip_ip6addr(&group, 0xff05, 0, 0, 0, 0, GROUP_PREFIX, ALL_ZONES, type);
+    if(uip_ds6_maddr_add(&group) == NULL) LOG_WARN("Cannot join garden group %u\n", type);
+  }
+  LOG_INFO("Joined the actuator groups of zone %u\n", COAP_DEVICE_ZONE);
+}
+
+#if WITH_OSCORE
+// OSCORE id of this node (make OSCORE_ID=n), must be in the backend's list
+#ifndef COAP_DEVICE_OSCORE_ID
+#define COAP_DEVICE_OSCORE_ID 1
+#endif
+
+static oscore_ctx_t oscore_ctx;
+// our id and 8 random bytes, drawn again at every boot
+static uint8_t id_context[1 + 8];
+
+/*
+ * Security context shared with the backend: our id is the Sender ID, the
+ * backend's is OSCORE_CONTROLLER_ID. The sequence numbers restart at 0 on
+ * every boot, so the ID Context is fresh too (RFC 8613 Appendix B.2): the
+ * keys of this boot were never used, and the backend derives them from the
+ * ID Context carried by the registration. The actuator resources only
+ * accept protected requests, and the registration is protected too.
+ */
+static void
+oscore_setup(coap_endpoint_t *server_ep)
+{
+  static const uint8_t master_secret[] = OSCORE_MASTER_SECRET;
+  static const uint8_t master_salt[] = OSCORE_MASTER_SALT;
+  static const uint8_t sender_id[] = { COAP_DEVICE_OSCORE_ID };
+  static const uint8_t recipient_id[] = { OSCORE_CONTROLLER_ID };
+
+  id_context[0] = COAP_DEVICE_OSCORE_ID;
+  if(!csprng_rand(&id_context[1], sizeof(id_context) - 1)) {
+    // the backend refuses an ID Context it has seen before
+    LOG_ERR("No entropy for the OSCORE ID Context\n");
+  }
+
+  oscore_init();
+  oscore_derive_ctx(&oscore_ctx, master_secret, sizeof(master_secret),
+                    master_salt, sizeof(master_salt), COSE_Algorithm_AES_CCM_16_64_128,
+                    sender_id, sizeof(sender_id), recipient_id, sizeof(recipient_id),
+                    id_context, sizeof(id_context));
+  oscore_ep_ctx_set_association(server_ep, service_url, &oscore_ctx);
+
+  oscore_protect_resource(&res_fertilizer);
+  oscore_protect_resource(&res_irrigation);
+  oscore_protect_resource(&res_grow_light);
+  oscore_protect_resource(&res_cc_fan);
+  oscore_protect_resource(&res_cc_heater);
+  LOG_INFO("OSCORE enabled, node id %u\n", COAP_DEVICE_OSCORE_ID);
+}
+#endif /* WITH_OSCORE */
+
 // state flags
 static bool connected = false;
 static bool registered = false;
@@ -39,6 +130,7 @@ static bool registered = false;
 // timers
 static struct etimer wait_connection;
 static struct etimer wait_registration;
+static struct etimer refresh_registration;
 static struct etimer feedback_led_timer;
 static bool feedback_led_on = false;
 
@@ -57,13 +149,20 @@ void client_chunk_handler(coap_message_t *response)
     etimer_reset(&wait_registration);
     return;
   }
-  coap_get_payload(response, &chunk);
+  int len = coap_get_payload(response, &chunk);
   if(chunk && strncmp((char*)chunk, "Success", 7) == 0) {
-    LOG_INFO("Registration completed!\n");
-    leds_single_off(LEDS_BLUE);
-    leds_set(LEDS_GREEN);
-    etimer_set(&feedback_led_timer, CLOCK_SECOND * 3);
-    feedback_led_on = true;
+    // "Success <epoch ms>": the controller clock, for the timestamps of the notifications
+    if(len > 8) {
+      uint64_t now = stamp_parse_ms((const char *)chunk + 8, len - 8);
+      if(now != 0) stamp_sync(now);
+    }
+    if(!registered) {
+      LOG_INFO("Registration completed!\n");
+      leds_single_off(LEDS_BLUE);
+      leds_set(LEDS_GREEN);
+      etimer_set(&feedback_led_timer, CLOCK_SECOND * 3);
+      feedback_led_on = true;
+    }
     registered = true;
   } else {
     LOG_INFO("Sending a new registration request...\n");
@@ -71,6 +170,19 @@ void client_chunk_handler(coap_message_t *response)
   }
 }
 
+// {"device":"coap-<link address>","zone":n,"resources":[...]}
+static void
+build_registration(char *msg, size_t len)
+{
+  snprintf(msg, len,
+           "{\"device\":\"coap-%02x%02x%02x%02x%02x%02x\",\"zone\":%u,\"resources\":["
+           "\"fertilizer\",\"irrigation\","
+           "\"grow_light\",\"fan\",\"heater\"]}",
+           linkaddr_node_addr.u8[0], linkaddr_node_addr.u8[1],
+           linkaddr_node_addr.u8[2], linkaddr_node_addr.u8[5],
+           linkaddr_node_addr.u8[6], linkaddr_node_addr.u8[7], COAP_DEVICE_ZONE);
+}
+
 PROCESS(coap_device, "CoAP device");
 AUTOSTART_PROCESSES(&coap_device);
 
@@ -78,6 +190,7 @@ PROCESS_THREAD(coap_device, ev, data)
 {
   static coap_endpoint_t server_ep;
   static coap_message_t request[1];
+  static char msg[256];
 
   PROCESS_BEGIN();
   PROCESS_PAUSE();
@@ -104,6 +217,10 @@ PROCESS_THREAD(coap_device, ev, data)
   cc_fan_resource_init();
   cc_heater_resource_init();
 
+#if WITH_OSCORE
+  oscore_setup(&server_ep);
+#endif
+
   LOG_INFO("Connecting to the Border Router...\n");
 
   while(!connected){
@@ -112,6 +229,7 @@ PROCESS_THREAD(coap_device, ev, data)
       LOG_INFO("Connected to the Border Router!\n");
       connected = true;
       leds_single_off(LEDS_BLUE);
+      join_groups();
     } else {
       etimer_reset(&wait_connection);
     }
@@ -126,12 +244,10 @@ PROCESS_THREAD(coap_device, ev, data)
 
     coap_init_message(request, COAP_TYPE_CON, COAP_POST, 0);
     coap_set_header_uri_path(request, service_url);
-
-    static char msg[256];
-    snprintf(msg, sizeof(msg),
-     "{\"device\":\"coapDevice\",\"resources\":["
-     "\"fertilizer\",\"irrigation\","
-     "\"grow_light\",\"fan\",\"heater\"]}");
+#if WITH_OSCORE
+    coap_set_oscore(request);
+#endif
+    build_registration(msg, sizeof(msg));
 
     LOG_INFO("Sending registration payload: %s\n", msg);
 
@@ -140,6 +256,7 @@ PROCESS_THREAD(coap_device, ev, data)
   }
 
   LOG_INFO("Device started correctly!\n");
+  etimer_set(&refresh_registration, CLOCK_SECOND * REGISTRATION_REFRESH);
 
   // Initialize button
   btn = button_hal_get_by_index(0);
@@ -147,6 +264,19 @@ PROCESS_THREAD(coap_device, ev, data)
   while(1) {
     PROCESS_WAIT_EVENT();
     
+    if(ev == PROCESS_EVENT_TIMER && data == &refresh_registration) {
+      coap_init_message(request, COAP_TYPE_CON, COAP_POST, 0);
+      coap_set_header_uri_path(request, service_url);
+#if WITH_OSCORE
+      coap_set_oscore(request);
+#endif
+      build_registration(msg, sizeof(msg));
+      coap_set_payload(request, (uint8_t *)msg, strlen(msg));
+      COAP_BLOCKING_REQUEST(&server_ep, request, client_chunk_handler);
+      etimer_reset(&refresh_registration);
+      continue;
+    }
+
 	  // auto-turn off feedback LEDs when the timer fires (for blinking)
 	  if (ev == PROCESS_EVENT_TIMER && data == &feedback_led_timer && feedback_led_on) {
 	    leds_off(LEDS_GREEN | LEDS_RED | LEDS_BLUE);
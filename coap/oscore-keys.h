@@ -0,0 +1,19 @@
+#ifndef OSCORE_KEYS_H_
+#define OSCORE_KEYS_H_
+
+/*
+ * Pre-provisioned OSCORE material, shared by every CoAP node and the backend
+ * ("oscore" section of devices.json, see OscoreContexts). These are the
+ * RFC 8613 test vectors: replace them for a real deployment.
+ */
+#define OSCORE_MASTER_SECRET { \
+  0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, \
+  0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f, 0x10 }
+
+#define OSCORE_MASTER_SALT { \
+  0x9e, 0x7c, 0xa9, 0x22, 0x23, 0x78, 0x63, 0x40 }
+
+/* Sender ID of the backend towards every node */
+#define OSCORE_CONTROLLER_ID 0x00
+
+#endif /* OSCORE_KEYS_H_ */
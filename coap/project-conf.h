@@ -18,4 +18,15 @@
 
 #define LOG_LEVEL_APP LOG_LEVEL_DBG
 
+/* each of the five resources is observed by the instance owning it; the rest
+ * leaves room for the relations of an instance that left without cancelling */
+#undef COAP_MAX_OBSERVERS
+#define COAP_MAX_OBSERVERS 10
+
+/* 5 actuator groups for the zone and 5 for the whole garden, plus the defaults */
+#undef UIP_CONF_DS6_MADDR_NBU
+#define UIP_CONF_DS6_MADDR_NBU 12
+
+#include "profile-conf.h"
+
 #endif /* PROJECT_CONF_H_ */
@@ -2,6 +2,7 @@
 #include "coap-engine.h"
 #include "os/dev/leds.h"
 #include "sys/log.h"
+#include "stamp.h"
 #include <string.h>
 #include <strings.h>
 #include <stdbool.h> 
@@ -26,6 +27,7 @@ enum FertilizerMode {
 };
 
 static enum FertilizerMode current_mode = MODE_OFF;
+static stamp_version_t version = STAMP_VERSION_INIT;
 
 static void res_get_handler(coap_message_t *request,
                             coap_message_t *response,
@@ -62,9 +64,12 @@ res_get_handler(coap_message_t *request,
     (current_mode == MODE_ACIDIC)   ? "acidic" :
     (current_mode == MODE_ALKALINE) ? "alkaline" : "off";
 
+  char stamp[48];
+  stamp_format(stamp, sizeof(stamp), stamp_version(&version, current_mode));
+
   coap_set_header_content_format(response, APPLICATION_JSON);
   size_t len = snprintf((char *)buffer, COAP_MAX_CHUNK_SIZE,
-                        "{\"mode\":\"%s\"}", mode_str);
+                        "{\"mode\":\"%s\",%s}", mode_str, stamp);
   coap_set_payload(response, buffer, len);
 }
 
@@ -2,6 +2,7 @@
 #include "coap-engine.h"
 #include "os/dev/leds.h"
 #include "sys/log.h"
+#include "stamp.h"
 #include <string.h>
 #include <strings.h>
 
@@ -13,6 +14,7 @@ static enum {
   MODE_OFF,
   MODE_ON
 } current_mode = MODE_OFF;
+static stamp_version_t version = STAMP_VERSION_INIT;
 
 /* Forward declarations */
 static void res_get_handler(coap_message_t *request,
@@ -50,9 +52,12 @@ res_get_handler(coap_message_t *request,
 {
   const char *mode_str = (current_mode == MODE_ON) ? "on" : "off";
 
+  char stamp[48];
+  stamp_format(stamp, sizeof(stamp), stamp_version(&version, current_mode));
+
   coap_set_header_content_format(response, APPLICATION_JSON);
   size_t len = snprintf((char *)buffer, COAP_MAX_CHUNK_SIZE,
-                        "{\"mode\":\"%s\"}", mode_str);
+                        "{\"mode\":\"%s\",%s}", mode_str, stamp);
   coap_set_payload(response, buffer, len);
 }
 
@@ -2,6 +2,7 @@
 #include "coap-engine.h"
 #include "os/dev/leds.h"
 #include "sys/log.h"
+#include "stamp.h"
 #include <string.h>
 #include <strings.h>
 
@@ -12,6 +13,7 @@ static enum {
   IRRIGATION_OFF,
   IRRIGATION_ON,
 } irrigation_mode = IRRIGATION_OFF;
+static stamp_version_t version = STAMP_VERSION_INIT;
 
 
 static void res_get_handler(coap_message_t *request,
@@ -50,9 +52,12 @@ res_get_handler(coap_message_t *request,
   const char *mode_str =
      (irrigation_mode == IRRIGATION_ON) ? "on" : "off";
 
+  char stamp[48];
+  stamp_format(stamp, sizeof(stamp), stamp_version(&version, irrigation_mode));
+
   coap_set_header_content_format(response, APPLICATION_JSON);
   size_t len = snprintf((char *)buffer, COAP_MAX_CHUNK_SIZE,
-                        "{\"mode\":\"%s\"}", mode_str);
+                        "{\"mode\":\"%s\",%s}", mode_str, stamp);
   coap_set_payload(response, buffer, len);
 }
 
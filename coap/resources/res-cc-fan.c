@@ -1,6 +1,7 @@
 #include "coap-engine.h"
 #include "os/dev/leds.h"
 #include "sys/log.h"
+#include "stamp.h"
 #include <string.h>
 #include <strings.h>
 
@@ -10,6 +11,7 @@
 int fan_on = 0;
 extern int heater_on;
 extern coap_resource_t res_cc_heater;
+static stamp_version_t version = STAMP_VERSION_INIT;
 
 /* Forward declarations */
 static void res_get_handler(coap_message_t *request, coap_message_t *response,
@@ -38,9 +40,12 @@ res_get_handler(coap_message_t *request, coap_message_t *response,
 {
   const char *mode_str = fan_on ? "on" : "off";
 
+  char stamp[48];
+  stamp_format(stamp, sizeof(stamp), stamp_version(&version, fan_on));
+
   coap_set_header_content_format(response, APPLICATION_JSON);
   size_t len = snprintf((char *)buffer, COAP_MAX_CHUNK_SIZE,
-                        "{\"mode\":\"%s\"}", mode_str);
+                        "{\"mode\":\"%s\",%s}", mode_str, stamp);
   coap_set_payload(response, buffer, len);
 }
 
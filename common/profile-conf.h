@@ -0,0 +1,61 @@
+/*---------------------------------------------------------------------------*/
+#ifndef PROFILE_CONF_H_
+#define PROFILE_CONF_H_
+/*---------------------------------------------------------------------------*/
+/* Network stack settings for the profiles in Makefile.profiles, included by
+ * every project-conf.h so that all the nodes agree on the schedule. */
+
+#if MAC_CONF_WITH_TSCH
+
+/* 4 channels: faster association, and what the Cooja scenarios assume */
+#define TSCH_CONF_DEFAULT_HOPPING_SEQUENCE TSCH_HOPPING_SEQUENCE_4_4
+#define TSCH_CONF_AUTOSELECT_TIME_SOURCE 1
+
+/* a MQTT publish is fragmented into 2-3 frames, CoAP bursts on registration */
+#undef QUEUEBUF_CONF_NUM
+#define QUEUEBUF_CONF_NUM 16
+#define TSCH_QUEUE_CONF_NUM_PER_NEIGHBOR 8
+
+#if WITH_ORCHESTRA
+#define TSCH_SCHEDULE_CONF_WITH_6TISCH_MINIMAL 0
+#define TSCH_CONF_WITH_LINK_SELECTOR 1
+#define TSCH_CALLBACK_NEW_TIME_SOURCE orchestra_callback_new_time_source
+#define TSCH_CALLBACK_PACKET_READY orchestra_callback_packet_ready
+#define NETSTACK_CONF_ROUTING_NEIGHBOR_ADDED_CALLBACK orchestra_callback_child_added
+#define NETSTACK_CONF_ROUTING_NEIGHBOR_REMOVED_CALLBACK orchestra_callback_child_removed
+
+/*
+ * A node publishes a sample every 4 s (SHORT_PUBLISH_INTERVAL), i.e. 0.25 frames/s
+ * plus fragments. Sender-based unicast gives each node its own transmit slot
+ * towards its parent, so the samples of siblings do not contend at the root.
+ * 11 slots x 10 ms bound the wait at each hop to 110 ms and still carry
+ * ~9 frames/s per node, enough for a 20-node subtree behind one relay.
+ */
+#define ORCHESTRA_CONF_UNICAST_SENDER_BASED 1
+#define ORCHESTRA_CONF_UNICAST_PERIOD 11
+/* EBs and RPL broadcast are rare: keep their slotframes long */
+#define ORCHESTRA_CONF_EBSF_PERIOD 397
+#define ORCHESTRA_CONF_COMMON_SHARED_PERIOD 31
+
+#else /* WITH_ORCHESTRA */
+
+/* 6TiSCH minimal: one shared slot every 3 slots (30 ms), for every frame */
+#define TSCH_SCHEDULE_CONF_DEFAULT_LENGTH 3
+
+#endif /* WITH_ORCHESTRA */
+
+#endif /* MAC_CONF_WITH_TSCH */
+
+#if WITH_ENERGEST
+#define ENERGEST_CONF_ON 1
+#define SIMPLE_ENERGEST_CONF_PERIOD (60 * CLOCK_SECOND)
+#endif
+
+#if WITH_MULTICAST
+/* SMRF forwards ff05:: downwards along the RPL storing-mode DODAG */
+#define UIP_MCAST6_CONF_ENGINE UIP_MCAST6_ENGINE_SMRF
+#define RPL_CONF_MOP RPL_MOP_STORING_MULTICAST
+#endif
+
+#endif /* PROFILE_CONF_H_ */
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,58 @@
+#include "contiki.h"
+#include "stamp.h"
+
+#include <stdio.h>
+
+static bool synced = false;
+static uint64_t sync_epoch_ms;
+static clock_time_t sync_ticks;
+
+void stamp_sync(uint64_t epoch_ms)
+{
+  sync_epoch_ms = epoch_ms;
+  sync_ticks = clock_time();
+  synced = true;
+}
+
+bool stamp_synced(void)
+{
+  return synced;
+}
+
+uint64_t stamp_now_ms(void)
+{
+  if(!synced) return 0;
+  return sync_epoch_ms + ((uint64_t)(clock_time() - sync_ticks) * 1000) / CLOCK_SECOND;
+}
+
+uint64_t stamp_parse_ms(const char *str, size_t len)
+{
+  uint64_t value = 0;
+  size_t i;
+
+  for(i = 0; i < len && str[i] >= '0' && str[i] <= '9'; i++) {
+    value = value * 10 + (uint64_t)(str[i] - '0');
+  }
+  return i == 0 ? 0 : value;
+}
+
+uint32_t stamp_version(stamp_version_t *version, int state)
+{
+  if(state != version->state) {
+    version->state = state;
+    version->seq++;
+  }
+  return version->seq;
+}
+
+int stamp_format(char *buf, size_t len, uint32_t seq)
+{
+  uint64_t now = stamp_now_ms();
+
+  /* printf of the libc on the dongles has no 64-bit conversions: seconds + ms */
+  if(now == 0) {
+    return snprintf(buf, len, "\"seq\":%lu,\"ts\":0", (unsigned long)seq);
+  }
+  return snprintf(buf, len, "\"seq\":%lu,\"ts\":%lu%03u", (unsigned long)seq,
+                  (unsigned long)(now / 1000), (unsigned)(now % 1000));
+}
@@ -0,0 +1,40 @@
+#ifndef STAMP_H_
+#define STAMP_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/*
+ * Sequence number and wall-clock timestamp added to every sensor publish and
+ * CoAP representation, one sequence per stream, so the backend can measure latency, loss
+ * and reordering. The clock is set from the backend time (ms since the epoch)
+ * and runs on clock_time() in between; until then "ts" is 0.
+ */
+
+void stamp_sync(uint64_t epoch_ms);
+bool stamp_synced(void);
+uint64_t stamp_now_ms(void);
+
+/* parses a decimal epoch in ms (not NUL terminated), 0 if invalid */
+uint64_t stamp_parse_ms(const char *str, size_t len);
+
+/*
+ * Sequence number of a CoAP representation. It advances only when the state
+ * changes, so every observer and every GET sees the same number for the same
+ * state and a gap means a missed notification.
+ */
+typedef struct {
+  uint32_t seq;
+  int state;
+} stamp_version_t;
+
+#define STAMP_VERSION_INIT { 0, -1 }
+
+/* sequence number of the representation of state */
+uint32_t stamp_version(stamp_version_t *version, int state);
+
+/* writes "seq":<seq>,"ts":<ms>, returns snprintf's result */
+int stamp_format(char *buf, size_t len, uint32_t seq);
+
+#endif /* STAMP_H_ */
@@ -0,0 +1,46 @@
+/*
+ * Collects the simple-energest summaries (MAKE_WITH_ENERGEST=1) of every node
+ * and prints the radio duty cycle distribution at the end of the run. The first
+ * 5 minutes (RPL/TSCH join, registration) are left out.
+ * Latency comes from the backend: smartgarden_delivery_latency_seconds.
+ */
+TIMEOUT(2100000, summary(); log.testOK());   /* 35 simulated minutes */
+
+var WARMUP_MS = 300000;
+var radioOn = {};    /* mote id -> radio on time after warm-up (energest ticks) */
+var total = {};      /* mote id -> elapsed time after warm-up (energest ticks) */
+
+function percentile(sorted, p) {
+  if (sorted.length == 0) return 0;
+  var i = Math.min(sorted.length - 1, Math.floor(p / 100 * sorted.length));
+  return sorted[i];
+}
+
+function summary() {
+  var cycles = [];
+  for (var id in total) {
+    if (id == 1 || total[id] == 0) continue;   /* the border router is always on */
+    cycles.push(100 * radioOn[id] / total[id]);
+  }
+  cycles.sort(function(a, b) { return a - b; });
+
+  var sum = 0;
+  for (var i = 0; i < cycles.length; i++) sum += cycles[i];
+
+  log.log("RESULT nodes=" + cycles.length
+      + " radio_duty_cycle_mean=" + (cycles.length ? (sum / cycles.length).toFixed(2) : 0) + "%"
+      + " p50=" + percentile(cycles, 50).toFixed(2) + "%"
+      + " p95=" + percentile(cycles, 95).toFixed(2) + "%"
+      + " max=" + percentile(cycles, 100).toFixed(2) + "%\n");
+}
+
+while (true) {
+  YIELD();
+  if (sim.getSimulationTimeMillis() < WARMUP_MS) continue;
+
+  var m = msg.match(/Radio total\s*:\s*(\d+)\/\s*(\d+)/);
+  if (m) {
+    radioOn[id] = (radioOn[id] || 0) + parseInt(m[1]);
+    total[id] = (total[id] || 0) + parseInt(m[2]);
+  }
+}
@@ -1,6 +1,11 @@
 #include "contiki.h"
 #include "net/routing/routing.h"
+#if MQTT_SN
+#include "mqtt-sn-client.h"
+#include "net/ipv6/uiplib.h"
+#else
 #include "mqtt.h"
+#endif
 #include "net/ipv6/uip.h"
 #include "net/ipv6/uip-icmp6.h"
 #include "net/ipv6/sicslowpan.h"
@@ -10,6 +15,9 @@
 #include "dev/etc/rgb-led/rgb-led.h"
 #include "os/sys/log.h"
 #include "mqtt-client.h"
+#include "stamp.h"
+#include "sensor-filter.h"
+#include "publish-queue.h"
 
 #include <string.h>
 #include <strings.h>
@@ -35,7 +43,7 @@
 #define LOG_LEVEL LOG_LEVEL_DBG
 #endif
 
-/* MQTT broker address. */
+/* MQTT broker address (the MQTT-SN gateway when built with MAKE_WITH_MQTT_SN=1). */
 #define MQTT_CLIENT_BROKER_IP_ADDR "fd00::1"
 
 static const char *broker_ip = MQTT_CLIENT_BROKER_IP_ADDR;
@@ -69,19 +77,43 @@ static char sub_topic_light[BUFFER_SIZE];
 static char sub_topic_moisture[BUFFER_SIZE];
 static char sub_topic_ph[BUFFER_SIZE];
 static char sub_topic_temp[BUFFER_SIZE];
+static char sub_topic_rate[BUFFER_SIZE];
 
 /* Periodic timer to check the state of the MQTT client */
 #define STATE_MACHINE_PERIODIC     (CLOCK_SECOND >> 1)
 static struct etimer periodic_timer;
 
-#define APP_BUFFER_SIZE 512
+// while samples are queued, how often the queue is drained
+#define DRAIN_INTERVAL (CLOCK_SECOND >> 3)
+static struct etimer drain_timer;
 
+#if !MQTT_SN
 static struct mqtt_message *msg_ptr = 0;
 
 static struct mqtt_connection conn;
+#endif
 
-static char app_buffer[APP_BUFFER_SIZE];
+static publish_queue_t publish_queue;
 static char pub_topic[BUFFER_SIZE];
+static char value_buffer[16];
+
+// backend wall clock (ms since the epoch), used to timestamp the samples
+#define TIME_TOPIC "smartgarden/time"
+
+// per-node control topic RATE_TOPIC/<client_id>, {"<sensor>":<seconds>,...}:
+// how often the backend wants each sensor reported
+#define RATE_TOPIC "smartgarden/rate"
+// the probes are read every tick, the model of a sensor steps once per
+// round-robin cycle (4 sensors x SHORT_PUBLISH_INTERVAL); a sensor reported
+// faster than the cycle is checked every tick instead of on its turn only
+#define READ_PERIOD_S         (SHORT_PUBLISH_INTERVAL / CLOCK_SECOND)
+#define CYCLE_S               (4 * READ_PERIOD_S)
+#define MAX_REPORT_INTERVAL_S 600
+
+// indexed by turn - 1
+static const char *sensor_names[] = { "temperature", "pH", "light", "soilMoisture" };
+static uint16_t report_interval[] = { CYCLE_S, CYCLE_S, CYCLE_S, CYCLE_S };
+static clock_time_t last_report[4];
 
 // Actuator simulation variables
 static int grow_light_state = 0; // 0=OFF, 1=ON
@@ -101,6 +133,43 @@ static int sim_pH = 675;            // pH 6.75
 static int sim_light = 500;         // 50.0%
 static int sim_moisture = 400;      // 40.0%
 
+/*
+ * Probe reads: every tick each sensor is read SENSOR_OVERSAMPLE times, i.e.
+ * 4 x SENSOR_OVERSAMPLE readings between two reports of a sensor, and its filter
+ * smooths them. Filters per sensor as { method, window, ema_shift, outlier_limit },
+ * see sensor-filter.h; override them in project-conf.h.
+ */
+#ifndef SENSOR_OVERSAMPLE
+#define SENSOR_OVERSAMPLE 1
+#endif
+#ifndef SENSOR_FILTER_CONF_TEMPERATURE
+#define SENSOR_FILTER_CONF_TEMPERATURE { FILTER_MEDIAN, 5, 0, 15 }  // 1.5°C
+#endif
+#ifndef SENSOR_FILTER_CONF_PH
+#define SENSOR_FILTER_CONF_PH { FILTER_EMA, 5, 2, 25 }              // 0.25
+#endif
+#ifndef SENSOR_FILTER_CONF_LIGHT
+#define SENSOR_FILTER_CONF_LIGHT { FILTER_MEDIAN, 3, 0, 0 }         // grow_light jumps are real
+#endif
+#ifndef SENSOR_FILTER_CONF_MOISTURE
+#define SENSOR_FILTER_CONF_MOISTURE { FILTER_MEDIAN, 5, 0, 0 }      // rain showers are real
+#endif
+// also publish the last raw reading as "raw" (make PUBLISH_RAW=1)
+#ifndef MQTT_DEVICE_CONF_PUBLISH_RAW
+#define MQTT_DEVICE_CONF_PUBLISH_RAW 0
+#endif
+
+// indexed by turn - 1, like sensor_names
+static const filter_config_t filter_configs[] = {
+  SENSOR_FILTER_CONF_TEMPERATURE, SENSOR_FILTER_CONF_PH,
+  SENSOR_FILTER_CONF_LIGHT, SENSOR_FILTER_CONF_MOISTURE
+};
+static int *const sim_values[] = { &sim_temperature, &sim_pH, &sim_light, &sim_moisture };
+static const uint8_t decimals[] = { 1, 2, 1, 1 };   // temperature x10, pH x100, others x10
+static const int probe_noise[] = { 3, 3, 10, 6 };   // ± per read, in fixed-point units
+static sensor_filter_t filters[4];
+static int raw_values[4];
+
 
 // MQTT subscription state
 static bool grow_light_subscribed = false;
@@ -112,20 +181,114 @@ static bool light_subscribed = false;
 static bool moisture_subscribed = false;
 static bool ph_subscribed = false;
 static bool temp_subscribed = false;
+static bool time_subscribed = false;
+static bool rate_subscribed = false;
+
+/*---------------------------------------------------------------------------*/
+static void
+set_report_intervals(const char *msg)
+{
+  char key[20];
+  int i;
+
+  for(i = 0; i < 4; i++) {
+    snprintf(key, sizeof(key), "\"%s\":", sensor_names[i]);
+    const char *p = strstr(msg, key);
+    if(p == NULL) continue;
+
+    long seconds = strtol(p + strlen(key), NULL, 10);
+    if(seconds < READ_PERIOD_S) seconds = READ_PERIOD_S;
+    if(seconds > MAX_REPORT_INTERVAL_S) seconds = MAX_REPORT_INTERVAL_S;
+    if(report_interval[i] != seconds) {
+      LOG_INFO("Reporting %s every %ld s\n", sensor_names[i], seconds);
+      report_interval[i] = seconds;
+    }
+  }
+}
+
+// the simulated value as a probe reads it: small noise, now and then a spike
+static int
+read_probe(int sensor)
+{
+  int noise = probe_noise[sensor];
+  int value = *sim_values[sensor] + (rand() % (2 * noise + 1)) - noise;
+
+  if(rand() % 40 == 0) {
+    value += (rand() % 2 ? 8 : -8) * noise;
+  }
+  return value;
+}
+
+static void
+sample_sensors(void)
+{
+  int sensor, i;
+
+  for(sensor = 0; sensor < 4; sensor++) {
+    for(i = 0; i < SENSOR_OVERSAMPLE; i++) {
+      raw_values[sensor] = read_probe(sensor);
+      if(!sensor_filter_add(&filters[sensor], raw_values[sensor])) {
+        LOG_DBG("Dropped %s outlier %d\n", sensor_names[sensor], raw_values[sensor]);
+      }
+    }
+  }
+}
+
+// fixed-point value with the given number of decimals, e.g. 675 with 2 -> "6.75"
+static void
+format_fixed(char *buf, size_t len, int value, uint8_t digits)
+{
+  int scale = digits == 2 ? 100 : 10;
+  const char *sign = value < 0 ? "-" : "";
+
+  if(value < 0) value = -value;
+  snprintf(buf, len, "%s%d.%0*d", sign, value / scale, digits, value % scale);
+}
+
+// true if the sensor is checked this tick: on its turn, or every tick when fast
+static bool
+report_checked(int sensor, int stepped)
+{
+  return sensor == stepped || report_interval[sensor] < CYCLE_S;
+}
+
+// true if the sensor just read is due for a report
+static bool
+report_due(int sensor)
+{
+  clock_time_t now = clock_time();
+  clock_time_t check_period = report_interval[sensor] < CYCLE_S ? READ_PERIOD_S : CYCLE_S;
+
+  // half a check period of slack
+  if(last_report[sensor] != 0 &&
+     now - last_report[sensor] + (check_period * CLOCK_SECOND) / 2 <
+     (clock_time_t)report_interval[sensor] * CLOCK_SECOND) {
+    return false;
+  }
+  last_report[sensor] = now;
+  return true;
+}
 
 /*---------------------------------------------------------------------------*/
 // Pub handler for actuators only
 static void pub_handler(const char *topic, uint16_t topic_len,
                         const uint8_t *chunk, uint16_t chunk_len)
 {
-  char msg[32];
+  char msg[96];
   uint16_t n = (chunk_len < sizeof(msg) - 1) ? chunk_len : (sizeof(msg) - 1);
   memcpy(msg, chunk, n);
   msg[n] = '\0';
 
   #define EQI(a,b) (strncasecmp((a),(b), strlen(b)) == 0)
 
-  if(strcmp(topic, "grow_light") == 0) {
+  if(strcmp(topic, TIME_TOPIC) == 0) {
+    uint64_t now = stamp_parse_ms(msg, n);
+    if(now != 0) stamp_sync(now);
+
+  } else if(strncmp(topic, RATE_TOPIC, strlen(RATE_TOPIC)) == 0) {
+    set_report_intervals(msg);
+
+  } else if(strcmp(topic, "grow_light") == 0) {
     if(EQI(msg, "off")) grow_light_state = 0;
     else if(EQI(msg, "on")) grow_light_state = 1;
 
@@ -153,6 +316,30 @@ static void pub_handler(const char *topic, uint16_t topic_len,
 }
 
 
+#if MQTT_SN
+static void
+mqttsn_event(mqttsn_event_t event, uint16_t topic_id, const uint8_t *data, uint16_t len)
+{
+  const char *topic;
+
+  switch(event) {
+  case MQTTSN_EVENT_CONNECTED:
+    LOG_INFO("Application has a MQTT-SN connection\n");
+    state = STATE_CONNECTED;
+    process_poll(&mqtt_device_process);
+    break;
+  case MQTTSN_EVENT_DISCONNECTED:
+    LOG_INFO("MQTT-SN Disconnect\n");
+    state = STATE_DISCONNECTED;
+    process_poll(&mqtt_device_process);
+    break;
+  case MQTTSN_EVENT_PUBLISH:
+    topic = mqttsn_topic_name(topic_id);
+    if(topic != NULL) pub_handler(topic, strlen(topic), data, len);
+    break;
+  }
+}
+#else
 static void
 mqtt_event(struct mqtt_connection *m, mqtt_event_t event, void *data)
 {
@@ -200,6 +387,7 @@ mqtt_event(struct mqtt_connection *m, mqtt_event_t event, void *data)
     break;
   }
 }
+#endif
 
 static bool
 have_connectivity(void)
@@ -211,6 +399,112 @@ have_connectivity(void)
   return true;
 }
 
+/*---------------------------------------------------------------------------*/
+// hands the oldest queued sample to the client once the previous one is written out
+static void
+drain_publish_queue(void)
+{
+  publish_slot_t *slot;
+#if !MQTT_SN
+  mqtt_status_t status;
+
+  if(publish_queue.in_flight) {
+    if(!mqtt_ready(&conn)) goto rearm;   // still going out over TCP
+    publish_queue_pop(&publish_queue);
+  }
+#endif
+  slot = publish_queue_head(&publish_queue);
+  if(slot == NULL) return;
+
+#if MQTT_SN
+  // copied into the datagram right away
+  mqttsn_publish(mqttsn_topic_id(slot->topic), slot->payload, slot->len);
+  LOG_INFO("Published: %s → %s\n", slot->topic, slot->payload);
+  publish_queue_pop(&publish_queue);
+#else
+  status = mqtt_publish(&conn, NULL, slot->topic, (uint8_t *)slot->payload, slot->len,
+                        MQTT_QOS_LEVEL_0, MQTT_RETAIN_OFF);
+  if(status == MQTT_STATUS_OK) {
+    publish_queue.in_flight = true;
+    LOG_INFO("Published: %s → %s\n", slot->topic, slot->payload);
+  } else if(status == MQTT_STATUS_OUT_QUEUE_FULL) {
+    publish_queue.retries++;
+  } else {
+    LOG_WARN("Publish on %s refused (%d), will retry\n", slot->topic, status);
+  }
+rearm:
+#endif
+  if(!publish_queue_empty(&publish_queue)) etimer_set(&drain_timer, DRAIN_INTERVAL);
+}
+
+// queues {"<pub_topic>":<value>[,"raw":<raw>],"dev":"<client_id>","seq":n,"ts":ms}
+static void
+publish_sample(const char *value, const char *raw)
+{
+  static uint32_t seq = 0;
+  char stamp[48];
+  char raw_field[24] = "";
+  bool dropped;
+  publish_slot_t *slot = publish_queue_push(&publish_queue, &dropped);
+
+  if(dropped) {
+    LOG_WARN("Publish queue full, dropped the oldest sample (%u so far)\n", publish_queue.dropped);
+  }
+  if(raw != NULL) snprintf(raw_field, sizeof(raw_field), ",\"raw\":%s", raw);
+  stamp_format(stamp, sizeof(stamp), ++seq);
+  snprintf(slot->topic, PUBLISH_QUEUE_TOPIC_SIZE, "%s", pub_topic);
+  snprintf(slot->payload, PUBLISH_QUEUE_PAYLOAD_SIZE, "{\"%s\":%s%s,\"dev\":\"%s\",%s}",
+           pub_topic, value, raw_field, client_id, stamp);
+  slot->len = strlen(slot->payload);
+  drain_publish_queue();
+}
+
+// filtered value of the sensor if due, with the last raw reading if enabled
+static void
+report_sensor(int sensor)
+{
+  char raw[16];
+
+  if(!sensor_filter_ready(&filters[sensor]) || !report_due(sensor)) return;
+
+  snprintf(pub_topic, BUFFER_SIZE, "%s", sensor_names[sensor]);
+  format_fixed(value_buffer, sizeof(value_buffer), sensor_filter_value(&filters[sensor]), decimals[sensor]);
+  format_fixed(raw, sizeof(raw), raw_values[sensor], decimals[sensor]);
+  publish_sample(value_buffer, MQTT_DEVICE_CONF_PUBLISH_RAW ? raw : NULL);
+}
+
+/*---------------------------------------------------------------------------*/
+// true once the request is queued (TCP) or sent and waiting for its SUBACK (MQTT-SN)
+static bool
+subscribe_topic(char *topic)
+{
+#if MQTT_SN
+  return mqttsn_subscribe(mqttsn_topic_id(topic));
+#else
+  return mqtt_subscribe(&conn, NULL, topic, MQTT_QOS_LEVEL_0) != MQTT_STATUS_OUT_QUEUE_FULL;
+#endif
+}
+
+// no subscription left waiting for its SUBACK
+static bool
+subscriptions_settled(void)
+{
+#if MQTT_SN
+  return mqttsn_idle();
+#else
+  return true;
+#endif
+}
+
+static void
+reset_subscriptions(void)
+{
+  grow_light_subscribed = irrigation_subscribed = fertilizer_subscribed = false;
+  fan_subscribed = heater_subscribed = light_subscribed = false;
+  moisture_subscribed = ph_subscribed = temp_subscribed = time_subscribed = false;
+  rate_subscribed = false;
+}
+
 /*---------------------------------------------------------------------------*/
 // Round-robin turn: 1=temperature, 2=pH, 3=light, 4=moisture
 static int turn = 1;
@@ -221,8 +515,11 @@ PROCESS_THREAD(mqtt_device_process, ev, data){
 
   PROCESS_BEGIN();
   
-  mqtt_status_t status;
+#if MQTT_SN
+  uip_ipaddr_t gateway_address;
+#else
   char broker_address[CONFIG_IP_ADDR_STR_LEN];
+#endif
 
   LOG_INFO("MQTT device process initialization...\n");
 
@@ -231,9 +528,20 @@ PROCESS_THREAD(mqtt_device_process, ev, data){
                      linkaddr_node_addr.u8[0], linkaddr_node_addr.u8[1],
                      linkaddr_node_addr.u8[2], linkaddr_node_addr.u8[5],
                      linkaddr_node_addr.u8[6], linkaddr_node_addr.u8[7]);
+  snprintf(sub_topic_rate, BUFFER_SIZE, RATE_TOPIC "/%s", client_id);
+
+  for(int i = 0; i < 4; i++) {
+    sensor_filter_init(&filters[i], &filter_configs[i]);
+  }
+  publish_queue_init(&publish_queue);
 
+#if MQTT_SN
+  uiplib_ipaddrconv(broker_ip, &gateway_address);
+  mqttsn_init(&mqtt_device_process, &gateway_address, MQTTSN_DEFAULT_PORT, mqttsn_event);
+#else
   // broker registration					 
   mqtt_register(&conn, &mqtt_device_process, client_id, mqtt_event, MAX_TCP_SEGMENT_SIZE);
+#endif
                   
   state=STATE_INIT;
                     
@@ -244,7 +552,17 @@ PROCESS_THREAD(mqtt_device_process, ev, data){
 
     PROCESS_YIELD();
 
+    if(ev == PROCESS_EVENT_TIMER && data == &drain_timer) {
+      if(state == STATE_SUBSCRIBED) drain_publish_queue();
+      continue;
+    }
+
     if((ev == PROCESS_EVENT_TIMER && data == &periodic_timer) || ev == PROCESS_EVENT_POLL){
+
+#if MQTT_SN
+          // CONNECT/SUBSCRIBE retransmissions and keep-alive
+          mqttsn_periodic();
+#endif
                             
           if(state==STATE_INIT){
              if(have_connectivity()==true)  
@@ -253,66 +571,92 @@ PROCESS_THREAD(mqtt_device_process, ev, data){
           
           if(state == STATE_NET_OK){
 
+#if MQTT_SN
+              LOG_INFO("Connecting to the MQTT-SN gateway!\n");
+              mqttsn_connect(client_id, (DEFAULT_PUBLISH_INTERVAL * 3) / CLOCK_SECOND);
+#else
               // Connect to MQTT server
               LOG_INFO("Connecting to the MQTT server!\n");
               
-              memcpy(broker_address, broker_ip, strlen(broker_ip));
+              memcpy(broker_address, broker_ip, strlen(broker_ip) + 1);
               
               mqtt_connect(&conn, broker_address, DEFAULT_BROKER_PORT,
                            (DEFAULT_PUBLISH_INTERVAL * 3) / CLOCK_SECOND,
                            MQTT_CLEAN_SESSION_ON);
+#endif
               state = STATE_CONNECTING;
           }
           
           if(state==STATE_CONNECTED){
               if(!grow_light_subscribed){
                   strcpy(sub_topic,"grow_light");
-                  status = mqtt_subscribe(&conn, NULL, sub_topic, MQTT_QOS_LEVEL_0);
-                  LOG_INFO("Subscribing to topic grow_light\n");
-                  if(status != MQTT_STATUS_OUT_QUEUE_FULL) grow_light_subscribed = true;
+                  if(subscribe_topic(sub_topic)) {
+                    LOG_INFO("Subscribing to topic grow_light\n");
+                    grow_light_subscribed = true;
+                  }
               }else if(!irrigation_subscribed){
                   strcpy(sub_topic,"irrigation");
-                  status = mqtt_subscribe(&conn, NULL, sub_topic, MQTT_QOS_LEVEL_0);
-                  LOG_INFO("Subscribing to topic irrigation\n");
-                  if(status != MQTT_STATUS_OUT_QUEUE_FULL) irrigation_subscribed = true;
+                  if(subscribe_topic(sub_topic)) {
+                    LOG_INFO("Subscribing to topic irrigation\n");
+                    irrigation_subscribed = true;
+                  }
               }else if(!fertilizer_subscribed){
                   strcpy(sub_topic,"fertilizer");
-                  status = mqtt_subscribe(&conn, NULL, sub_topic, MQTT_QOS_LEVEL_0);
-                  LOG_INFO("Subscribing to topic fertilizer\n");
-                  if(status != MQTT_STATUS_OUT_QUEUE_FULL) fertilizer_subscribed = true;
+                  if(subscribe_topic(sub_topic)) {
+                    LOG_INFO("Subscribing to topic fertilizer\n");
+                    fertilizer_subscribed = true;
+                  }
               }else if(!fan_subscribed){
                   strcpy(sub_topic,"fan");
-                  status = mqtt_subscribe(&conn, NULL, sub_topic, MQTT_QOS_LEVEL_0);
-                  LOG_INFO("Subscribing to topic fan\n");
-                  if(status != MQTT_STATUS_OUT_QUEUE_FULL) fan_subscribed = true;
+                  if(subscribe_topic(sub_topic)) {
+                    LOG_INFO("Subscribing to topic fan\n");
+                    fan_subscribed = true;
+                  }
               }else if(!heater_subscribed){
                   strcpy(sub_topic,"heater");
-                  status = mqtt_subscribe(&conn, NULL, sub_topic, MQTT_QOS_LEVEL_0);
-                  LOG_INFO("Subscribing to topic heater\n");
-                  if(status != MQTT_STATUS_OUT_QUEUE_FULL) heater_subscribed = true;
+                  if(subscribe_topic(sub_topic)) {
+                    LOG_INFO("Subscribing to topic heater\n");
+                    heater_subscribed = true;
+                  }
               }else if(!light_subscribed){
                   strcpy(sub_topic_light,"light");
-                  status = mqtt_subscribe(&conn, NULL, sub_topic_light, MQTT_QOS_LEVEL_0);
-                  LOG_INFO("Subscribing to topic light (sensor)\n");
-                  if(status != MQTT_STATUS_OUT_QUEUE_FULL) light_subscribed = true;
+                  if(subscribe_topic(sub_topic_light)) {
+                    LOG_INFO("Subscribing to topic light (sensor)\n");
+                    light_subscribed = true;
+                  }
               }else if(!moisture_subscribed){
                   strcpy(sub_topic_moisture,"soilMoisture");
-                  status = mqtt_subscribe(&conn, NULL, sub_topic_moisture, MQTT_QOS_LEVEL_0);
-                  LOG_INFO("Subscribing to topic soilMoisture (sensor)\n");
-                  if(status != MQTT_STATUS_OUT_QUEUE_FULL) moisture_subscribed = true;
+                  if(subscribe_topic(sub_topic_moisture)) {
+                    LOG_INFO("Subscribing to topic soilMoisture (sensor)\n");
+                    moisture_subscribed = true;
+                  }
               }else if(!ph_subscribed){
                   strcpy(sub_topic_ph,"pH");
-                  status = mqtt_subscribe(&conn, NULL, sub_topic_ph, MQTT_QOS_LEVEL_0);
-                  LOG_INFO("Subscribing to topic pH (sensor)\n");
-                  if(status != MQTT_STATUS_OUT_QUEUE_FULL) ph_subscribed = true;
+                  if(subscribe_topic(sub_topic_ph)) {
+                    LOG_INFO("Subscribing to topic pH (sensor)\n");
+                    ph_subscribed = true;
+                  }
               }else if(!temp_subscribed){
                   strcpy(sub_topic_temp,"temperature");
-                  status = mqtt_subscribe(&conn, NULL, sub_topic_temp, MQTT_QOS_LEVEL_0);
-                  LOG_INFO("Subscribing to topic temperature (sensor)\n");
-                  if(status != MQTT_STATUS_OUT_QUEUE_FULL) temp_subscribed = true;
+                  if(subscribe_topic(sub_topic_temp)) {
+                    LOG_INFO("Subscribing to topic temperature (sensor)\n");
+                    temp_subscribed = true;
+                  }
+              }else if(!time_subscribed){
+                  strcpy(sub_topic,TIME_TOPIC);
+                  if(subscribe_topic(sub_topic)) {
+                    LOG_INFO("Subscribing to topic " TIME_TOPIC "\n");
+                    time_subscribed = true;
+                  }
+              }else if(!rate_subscribed){
+                  if(subscribe_topic(sub_topic_rate)) {
+                    LOG_INFO("Subscribing to topic %s\n", sub_topic_rate);
+                    rate_subscribed = true;
+                  }
               }else if(grow_light_subscribed && irrigation_subscribed && fertilizer_subscribed &&
                        fan_subscribed && heater_subscribed && light_subscribed && moisture_subscribed &&
-                       ph_subscribed && temp_subscribed){
+                       ph_subscribed && temp_subscribed && time_subscribed && rate_subscribed &&
+                       subscriptions_settled()){
                   LOG_INFO("Successfully subscribed to all topics!\n");
                   state = STATE_SUBSCRIBED;
                   etimer_set(&periodic_timer, SHORT_PUBLISH_INTERVAL);
@@ -320,9 +664,11 @@ PROCESS_THREAD(mqtt_device_process, ev, data){
           }
 
         if(state == STATE_SUBSCRIBED){
+            // the sensor whose model steps this tick
+            int stepped = turn - 1;
+            int sensor;
             RGB_ON_GREEN();
             if(turn == 1){
-		  sprintf(pub_topic, "temperature");
 
 		  int target_temp = 250;
 
@@ -345,14 +691,9 @@ PROCESS_THREAD(mqtt_device_process, ev, data){
 		  if(sim_temperature < 100) sim_temperature = 100;
 		  if(sim_temperature > 400) sim_temperature = 400;
 
-		  sprintf(app_buffer, "{\"temperature\":%d.%d}", sim_temperature/10, sim_temperature%10);
-		  mqtt_publish(&conn, NULL, pub_topic, (uint8_t *)app_buffer, strlen(app_buffer), MQTT_QOS_LEVEL_0, MQTT_RETAIN_OFF);
-		  LOG_INFO("Published: %s → %s\n", pub_topic, app_buffer);
-
 		  turn = 2;
 		}
 	 	else if(turn == 2){
-		  sprintf(pub_topic, "pH");
 
 		  // baseline and targets in ×100
 		  int baseline = 675; // ~6.75
@@ -373,13 +714,8 @@ PROCESS_THREAD(mqtt_device_process, ev, data){
 		  if(sim_pH < 400) sim_pH = 400;
 		  if(sim_pH > 900) sim_pH = 900;
 
-		  sprintf(app_buffer, "{\"pH\":%d.%02d}", sim_pH/100, sim_pH%100);
-		  mqtt_publish(&conn, NULL, pub_topic, (uint8_t *)app_buffer, strlen(app_buffer),
-			       MQTT_QOS_LEVEL_0, MQTT_RETAIN_OFF);
-		  LOG_INFO("Published: %s → %s\n", pub_topic, app_buffer);
 		  turn = 3;
 		} else if (turn == 3) {
-			  sprintf(pub_topic, "light");
 
 			  // GROW_LIGHT ON
 			  if (grow_light_state == 1) {
@@ -426,12 +762,8 @@ PROCESS_THREAD(mqtt_device_process, ev, data){
 			    if (sim_light > 1000) sim_light = 1000;      // 100.0%
 			  }
 
-			  sprintf(app_buffer, "{\"light\":%d.%01d}", sim_light/10, sim_light%10);
-			  mqtt_publish(&conn, NULL, pub_topic, (uint8_t *)app_buffer, strlen(app_buffer), MQTT_QOS_LEVEL_0, MQTT_RETAIN_OFF);
-			  LOG_INFO("Published: %s → %s\n", pub_topic, app_buffer);
 			  turn = 4;
 	} else if (turn == 4) {
-		  sprintf(pub_topic, "soilMoisture");
 
 		  if (irrigation_on) {
 		    sim_moisture += 7 + (rand() % 6);          // steady rise: +7..+12
@@ -456,18 +788,22 @@ PROCESS_THREAD(mqtt_device_process, ev, data){
 		  if (sim_moisture < 100) sim_moisture = 100;
 		  if (sim_moisture > 900) sim_moisture = 900;
 
-		  sprintf(app_buffer, "{\"soilMoisture\":%d.%01d}", sim_moisture/10, sim_moisture%10);
-		  mqtt_publish(&conn, NULL, pub_topic, (uint8_t *)app_buffer, strlen(app_buffer),
-			       MQTT_QOS_LEVEL_0, MQTT_RETAIN_OFF);
-		  LOG_INFO("Published: %s → %s\n", pub_topic, app_buffer);
-
 		  turn = 1;
 	}		
 
+            sample_sensors();
+            for(sensor = 0; sensor < 4; sensor++) {
+              if(report_checked(sensor, stepped)) report_sensor(sensor);
+            }
+
             etimer_set(&periodic_timer, SHORT_PUBLISH_INTERVAL);
             RGB_OFF_ALL();
         } else if ( state == STATE_DISCONNECTED ){
            LOG_ERR("Disconnected from MQTT broker\n");	
+           // clean session: the broker forgot our subscriptions
+           reset_subscriptions();
+           // the queued samples wait for the new session; the one in flight is sent again
+           publish_queue.in_flight = false;
            state = STATE_INIT;
         }
         
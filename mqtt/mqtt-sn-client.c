@@ -0,0 +1,272 @@
+#include "contiki.h"
+#include "net/ipv6/simple-udp.h"
+#include "sys/log.h"
+#include "mqtt-sn-client.h"
+
+#include <string.h>
+
+#define LOG_MODULE "mqtt-sn"
+#define LOG_LEVEL LOG_LEVEL_INFO
+
+/* message types (MQTT-SN v1.2, 5.2.2) */
+#define MSG_CONNECT    0x04
+#define MSG_CONNACK    0x05
+#define MSG_PUBLISH    0x0C
+#define MSG_SUBSCRIBE  0x12
+#define MSG_SUBACK     0x13
+#define MSG_PINGREQ    0x16
+#define MSG_PINGRESP   0x17
+#define MSG_DISCONNECT 0x18
+
+/* flags (5.3.4) */
+#define FLAG_CLEAN_SESSION   0x04
+#define FLAG_TOPIC_PREDEF    0x01
+
+#define PROTOCOL_ID 0x01
+#define MAX_PACKET  128
+
+#define RETRY_INTERVAL  (5 * CLOCK_SECOND)
+#define MAX_MISSED_PINGS 3
+
+static const char *topic_names[] = {
+  NULL, "temperature", "pH", "light", "soilMoisture",
+  "grow_light", "irrigation", "fertilizer", "fan", "heater", "smartgarden/time",
+  "smartgarden/rate"
+};
+#define TOPIC_COUNT (sizeof(topic_names) / sizeof(topic_names[0]))
+
+static struct simple_udp_connection udp;
+static uip_ipaddr_t gateway_addr;
+static uint16_t gateway_port;
+static struct process *app_process;
+static mqttsn_callback_t app_callback;
+
+static uint8_t packet[MAX_PACKET];
+static char client_id[24];
+static uint16_t keep_alive;
+static uint16_t next_msg_id = 1;
+
+static bool connecting = false;
+static bool connected = false;
+static clock_time_t last_sent;
+static clock_time_t last_ping;
+static uint8_t missed_pings;
+
+/* SUBSCRIBE waiting for its SUBACK, 0 if none */
+static uint16_t pending_sub_topic;
+static uint16_t pending_sub_msg_id;
+
+/*---------------------------------------------------------------------------*/
+static void
+send_packet(uint8_t len)
+{
+  packet[0] = len;
+  simple_udp_sendto(&udp, packet, len, &gateway_addr);
+  last_sent = clock_time();
+}
+
+static void
+send_connect(void)
+{
+  uint8_t id_len = strlen(client_id);
+  packet[1] = MSG_CONNECT;
+  packet[2] = FLAG_CLEAN_SESSION;
+  packet[3] = PROTOCOL_ID;
+  packet[4] = keep_alive >> 8;
+  packet[5] = keep_alive & 0xff;
+  memcpy(&packet[6], client_id, id_len);
+  send_packet(6 + id_len);
+}
+
+static void
+send_subscribe(void)
+{
+  packet[1] = MSG_SUBSCRIBE;
+  packet[2] = FLAG_TOPIC_PREDEF;
+  packet[3] = pending_sub_msg_id >> 8;
+  packet[4] = pending_sub_msg_id & 0xff;
+  packet[5] = pending_sub_topic >> 8;
+  packet[6] = pending_sub_topic & 0xff;
+  send_packet(7);
+}
+
+static void
+lost_connection(void)
+{
+  connected = false;
+  connecting = false;
+  pending_sub_topic = 0;
+  app_callback(MQTTSN_EVENT_DISCONNECTED, 0, NULL, 0);
+}
+
+/*---------------------------------------------------------------------------*/
+static void
+udp_rx(struct simple_udp_connection *c, const uip_ipaddr_t *sender_addr,
+       uint16_t sender_port, const uip_ipaddr_t *receiver_addr,
+       uint16_t receiver_port, const uint8_t *data, uint16_t datalen)
+{
+  if(datalen < 2 || data[0] > datalen) return;
+  uint8_t len = data[0];
+
+  switch(data[1]) {
+  case MSG_CONNACK:
+    if(len >= 3 && connecting) {
+      connecting = false;
+      if(data[2] == 0) {
+        connected = true;
+        missed_pings = 0;
+        last_ping = clock_time();
+        PROCESS_CONTEXT_BEGIN(app_process);
+        app_callback(MQTTSN_EVENT_CONNECTED, 0, NULL, 0);
+        PROCESS_CONTEXT_END(app_process);
+      } else {
+        LOG_WARN("CONNACK refused (%u)\n", data[2]);
+      }
+    }
+    break;
+
+  case MSG_SUBACK:
+    if(len >= 8 && pending_sub_topic != 0 &&
+       ((data[5] << 8) | data[6]) == pending_sub_msg_id) {
+      if(data[7] != 0) LOG_WARN("SUBACK refused topic %u (%u)\n", pending_sub_topic, data[7]);
+      pending_sub_topic = 0;
+    }
+    break;
+
+  case MSG_PUBLISH:
+    if(len >= 7 && connected) {
+      uint16_t topic_id = (data[3] << 8) | data[4];
+      PROCESS_CONTEXT_BEGIN(app_process);
+      app_callback(MQTTSN_EVENT_PUBLISH, topic_id, &data[7], len - 7);
+      PROCESS_CONTEXT_END(app_process);
+    }
+    break;
+
+  case MSG_PINGRESP:
+    missed_pings = 0;
+    break;
+
+  case MSG_DISCONNECT:
+    if(connected) {
+      PROCESS_CONTEXT_BEGIN(app_process);
+      lost_connection();
+      PROCESS_CONTEXT_END(app_process);
+    }
+    break;
+
+  default:
+    break;
+  }
+}
+
+/*---------------------------------------------------------------------------*/
+void
+mqttsn_init(struct process *app, const uip_ipaddr_t *gateway, uint16_t port,
+            mqttsn_callback_t callback)
+{
+  app_process = app;
+  app_callback = callback;
+  uip_ipaddr_copy(&gateway_addr, gateway);
+  gateway_port = port;
+  simple_udp_register(&udp, port, &gateway_addr, gateway_port, udp_rx);
+}
+
+void
+mqttsn_connect(const char *id, uint16_t keep_alive_s)
+{
+  strncpy(client_id, id, sizeof(client_id) - 1);
+  client_id[sizeof(client_id) - 1] = '\0';
+  keep_alive = keep_alive_s;
+  connected = false;
+  connecting = true;
+  pending_sub_topic = 0;
+  send_connect();
+}
+
+bool
+mqttsn_connected(void)
+{
+  return connected;
+}
+
+bool
+mqttsn_subscribe(uint16_t topic_id)
+{
+  if(!connected || pending_sub_topic != 0) return false;
+  pending_sub_topic = topic_id;
+  pending_sub_msg_id = next_msg_id++;
+  send_subscribe();
+  return true;
+}
+
+bool
+mqttsn_idle(void)
+{
+  return pending_sub_topic == 0;
+}
+
+void
+mqttsn_publish(uint16_t topic_id, const char *data, uint16_t len)
+{
+  if(!connected) return;
+  if(len > MAX_PACKET - 7) len = MAX_PACKET - 7;
+
+  packet[1] = MSG_PUBLISH;
+  packet[2] = FLAG_TOPIC_PREDEF; /* QoS 0, no retain */
+  packet[3] = topic_id >> 8;
+  packet[4] = topic_id & 0xff;
+  packet[5] = 0; /* msg id unused at QoS 0 */
+  packet[6] = 0;
+  memcpy(&packet[7], data, len);
+  send_packet(7 + len);
+}
+
+void
+mqttsn_periodic(void)
+{
+  clock_time_t now = clock_time();
+
+  if(connecting) {
+    if(now - last_sent >= RETRY_INTERVAL) send_connect();
+    return;
+  }
+  if(!connected) return;
+
+  if(pending_sub_topic != 0 && now - last_sent >= RETRY_INTERVAL) {
+    send_subscribe();
+  }
+
+  /* ping at half the keep-alive; the gateway drops us after 1.5 keep-alives */
+  if(now - last_ping >= (clock_time_t)keep_alive * CLOCK_SECOND / 2) {
+    if(missed_pings >= MAX_MISSED_PINGS) {
+      LOG_WARN("Gateway not answering, reconnecting\n");
+      lost_connection();
+      return;
+    }
+    missed_pings++;
+    last_ping = now;
+    packet[1] = MSG_PINGREQ;
+    send_packet(2);
+  }
+}
+
+uint16_t
+mqttsn_topic_id(const char *topic)
+{
+  uint16_t i;
+  for(i = 1; i < TOPIC_COUNT; i++) {
+    if(strcmp(topic, topic_names[i]) == 0) return i;
+  }
+  /* per-node topics share one id */
+  i = strlen(topic_names[MQTTSN_TOPIC_RATE]);
+  if(strncmp(topic, topic_names[MQTTSN_TOPIC_RATE], i) == 0 && topic[i] == '/') {
+    return MQTTSN_TOPIC_RATE;
+  }
+  return 0;
+}
+
+const char *
+mqttsn_topic_name(uint16_t topic_id)
+{
+  return (topic_id > 0 && topic_id < TOPIC_COUNT) ? topic_names[topic_id] : NULL;
+}
@@ -0,0 +1,62 @@
+/*---------------------------------------------------------------------------*/
+#ifndef MQTT_SN_CLIENT_H_
+#define MQTT_SN_CLIENT_H_
+/*---------------------------------------------------------------------------*/
+#include "contiki.h"
+#include "net/ipv6/uip.h"
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Minimal MQTT-SN v1.2 client over UDP: QoS 0 publish and subscribe on
+ * predefined topic ids, CONNECT and keep-alive. Topic names never go over the
+ * air; the gateway maps the ids below to the MQTT topics. Keep the table in
+ * sync with org.unipi.smartgarden.gateway.MqttSnGateway.
+ */
+#define MQTTSN_TOPIC_TEMPERATURE    1
+#define MQTTSN_TOPIC_PH             2
+#define MQTTSN_TOPIC_LIGHT          3
+#define MQTTSN_TOPIC_SOIL_MOISTURE  4
+#define MQTTSN_TOPIC_GROW_LIGHT     5
+#define MQTTSN_TOPIC_IRRIGATION     6
+#define MQTTSN_TOPIC_FERTILIZER     7
+#define MQTTSN_TOPIC_FAN            8
+#define MQTTSN_TOPIC_HEATER         9
+#define MQTTSN_TOPIC_TIME           10
+/* smartgarden/rate/<client id>: the gateway resolves it from the session */
+#define MQTTSN_TOPIC_RATE           11
+
+#define MQTTSN_DEFAULT_PORT 1885
+
+typedef enum {
+  MQTTSN_EVENT_CONNECTED,
+  MQTTSN_EVENT_DISCONNECTED,
+  MQTTSN_EVENT_PUBLISH,
+} mqttsn_event_t;
+
+typedef void (*mqttsn_callback_t)(mqttsn_event_t event, uint16_t topic_id,
+                                  const uint8_t *data, uint16_t len);
+
+/* the callback runs in the context of the process given here */
+void mqttsn_init(struct process *app, const uip_ipaddr_t *gateway, uint16_t port,
+                 mqttsn_callback_t callback);
+
+void mqttsn_connect(const char *client_id, uint16_t keep_alive_s);
+bool mqttsn_connected(void);
+
+/* false while a previous SUBSCRIBE is still waiting for its SUBACK */
+bool mqttsn_subscribe(uint16_t topic_id);
+bool mqttsn_idle(void);
+
+void mqttsn_publish(uint16_t topic_id, const char *data, uint16_t len);
+
+/* call periodically: retransmits CONNECT/SUBSCRIBE and sends keep-alive pings */
+void mqttsn_periodic(void);
+
+/* topic id of a topic name, 0 if unknown */
+uint16_t mqttsn_topic_id(const char *topic);
+const char *mqttsn_topic_name(uint16_t topic_id);
+
+#endif /* MQTT_SN_CLIENT_H_ */
+/*---------------------------------------------------------------------------*/
@@ -3,8 +3,16 @@
 #ifndef PROJECT_CONF_H_
 #define PROJECT_CONF_H_
 /*---------------------------------------------------------------------------*/
-/* Enable TCP */
+#ifndef MQTT_SN
+#define MQTT_SN 0
+#endif
+
+/* Enable TCP (MQTT-SN only needs UDP) */
+#if !MQTT_SN
 #define UIP_CONF_TCP 1
+#endif
+
+#include "profile-conf.h"
 
 //#define LOG_CONF_LEVEL_IPV6                        LOG_LEVEL_DBG
 //#define LOG_CONF_LEVEL_RPL                         LOG_LEVEL_DBG
@@ -0,0 +1,51 @@
+#include "publish-queue.h"
+
+#include <string.h>
+
+#define SLOT(queue, i) (&(queue)->slots[((queue)->head + (i)) % PUBLISH_QUEUE_SLOTS])
+
+/*---------------------------------------------------------------------------*/
+void
+publish_queue_init(publish_queue_t *queue)
+{
+  memset(queue, 0, sizeof(*queue));
+}
+/*---------------------------------------------------------------------------*/
+publish_slot_t *
+publish_queue_push(publish_queue_t *queue, bool *dropped)
+{
+  uint8_t i;
+
+  *dropped = false;
+  if(queue->count == PUBLISH_QUEUE_SLOTS) {
+    if(queue->in_flight) {
+      /* the head is being written out: drop the next one, shifting the rest down */
+      for(i = 1; i < queue->count - 1; i++) {
+        memcpy(SLOT(queue, i), SLOT(queue, i + 1), sizeof(publish_slot_t));
+      }
+    } else {
+      queue->head = (queue->head + 1) % PUBLISH_QUEUE_SLOTS;
+    }
+    queue->count--;
+    queue->dropped++;
+    *dropped = true;
+  }
+  queue->count++;
+  return SLOT(queue, queue->count - 1);
+}
+/*---------------------------------------------------------------------------*/
+publish_slot_t *
+publish_queue_head(publish_queue_t *queue)
+{
+  return queue->count > 0 ? SLOT(queue, 0) : NULL;
+}
+/*---------------------------------------------------------------------------*/
+void
+publish_queue_pop(publish_queue_t *queue)
+{
+  if(queue->count == 0) return;
+  queue->head = (queue->head + 1) % PUBLISH_QUEUE_SLOTS;
+  queue->count--;
+  queue->in_flight = false;
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,63 @@
+/*---------------------------------------------------------------------------*/
+#ifndef PUBLISH_QUEUE_H_
+#define PUBLISH_QUEUE_H_
+/*---------------------------------------------------------------------------*/
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Fixed-slot FIFO of the samples waiting to be published. Every slot owns its
+ * topic and payload: the MQTT client keeps writing the payload to TCP after
+ * mqtt_publish() returns, so the head slot stays untouched while it is in
+ * flight. When all slots are taken, the oldest sample not in flight is dropped
+ * to make room for the new one, and counted.
+ */
+#ifdef PUBLISH_QUEUE_CONF_SLOTS
+#define PUBLISH_QUEUE_SLOTS PUBLISH_QUEUE_CONF_SLOTS
+#else
+#define PUBLISH_QUEUE_SLOTS 4
+#endif
+#define PUBLISH_QUEUE_TOPIC_SIZE   16
+#define PUBLISH_QUEUE_PAYLOAD_SIZE 128
+
+#if PUBLISH_QUEUE_SLOTS < 2
+#error "PUBLISH_QUEUE_SLOTS: one slot can be in flight, at least one more is needed"
+#endif
+
+typedef struct {
+  char topic[PUBLISH_QUEUE_TOPIC_SIZE];
+  char payload[PUBLISH_QUEUE_PAYLOAD_SIZE];
+  uint16_t len;
+} publish_slot_t;
+
+typedef struct {
+  publish_slot_t slots[PUBLISH_QUEUE_SLOTS];
+  uint8_t head;            /* oldest sample */
+  uint8_t count;           /* samples queued, the one in flight included */
+  bool in_flight;          /* head handed to the MQTT client, not yet written out */
+  uint16_t dropped;        /* samples dropped since boot because the queue was full */
+  uint16_t retries;        /* publishes refused with MQTT_STATUS_OUT_QUEUE_FULL */
+} publish_queue_t;
+
+void publish_queue_init(publish_queue_t *queue);
+
+/*
+ * Slot at the tail for a new sample, to be filled by the caller. Drops the
+ * oldest sample not in flight if the queue is full; *dropped is set accordingly.
+ */
+publish_slot_t *publish_queue_push(publish_queue_t *queue, bool *dropped);
+
+/* oldest sample, NULL if empty */
+publish_slot_t *publish_queue_head(publish_queue_t *queue);
+
+/* removes the head, once it was written out */
+void publish_queue_pop(publish_queue_t *queue);
+
+static inline bool
+publish_queue_empty(const publish_queue_t *queue)
+{
+  return queue->count == 0;
+}
+
+#endif /* PUBLISH_QUEUE_H_ */
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,87 @@
+#include "sensor-filter.h"
+
+#include <string.h>
+
+/*---------------------------------------------------------------------------*/
+static int
+window_median(const sensor_filter_t *filter)
+{
+  int16_t sorted[FILTER_MAX_WINDOW];
+  uint8_t i, j;
+
+  /* insertion sort, the window is tiny */
+  for(i = 0; i < filter->count; i++) {
+    int16_t v = filter->readings[i];
+    for(j = i; j > 0 && sorted[j - 1] > v; j--) {
+      sorted[j] = sorted[j - 1];
+    }
+    sorted[j] = v;
+  }
+  if(filter->count % 2 == 1) {
+    return sorted[filter->count / 2];
+  }
+  return (sorted[filter->count / 2 - 1] + sorted[filter->count / 2]) / 2;
+}
+/*---------------------------------------------------------------------------*/
+void
+sensor_filter_init(sensor_filter_t *filter, const filter_config_t *config)
+{
+  memset(filter, 0, sizeof(*filter));
+  filter->config = *config;
+  if(filter->config.window < 1) filter->config.window = 1;
+  if(filter->config.window > FILTER_MAX_WINDOW) filter->config.window = FILTER_MAX_WINDOW;
+}
+/*---------------------------------------------------------------------------*/
+bool
+sensor_filter_add(sensor_filter_t *filter, int value)
+{
+  const filter_config_t *config = &filter->config;
+
+  /* a median needs 3 readings before anything can be called an outlier */
+  if(config->outlier_limit > 0 && filter->count >= 3) {
+    int deviation = value - window_median(filter);
+    if(deviation < 0) deviation = -deviation;
+    if(deviation > config->outlier_limit) {
+      filter->rejected++;
+      if(++filter->rejects < FILTER_MAX_REJECTS) {
+        return false;
+      }
+      /* not a spike: restart from the new level */
+      filter->count = 0;
+      filter->next = 0;
+    }
+  }
+  filter->rejects = 0;
+
+  if(filter->count == 0) {
+    filter->ema = (int32_t)value * (1 << FILTER_EMA_FRAC);
+  } else {
+    filter->ema += ((int32_t)value * (1 << FILTER_EMA_FRAC) - filter->ema) / (1 << config->ema_shift);
+  }
+
+  filter->readings[filter->next] = (int16_t)value;
+  filter->next = (filter->next + 1) % config->window;
+  if(filter->count < config->window) filter->count++;
+  return true;
+}
+/*---------------------------------------------------------------------------*/
+int
+sensor_filter_value(const sensor_filter_t *filter)
+{
+  switch(filter->config.method) {
+  case FILTER_MEDIAN:
+    return window_median(filter);
+  case FILTER_EMA:
+    /* round to the nearest unit */
+    return (filter->ema + (1 << (FILTER_EMA_FRAC - 1))) / (1 << FILTER_EMA_FRAC);
+  default:
+    return filter->readings[(filter->next + filter->config.window - 1) % filter->config.window];
+  }
+}
+/*---------------------------------------------------------------------------*/
+bool
+sensor_filter_ready(const sensor_filter_t *filter)
+{
+  return filter->count > 0;
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,54 @@
+/*---------------------------------------------------------------------------*/
+#ifndef SENSOR_FILTER_H_
+#define SENSOR_FILTER_H_
+/*---------------------------------------------------------------------------*/
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Integer-only smoothing of the oversampled sensor readings, on the fixed-point
+ * values the node publishes (temperature x10, pH x100, light and moisture x10).
+ * Readings farther than outlier_limit from the median of the window are
+ * dropped first; the output is then the median of the window, or an EMA
+ * with weight 1/2^ema_shift for each new reading. FILTER_MAX_REJECTS
+ * rejections in a row mean the level really moved: the window restarts there.
+ */
+#define FILTER_MAX_WINDOW  9
+#define FILTER_MAX_REJECTS 3
+#define FILTER_EMA_FRAC    4
+
+typedef enum {
+  FILTER_NONE,    /* last reading */
+  FILTER_MEDIAN,  /* median of the last window readings */
+  FILTER_EMA,     /* exponential moving average */
+} filter_method_t;
+
+typedef struct {
+  uint8_t method;
+  uint8_t window;          /* readings kept, 1..FILTER_MAX_WINDOW */
+  uint8_t ema_shift;       /* EMA weight of a new reading: 1/2^ema_shift */
+  uint16_t outlier_limit;  /* in fixed-point units, 0 = no outlier rejection */
+} filter_config_t;
+
+typedef struct {
+  filter_config_t config;
+  int16_t readings[FILTER_MAX_WINDOW];
+  uint8_t count;           /* readings in the window */
+  uint8_t next;            /* slot of the next reading */
+  uint8_t rejects;         /* outliers in a row */
+  int32_t ema;             /* x 2^FILTER_EMA_FRAC, valid when count > 0 */
+  uint16_t rejected;       /* outliers dropped since boot */
+} sensor_filter_t;
+
+void sensor_filter_init(sensor_filter_t *filter, const filter_config_t *config);
+
+/* adds a reading; false if it was dropped as an outlier */
+bool sensor_filter_add(sensor_filter_t *filter, int value);
+
+/* filtered value; only meaningful once a reading was added */
+int sensor_filter_value(const sensor_filter_t *filter);
+
+bool sensor_filter_ready(const sensor_filter_t *filter);
+
+#endif /* SENSOR_FILTER_H_ */
+/*---------------------------------------------------------------------------*/
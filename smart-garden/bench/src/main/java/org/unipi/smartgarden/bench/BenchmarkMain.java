@@ -0,0 +1,31 @@
+package org.unipi.smartgarden.bench;
+
+import org.openjdk.jmh.results.format.ResultFormatType;
+import org.openjdk.jmh.runner.Runner;
+import org.openjdk.jmh.runner.options.ChainedOptionsBuilder;
+import org.openjdk.jmh.runner.options.CommandLineOptions;
+import org.openjdk.jmh.runner.options.OptionsBuilder;
+
+/**
+ * BenchmarkMain - Runs the JMH suite with the usual command-line options, but
+ * writes the results as JSON (jmh-result.json) unless -rf/-rff say otherwise,
+ * so runs can be diffed to spot regressions.
+ */
+public class BenchmarkMain {
+
+    private static final String DEFAULT_RESULT_FILE = "jmh-result.json";
+
+    public static void main(String[] args) throws Exception {
+        CommandLineOptions cmd = new CommandLineOptions(args);
+        ChainedOptionsBuilder options = new OptionsBuilder().parent(cmd);
+
+        if (!cmd.getResultFormat().hasValue()) {
+            options.resultFormat(ResultFormatType.JSON);
+        }
+        if (!cmd.getResult().hasValue()) {
+            options.result(DEFAULT_RESULT_FILE);
+        }
+
+        new Runner(options.build()).run();
+    }
+}
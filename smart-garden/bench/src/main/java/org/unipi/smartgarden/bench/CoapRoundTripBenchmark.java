@@ -0,0 +1,92 @@
+package org.unipi.smartgarden.bench;
+
+import org.openjdk.jmh.annotations.Benchmark;
+import org.openjdk.jmh.annotations.BenchmarkMode;
+import org.openjdk.jmh.annotations.Fork;
+import org.openjdk.jmh.annotations.Measurement;
+import org.openjdk.jmh.annotations.Mode;
+import org.openjdk.jmh.annotations.OutputTimeUnit;
+import org.openjdk.jmh.annotations.Scope;
+import org.openjdk.jmh.annotations.Setup;
+import org.openjdk.jmh.annotations.State;
+import org.openjdk.jmh.annotations.TearDown;
+import org.openjdk.jmh.annotations.Warmup;
+import org.unipi.smartgarden.coap.COAPNetworkController;
+import org.unipi.smartgarden.coap.SimulatedActuatorNode;
+import org.unipi.smartgarden.db.DBDriver;
+import org.unipi.smartgarden.util.AsyncLogger;
+import org.unipi.smartgarden.util.ConsoleUtils;
+
+import java.sql.Connection;
+import java.util.List;
+import java.util.Map;
+import java.util.concurrent.CompletableFuture;
+import java.util.concurrent.TimeUnit;
+
+/**
+ * COAPNetworkController round trips against an in-process Californium node
+ * over loopback: single GET, single PUT, and a concurrent GET sweep.
+ */
+@State(Scope.Benchmark)
+@BenchmarkMode(Mode.AverageTime)
+@OutputTimeUnit(TimeUnit.MICROSECONDS)
+@Warmup(iterations = 3, time = 2)
+@Measurement(iterations = 5, time = 2)
+@Fork(1)
+public class CoapRoundTripBenchmark {
+
+    private static final int CONTROLLER_PORT = 15683;
+    private static final int NODE_PORT = 15684;
+    private static final List<String> ACTUATORS = List.of("fertilizer", "irrigation", "grow_light", "fan", "heater");
+
+    private Connection keepAlive;
+    private DBDriver db;
+    private SimulatedActuatorNode node;
+    private COAPNetworkController controller;
+    private boolean on;
+
+    @Setup
+    public void setUp() throws Exception {
+        ConsoleUtils.setConsoleLevel(AsyncLogger.Level.WARN);
+
+        keepAlive = EmbeddedDatabase.create("coap");
+        db = new DBDriver(EmbeddedDatabase.url("coap"), EmbeddedDatabase.USER, EmbeddedDatabase.PASSWORD);
+
+        node = new SimulatedActuatorNode(NODE_PORT, ACTUATORS);
+        node.start();
+
+        controller = new COAPNetworkController(ACTUATORS, db, CONTROLLER_PORT);
+        for (String actuator : ACTUATORS) {
+            controller.registerActuator(actuator, node.uriOf(actuator));
+        }
+    }
+
+    @TearDown
+    public void tearDown() throws Exception {
+        controller.close();
+        node.close();
+        db.close();
+        keepAlive.close();
+    }
+
+    @Benchmark
+    public String getActuatorState() throws Exception {
+        return controller.getActuatorState("fan");
+    }
+
+    @Benchmark
+    public Boolean sendCommand() {
+        on = !on;
+        return controller.sendCommandAsync("irrigation", on ? "on" : "off").join();
+    }
+
+    @Benchmark
+    public int concurrentSweep() {
+        Map<String, CompletableFuture<String>> states = controller.getActuatorStatesAsync(ACTUATORS);
+        int answered = 0;
+        for (CompletableFuture<String> state : states.values()) {
+            if (state.join() != null) answered++;
+        }
+        return answered;
+    }
+}
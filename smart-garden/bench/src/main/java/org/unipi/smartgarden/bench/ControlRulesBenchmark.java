@@ -0,0 +1,59 @@
+package org.unipi.smartgarden.bench;
+
+import org.openjdk.jmh.annotations.Benchmark;
+import org.openjdk.jmh.annotations.BenchmarkMode;
+import org.openjdk.jmh.annotations.Fork;
+import org.openjdk.jmh.annotations.Measurement;
+import org.openjdk.jmh.annotations.Mode;
+import org.openjdk.jmh.annotations.OutputTimeUnit;
+import org.openjdk.jmh.annotations.Scope;
+import org.openjdk.jmh.annotations.Setup;
+import org.openjdk.jmh.annotations.State;
+import org.openjdk.jmh.annotations.Warmup;
+import org.openjdk.jmh.infra.Blackhole;
+import org.unipi.smartgarden.control.ControlRules;
+
+import java.util.Random;
+import java.util.concurrent.TimeUnit;
+
+/**
+ * Automatic-mode decision functions of the control logic, over a fixed set of
+ * readings spread around every threshold.
+ */
+@State(Scope.Benchmark)
+@BenchmarkMode(Mode.AverageTime)
+@OutputTimeUnit(TimeUnit.NANOSECONDS)
+@Warmup(iterations = 3, time = 1)
+@Measurement(iterations = 5, time = 1)
+@Fork(1)
+public class ControlRulesBenchmark {
+
+    private static final int READINGS = 1024;
+
+    private final float[] temperature = new float[READINGS];
+    private final float[] pH = new float[READINGS];
+    private final float[] moisture = new float[READINGS];
+    private final float[] light = new float[READINGS];
+    private int i;
+
+    @Setup
+    public void setUp() {
+        Random random = new Random(42);
+        for (int k = 0; k < READINGS; k++) {
+            temperature[k] = 10 + random.nextFloat() * 25;
+            pH[k] = 4 + random.nextFloat() * 5;
+            moisture[k] = 10 + random.nextFloat() * 80;
+            light[k] = 10 + random.nextFloat() * 90;
+        }
+    }
+
+    @Benchmark
+    public void decideAll(Blackhole bh) {
+        int k = i++ & (READINGS - 1);
+        bh.consume(ControlRules.heaterCommand(temperature[k]));
+        bh.consume(ControlRules.fanCommand(temperature[k]));
+        bh.consume(ControlRules.fertilizerCommand(pH[k]));
+        bh.consume(ControlRules.irrigationCommand(moisture[k]));
+        bh.consume(ControlRules.growLightCommand(light[k]));
+    }
+}
@@ -0,0 +1,52 @@
+package org.unipi.smartgarden.bench;
+
+import java.sql.Connection;
+import java.sql.DriverManager;
+import java.sql.SQLException;
+import java.sql.Statement;
+
+/**
+ * EmbeddedDatabase - In-memory H2 database in MySQL mode with the smart_garden
+ * tables, standing in for the MySQL server.
+ */
+public final class EmbeddedDatabase {
+
+    public static final String USER = "sa";
+    public static final String PASSWORD = "";
+
+    private static final String[] SENSOR_TABLES = {"light", "soil_moisture", "temperature", "pH"};
+    private static final String[] SWITCH_TABLES = {"irrigation", "grow_light", "fan", "heater"};
+
+    private EmbeddedDatabase() {
+    }
+
+    /**
+     * Creates a fresh schema and returns its JDBC URL. The connection returned
+     * keeps the database alive until it is closed.
+     */
+    public static Connection create(String name) throws SQLException {
+        String url = url(name);
+        Connection keepAlive = DriverManager.getConnection(url, USER, PASSWORD);
+
+        try (Statement st = keepAlive.createStatement()) {
+            for (String table : SENSOR_TABLES) {
+                st.execute("CREATE TABLE " + table + " (id BIGINT AUTO_INCREMENT PRIMARY KEY, "
+                        + "value FLOAT, timestamp TIMESTAMP DEFAULT CURRENT_TIMESTAMP)");
+            }
+            for (String table : SWITCH_TABLES) {
+                st.execute("CREATE TABLE " + table + " (id BIGINT AUTO_INCREMENT PRIMARY KEY, "
+                        + "active BOOLEAN, timestamp TIMESTAMP DEFAULT CURRENT_TIMESTAMP)");
+            }
+            st.execute("CREATE TABLE fertilizer (id BIGINT AUTO_INCREMENT PRIMARY KEY, "
+                    + "mode INT, timestamp TIMESTAMP DEFAULT CURRENT_TIMESTAMP)");
+            st.execute("CREATE TABLE actuator_mode (id BIGINT AUTO_INCREMENT PRIMARY KEY, "
+                    + "actuator VARCHAR(32), mode VARCHAR(16), timestamp TIMESTAMP DEFAULT CURRENT_TIMESTAMP)");
+        }
+        return keepAlive;
+    }
+
+    public static String url(String name) {
+        // VALUE is a keyword in H2 2.x but a plain column name in the MySQL schema
+        return "jdbc:h2:mem:" + name + ";MODE=MySQL;NON_KEYWORDS=VALUE;DB_CLOSE_DELAY=-1";
+    }
+}
@@ -0,0 +1,76 @@
+package org.unipi.smartgarden.bench;
+
+import org.eclipse.paho.client.mqttv3.MqttMessage;
+import org.openjdk.jmh.annotations.Benchmark;
+import org.openjdk.jmh.annotations.BenchmarkMode;
+import org.openjdk.jmh.annotations.Fork;
+import org.openjdk.jmh.annotations.Measurement;
+import org.openjdk.jmh.annotations.Mode;
+import org.openjdk.jmh.annotations.OutputTimeUnit;
+import org.openjdk.jmh.annotations.Scope;
+import org.openjdk.jmh.annotations.Setup;
+import org.openjdk.jmh.annotations.State;
+import org.openjdk.jmh.annotations.TearDown;
+import org.openjdk.jmh.annotations.Warmup;
+import org.unipi.smartgarden.db.DBDriver;
+import org.unipi.smartgarden.mqtt.MQTTHandler;
+import org.unipi.smartgarden.util.AsyncLogger;
+import org.unipi.smartgarden.util.ConsoleUtils;
+
+import java.nio.charset.StandardCharsets;
+import java.sql.Connection;
+import java.util.Map;
+import java.util.concurrent.TimeUnit;
+
+/**
+ * Sample ingest path: MQTTHandler.messageArrived (JSON parsing, listeners, DB
+ * insert) and DBDriver.insertSample alone, against embedded H2.
+ */
+@State(Scope.Benchmark)
+@BenchmarkMode(Mode.AverageTime)
+@OutputTimeUnit(TimeUnit.MICROSECONDS)
+@Warmup(iterations = 3, time = 2)
+@Measurement(iterations = 5, time = 2)
+@Fork(1)
+public class IngestBenchmark {
+
+    private static final Map<String, String> SENSORS = Map.of(
+            "temperature", "temperature",
+            "pH", "pH",
+            "light", "light",
+            "soilMoisture", "soilMoisture");
+
+    private Connection keepAlive;
+    private DBDriver db;
+    private MQTTHandler handler;
+    private MqttMessage temperatureMessage;
+    private float value;
+
+    @Setup
+    public void setUp() throws Exception {
+        ConsoleUtils.setConsoleLevel(AsyncLogger.Level.WARN);
+
+        keepAlive = EmbeddedDatabase.create("ingest");
+        db = new DBDriver(EmbeddedDatabase.url("ingest"), EmbeddedDatabase.USER, EmbeddedDatabase.PASSWORD);
+        handler = new MQTTHandler(SENSORS, db, null);
+        temperatureMessage = new MqttMessage("{\"temperature\":25.3}".getBytes(StandardCharsets.UTF_8));
+    }
+
+    @TearDown
+    public void tearDown() throws Exception {
+        db.close();
+        keepAlive.close();
+    }
+
+    @Benchmark
+    public Float messageArrived() {
+        handler.messageArrived("temperature", temperatureMessage);
+        return handler.getLatestValue("temperature");
+    }
+
+    @Benchmark
+    public boolean insertSample() {
+        value += 0.1f;
+        return db.insertSample("soilMoisture", value, null);
+    }
+}
@@ -0,0 +1,190 @@
+package org.unipi.smartgarden.bench;
+
+import org.eclipse.californium.core.CoapClient;
+import org.eclipse.californium.core.CoapResource;
+import org.eclipse.californium.core.CoapResponse;
+import org.eclipse.californium.core.CoapServer;
+import org.eclipse.californium.core.coap.CoAP;
+import org.eclipse.californium.core.coap.MediaTypeRegistry;
+import org.eclipse.californium.core.coap.Request;
+import org.eclipse.californium.core.coap.Response;
+import org.eclipse.californium.core.network.CoapEndpoint;
+import org.eclipse.californium.core.network.interceptors.MessageInterceptorAdapter;
+import org.eclipse.californium.core.server.resources.CoapExchange;
+import org.eclipse.californium.cose.AlgorithmID;
+import org.eclipse.californium.elements.config.Configuration;
+import org.eclipse.californium.oscore.HashMapCtxDB;
+import org.eclipse.californium.oscore.OSCoreCoapStackFactory;
+import org.eclipse.californium.oscore.OSCoreCtx;
+import org.eclipse.californium.scandium.DTLSConnector;
+import org.eclipse.californium.scandium.config.DtlsConfig;
+import org.eclipse.californium.scandium.config.DtlsConnectorConfig;
+import org.eclipse.californium.scandium.dtls.cipher.CipherSuite;
+import org.eclipse.californium.scandium.dtls.pskstore.AdvancedMultiPskStore;
+import org.eclipse.californium.scandium.dtls.pskstore.AdvancedPskStore;
+import org.eclipse.californium.scandium.dtls.pskstore.AdvancedSinglePskStore;
+import org.openjdk.jmh.annotations.Benchmark;
+import org.openjdk.jmh.annotations.BenchmarkMode;
+import org.openjdk.jmh.annotations.Fork;
+import org.openjdk.jmh.annotations.Measurement;
+import org.openjdk.jmh.annotations.Mode;
+import org.openjdk.jmh.annotations.OutputTimeUnit;
+import org.openjdk.jmh.annotations.Param;
+import org.openjdk.jmh.annotations.Scope;
+import org.openjdk.jmh.annotations.Setup;
+import org.openjdk.jmh.annotations.State;
+import org.openjdk.jmh.annotations.TearDown;
+import org.openjdk.jmh.annotations.Warmup;
+import org.unipi.smartgarden.coap.OscoreContexts;
+import org.unipi.smartgarden.util.AsyncLogger;
+import org.unipi.smartgarden.util.ConsoleUtils;
+
+import java.net.InetSocketAddress;
+import java.util.List;
+import java.util.concurrent.TimeUnit;
+import java.util.concurrent.atomic.AtomicLong;
+
+/**
+ * GET round trip of an actuator resource over loopback, plaintext against
+ * OSCORE (the contexts of OscoreContexts, node side set up as coap-device.c
+ * does) and DTLS 1.2 with a pre-shared key. The handshake is done in the setup,
+ * so only the per-request cost is measured. The average request and response
+ * sizes on the wire are printed at the end of each trial; for DTLS the record
+ * overhead of TLS_PSK_WITH_AES_128_CCM_8 is added to the CoAP bytes.
+ */
+@State(Scope.Benchmark)
+@BenchmarkMode(Mode.AverageTime)
+@OutputTimeUnit(TimeUnit.MICROSECONDS)
+@Warmup(iterations = 3, time = 2)
+@Measurement(iterations = 5, time = 2)
+@Fork(1)
+public class OscoreOverheadBenchmark {
+
+    private static final int NODE_PORT = 15690;
+    private static final int NODE_OSCORE_ID = 1;
+    // RFC 8613 test vectors, as in oscore-keys.h
+    private static final byte[] MASTER_SECRET = {
+            0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f, 0x10};
+    private static final byte[] MASTER_SALT = {
+            (byte) 0x9e, 0x7c, (byte) 0xa9, 0x22, 0x23, 0x78, 0x63, 0x40};
+    private static final String PSK_IDENTITY = "smartgarden";
+    // DTLS 1.2 record: 13-byte header, 8-byte explicit nonce, 8-byte CCM_8 tag
+    private static final int DTLS_RECORD_OVERHEAD = 13 + 8 + 8;
+
+    @Param({"plain", "oscore", "dtls"})
+    public String security;
+
+    private CoapServer node;
+    private CoapEndpoint clientEndpoint;
+    private CoapClient client;
+    private final AtomicLong requests = new AtomicLong();
+    private final AtomicLong requestBytes = new AtomicLong();
+    private final AtomicLong responses = new AtomicLong();
+    private final AtomicLong responseBytes = new AtomicLong();
+
+    @Setup
+    public void setUp() throws Exception {
+        ConsoleUtils.setConsoleLevel(AsyncLogger.Level.WARN);
+        DtlsConfig.register();
+
+        node = new CoapServer();
+        node.add(new CoapResource("fan") {
+            @Override
+            public void handleGET(CoapExchange exchange) {
+                exchange.respond(CoAP.ResponseCode.CONTENT, "{\"mode\":\"off\",\"seq\":1,\"ts\":1718000000123}",
+                        MediaTypeRegistry.APPLICATION_JSON);
+            }
+        });
+
+        String scheme = "coap";
+        switch (security) {
+            case "plain" -> {
+                node.addEndpoint(new CoapEndpoint.Builder().setPort(NODE_PORT).build());
+                clientEndpoint = new CoapEndpoint.Builder().build();
+            }
+            case "oscore" -> {
+                // node side: Sender ID = its OSCORE id, recipient = the controller, ID Context of this boot
+                byte[] nodeId = {(byte) NODE_OSCORE_ID};
+                byte[] idContext = {(byte) NODE_OSCORE_ID, 1, 2, 3, 4, 5, 6, 7, 8};
+                HashMapCtxDB nodeDb = new HashMapCtxDB();
+                nodeDb.addContext(new OSCoreCtx(MASTER_SECRET, false, AlgorithmID.AES_CCM_16_64_128, nodeId,
+                        new byte[]{OscoreContexts.CONTROLLER_ID}, AlgorithmID.HKDF_HMAC_SHA_256, 32, MASTER_SALT,
+                        idContext, 1024));
+                node.addEndpoint(new CoapEndpoint.Builder().setPort(NODE_PORT)
+                        .setCustomCoapStackArgument(nodeDb).setCoapStackFactory(new OSCoreCoapStackFactory()).build());
+
+                OscoreContexts controller = new OscoreContexts(MASTER_SECRET, MASTER_SALT, List.of(NODE_OSCORE_ID),
+                        null);
+                controller.startSession(NODE_OSCORE_ID, idContext);
+                controller.bind("127.0.0.1:" + NODE_PORT, NODE_OSCORE_ID);
+                clientEndpoint = controller.newEndpoint(0);
+            }
+            case "dtls" -> {
+                scheme = "coaps";
+                AdvancedMultiPskStore keys = new AdvancedMultiPskStore();
+                keys.setKey(PSK_IDENTITY, MASTER_SECRET);
+                node.addEndpoint(dtlsEndpoint(new InetSocketAddress(NODE_PORT), keys));
+                clientEndpoint = dtlsEndpoint(new InetSocketAddress(0),
+                        new AdvancedSinglePskStore(PSK_IDENTITY, MASTER_SECRET));
+            }
+            default -> throw new IllegalArgumentException("Unknown security mode: " + security);
+        }
+        node.start();
+
+        clientEndpoint.addPostProcessInterceptor(new MessageInterceptorAdapter() {
+            @Override
+            public void sendRequest(Request request) {
+                requests.incrementAndGet();
+                requestBytes.addAndGet(request.getBytes().length);
+            }
+        });
+        clientEndpoint.addInterceptor(new MessageInterceptorAdapter() {
+            @Override
+            public void receiveResponse(Response response) {
+                responses.incrementAndGet();
+                responseBytes.addAndGet(response.getBytes().length);
+            }
+        });
+        clientEndpoint.start();
+
+        client = new CoapClient(scheme + "://127.0.0.1:" + NODE_PORT + "/fan");
+        client.setEndpoint(clientEndpoint);
+        // DTLS handshake, and the first OSCORE exchange, outside the measurement
+        getFan();
+        requests.set(0);
+        requestBytes.set(0);
+        responses.set(0);
+        responseBytes.set(0);
+    }
+
+    private static CoapEndpoint dtlsEndpoint(InetSocketAddress address, AdvancedPskStore keys) {
+        DtlsConnectorConfig config = DtlsConnectorConfig.builder(Configuration.getStandard())
+                .setAddress(address)
+                .setAdvancedPskStore(keys)
+                .setAsList(DtlsConfig.DTLS_CIPHER_SUITES, CipherSuite.TLS_PSK_WITH_AES_128_CCM_8)
+                .build();
+        return new CoapEndpoint.Builder().setConnector(new DTLSConnector(config)).build();
+    }
+
+    @TearDown
+    public void tearDown() {
+        long overhead = "dtls".equals(security) ? DTLS_RECORD_OVERHEAD : 0;
+        if (requests.get() > 0 && responses.get() > 0) {
+            System.out.printf("%n%s: %d B per request, %d B per response on the wire%n", security,
+                    requestBytes.get() / requests.get() + overhead, responseBytes.get() / responses.get() + overhead);
+        }
+        client.shutdown();
+        clientEndpoint.destroy();
+        node.stop();
+        node.destroy();
+    }
+
+    @Benchmark
+    public String getFan() throws Exception {
+        Request get = Request.newGet();
+        if ("oscore".equals(security)) OscoreContexts.protect(get);
+        CoapResponse response = client.advanced(get);
+        if (response == null) throw new IllegalStateException("No response from the node (" + security + ")");
+        return response.getResponseText();
+    }
+}
@@ -0,0 +1,101 @@
+package org.unipi.smartgarden.bench;
+
+import org.openjdk.jmh.annotations.Benchmark;
+import org.openjdk.jmh.annotations.BenchmarkMode;
+import org.openjdk.jmh.annotations.Fork;
+import org.openjdk.jmh.annotations.Measurement;
+import org.openjdk.jmh.annotations.Mode;
+import org.openjdk.jmh.annotations.OutputTimeUnit;
+import org.openjdk.jmh.annotations.Scope;
+import org.openjdk.jmh.annotations.Setup;
+import org.openjdk.jmh.annotations.State;
+import org.openjdk.jmh.annotations.TearDown;
+import org.openjdk.jmh.annotations.Warmup;
+import org.unipi.smartgarden.db.DBDriver;
+import org.unipi.smartgarden.db.SegmentStore;
+import org.unipi.smartgarden.util.AsyncLogger;
+import org.unipi.smartgarden.util.ConsoleUtils;
+
+import java.nio.file.Files;
+import java.nio.file.Path;
+import java.sql.Connection;
+import java.util.Comparator;
+import java.util.concurrent.TimeUnit;
+import java.util.stream.Stream;
+
+/**
+ * The two SampleStores side by side: one sample insert, and a scan of one day
+ * of temperature at the 4 s publishing period (21600 samples).
+ */
+@State(Scope.Benchmark)
+@BenchmarkMode(Mode.AverageTime)
+@OutputTimeUnit(TimeUnit.MICROSECONDS)
+@Warmup(iterations = 3, time = 2)
+@Measurement(iterations = 5, time = 2)
+@Fork(1)
+public class StorageBenchmark {
+
+    private static final long DAY_MS = 24 * 60 * 60 * 1000L;
+    private static final long DAY_START = 1_750_000_000_000L / DAY_MS * DAY_MS;
+    private static final int DAY_SAMPLES = 21600;
+
+    private Connection keepAlive;
+    private DBDriver db;
+    private Path dataDir;
+    private SegmentStore segments;
+    private float value;
+
+    @Setup
+    public void setUp() throws Exception {
+        ConsoleUtils.setConsoleLevel(AsyncLogger.Level.WARN);
+
+        keepAlive = EmbeddedDatabase.create("storage");
+        db = new DBDriver(EmbeddedDatabase.url("storage"), EmbeddedDatabase.USER, EmbeddedDatabase.PASSWORD);
+        dataDir = Files.createTempDirectory("segment-bench");
+        segments = new SegmentStore(dataDir);
+
+        float t = 22f;
+        for (int i = 0; i < DAY_SAMPLES; i++) {
+            t += ((i * 7919) % 11 - 5) * 0.01f;
+            db.insertSample("temperature", t, DAY_START + i * 4000L);
+            segments.insertSample("temperature", t, DAY_START + i * 4000L);
+        }
+        segments.flushAll();
+    }
+
+    @TearDown
+    public void tearDown() throws Exception {
+        db.close();
+        keepAlive.close();
+        segments.close();
+        try (Stream<Path> files = Files.walk(dataDir)) {
+            files.sorted(Comparator.reverseOrder()).forEach(p -> p.toFile().delete());
+        }
+    }
+
+    @Benchmark
+    public boolean insertDatabase() {
+        value += 0.1f;
+        return db.insertSample("soilMoisture", value, null);
+    }
+
+    @Benchmark
+    public boolean insertSegmentStore() {
+        value += 0.1f;
+        return segments.insertSample("soilMoisture", value, null);
+    }
+
+    @Benchmark
+    public double scanDayDatabase() {
+        double[] sum = {0};
+        db.scan("temperature", DAY_START, DAY_START + DAY_MS, (ts, v) -> sum[0] += v);
+        return sum[0];
+    }
+
+    @Benchmark
+    public double scanDaySegmentStore() {
+        double[] sum = {0};
+        segments.scan("temperature", DAY_START, DAY_START + DAY_MS, (ts, v) -> sum[0] += v);
+        return sum[0];
+    }
+}
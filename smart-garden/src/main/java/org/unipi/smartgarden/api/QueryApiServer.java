@@ -0,0 +1,235 @@
+package org.unipi.smartgarden.api;
+
+import com.google.gson.Gson;
+import com.sun.net.httpserver.HttpExchange;
+import com.sun.net.httpserver.HttpHandler;
+import com.sun.net.httpserver.HttpServer;
+import org.unipi.smartgarden.control.ActuatorCommandBus;
+import org.unipi.smartgarden.control.ControlLogicThread;
+import org.unipi.smartgarden.control.ManualCommands;
+import org.unipi.smartgarden.metrics.Histogram;
+import org.unipi.smartgarden.metrics.Metrics;
+import org.unipi.smartgarden.mqtt.MQTTHandler;
+import org.unipi.smartgarden.util.ConsoleUtils;
+
+import java.io.IOException;
+import java.io.InputStream;
+import java.io.OutputStream;
+import java.net.InetAddress;
+import java.net.InetSocketAddress;
+import java.nio.charset.StandardCharsets;
+import java.security.MessageDigest;
+import java.util.LinkedHashMap;
+import java.util.List;
+import java.util.Map;
+import java.util.TreeMap;
+import java.util.concurrent.ExecutorService;
+import java.util.concurrent.Executors;
+import java.util.concurrent.RejectedExecutionException;
+
+/**
+ * QueryApiServer - HTTP/JSON API for dashboards and scripts, using the HTTP
+ * server bundled with the JDK:
+ * <ul>
+ *   <li>GET /api/sensors - latest value of every sensor</li>
+ *   <li>GET /api/actuators - last known state and mode (auto/manual) of every actuator</li>
+ *   <li>GET /api/history?sensor=&lt;name&gt;&amp;limit=n - recent samples, of every sensor without sensor</li>
+ *   <li>POST /api/commands - a CLI command in the body, e.g. "trigger fan", with
+ *   the header "Authorization: Bearer &lt;token&gt;"</li>
+ * </ul>
+ * Listens on the loopback interface unless exposed explicitly.
+ * Reads only look at the in-memory state, never at the network or the DB.
+ * Commands run one at a time on their own thread, so a slow node never holds
+ * up the reads.
+ */
+public class QueryApiServer {
+
+    private static final String LOG = "[Query API]";
+    private static final String CONTENT_TYPE = "application/json; charset=utf-8";
+    private static final int DEFAULT_HISTORY_LIMIT = 60;
+    private static final int MAX_COMMAND_BYTES = 256;
+
+    private static final Histogram LATENCY = Metrics.histogram("smartgarden_api_request_seconds",
+            "Query API response time", "path");
+
+    private final MQTTHandler mqttHandler;
+    private final ActuatorCommandBus commandBus;
+    private final ControlLogicThread controlLogic;
+    private final ManualCommands commands;
+    private final RecentSamples history;
+    private final List<String> actuators;
+    private final byte[] token;
+    private final Gson gson = new Gson();
+
+    private final HttpServer server;
+    private final ExecutorService readers = Executors.newFixedThreadPool(2, r -> {
+        Thread t = new Thread(r, "api-http");
+        t.setDaemon(true);
+        return t;
+    });
+    private final ExecutorService commandRunner = Executors.newSingleThreadExecutor(r -> {
+        Thread t = new Thread(r, "api-command");
+        t.setDaemon(true);
+        return t;
+    });
+
+    /**
+     * exposed binds every interface instead of the loopback one; token is the
+     * bearer token the commands must carry.
+     */
+    public QueryApiServer(int port, boolean exposed, String token, MQTTHandler mqttHandler,
+                          ActuatorCommandBus commandBus, ControlLogicThread controlLogic, ManualCommands commands,
+                          RecentSamples history, List<String> actuators) throws IOException {
+        this.mqttHandler = mqttHandler;
+        this.commandBus = commandBus;
+        this.controlLogic = controlLogic;
+        this.commands = commands;
+        this.history = history;
+        this.actuators = actuators;
+        this.token = ("Bearer " + token).getBytes(StandardCharsets.UTF_8);
+
+        server = HttpServer.create(exposed
+                ? new InetSocketAddress(port)
+                : new InetSocketAddress(InetAddress.getLoopbackAddress(), port), 0);
+        server.createContext("/api/sensors", get(this::sensors));
+        server.createContext("/api/actuators", get(this::actuatorStates));
+        server.createContext("/api/history", get(this::recentSamples));
+        server.createContext("/api/commands", this::command);
+        server.setExecutor(readers);
+        server.start();
+        ConsoleUtils.println(LOG + " API available at http://" + (exposed ? "*" : "localhost") + ":" + port + "/api");
+    }
+
+    private interface Query {
+        Object answer(HttpExchange exchange);
+    }
+
+    private HttpHandler get(Query query) {
+        return exchange -> {
+            long start = System.nanoTime();
+            try {
+                if (!"GET".equals(exchange.getRequestMethod())) {
+                    exchange.sendResponseHeaders(405, -1);
+                    return;
+                }
+                send(exchange, 200, query.answer(exchange));
+            } finally {
+                exchange.close();
+                LATENCY.observeSince(exchange.getHttpContext().getPath(), start);
+            }
+        };
+    }
+
+    private Object sensors(HttpExchange exchange) {
+        return new TreeMap<>(mqttHandler.getLatestValues());
+    }
+
+    private Object actuatorStates(HttpExchange exchange) {
+        Map<String, String> states = commandBus.getKnownStates();
+        Map<String, Boolean> overrides = controlLogic.getManualOverrides();
+        Map<String, Map<String, String>> result = new LinkedHashMap<>();
+        for (String actuator : actuators) {
+            boolean manual = "grow_light".equals(actuator)
+                    ? controlLogic.isGrowLightManual()
+                    : overrides.getOrDefault(actuator, false);
+            Map<String, String> entry = new LinkedHashMap<>();
+            entry.put("state", states.get(actuator));  // left out when not known yet
+            entry.put("mode", manual ? "manual" : "auto");
+            result.put(actuator, entry);
+        }
+        return result;
+    }
+
+    private Object recentSamples(HttpExchange exchange) {
+        String sensor = null;
+        int limit = DEFAULT_HISTORY_LIMIT;
+        String query = exchange.getRequestURI().getQuery();
+        if (query != null) {
+            for (String param : query.split("&")) {
+                String[] kv = param.split("=", 2);
+                if (kv.length != 2) continue;
+                if ("sensor".equals(kv[0])) sensor = kv[1];
+                if ("limit".equals(kv[0])) {
+                    try {
+                        limit = Math.max(1, Integer.parseInt(kv[1]));
+                    } catch (NumberFormatException e) {
+                        // keep the default
+                    }
+                }
+            }
+        }
+        return sensor == null ? history.all(limit) : Map.of(sensor, history.of(sensor, limit));
+    }
+
+    private void command(HttpExchange exchange) throws IOException {
+        long start = System.nanoTime();
+        if (!"POST".equals(exchange.getRequestMethod())) {
+            exchange.sendResponseHeaders(405, -1);
+            exchange.close();
+            return;
+        }
+        String authorization = exchange.getRequestHeaders().getFirst("Authorization");
+        if (authorization == null
+                || !MessageDigest.isEqual(token, authorization.trim().getBytes(StandardCharsets.UTF_8))) {
+            exchange.getResponseHeaders().set("WWW-Authenticate", "Bearer");
+            reply(exchange, 401, false, "Missing or wrong token", start);
+            return;
+        }
+
+        String line;
+        try (InputStream in = exchange.getRequestBody()) {
+            line = new String(in.readNBytes(MAX_COMMAND_BYTES), StandardCharsets.UTF_8).trim();
+        }
+        if (line.isEmpty()) {
+            reply(exchange, 400, false, "Empty command", start);
+            return;
+        }
+
+        try {
+            commandRunner.execute(() -> {
+                ConsoleUtils.println(LOG + " Executing command: " + line);
+                ManualCommands.Result result;
+                try {
+                    result = commands.execute(line);
+                } catch (Exception e) {
+                    ConsoleUtils.printError(LOG + " Command failed: " + line + ": " + e.getMessage());
+                    reply(exchange, 500, false, "Command failed: " + e.getMessage(), start);
+                    return;
+                }
+                reply(exchange, result.isOk() ? 200 : 400, result.isOk(), result.getMessage(), start);
+            });
+        } catch (RejectedExecutionException e) {
+            reply(exchange, 503, false, "Shutting down", start);
+        }
+    }
+
+    private void reply(HttpExchange exchange, int status, boolean ok, String message, long start) {
+        Map<String, Object> body = new LinkedHashMap<>();
+        body.put("ok", ok);
+        body.put("message", message);
+        try {
+            send(exchange, status, body);
+        } catch (IOException e) {
+            ConsoleUtils.debug(LOG + " Client went away before the reply: " + e.getMessage());
+        } finally {
+            exchange.close();
+            LATENCY.observeSince("/api/commands", start);
+        }
+    }
+
+    private void send(HttpExchange exchange, int status, Object answer) throws IOException {
+        byte[] body = gson.toJson(answer).getBytes(StandardCharsets.UTF_8);
+        exchange.getResponseHeaders().set("Content-Type", CONTENT_TYPE);
+        exchange.sendResponseHeaders(status, body.length);
+        try (OutputStream os = exchange.getResponseBody()) {
+            os.write(body);
+        }
+    }
+
+    public void close() {
+        server.stop(0);
+        commandRunner.shutdown();
+        readers.shutdown();
+        ConsoleUtils.println(LOG + " API server stopped.");
+    }
+}
@@ -0,0 +1,66 @@
+package org.unipi.smartgarden.api;
+
+import org.unipi.smartgarden.mqtt.SampleListener;
+
+import java.util.ArrayDeque;
+import java.util.ArrayList;
+import java.util.Deque;
+import java.util.List;
+import java.util.Map;
+import java.util.TreeMap;
+import java.util.concurrent.ConcurrentHashMap;
+
+/**
+ * RecentSamples - The last samples of every sensor, kept in memory so the query
+ * API answers history requests without going to the database.
+ */
+public class RecentSamples implements SampleListener {
+
+    private final int capacity;
+    // sensor -> samples, oldest first (guarded by the deque)
+    private final Map<String, Deque<Sample>> samples = new ConcurrentHashMap<>();
+
+    public RecentSamples(int capacity) {
+        this.capacity = capacity;
+    }
+
+    @Override
+    public void onSample(String sensorName, float value) {
+        Deque<Sample> recent = samples.computeIfAbsent(sensorName, k -> new ArrayDeque<>(capacity));
+        synchronized (recent) {
+            if (recent.size() == capacity) recent.removeFirst();
+            recent.addLast(new Sample(System.currentTimeMillis(), value));
+        }
+    }
+
+    /**
+     * Up to limit samples of the sensor, oldest first; empty if none.
+     */
+    public List<Sample> of(String sensorName, int limit) {
+        Deque<Sample> recent = samples.get(sensorName);
+        if (recent == null) return new ArrayList<>();
+        synchronized (recent) {
+            List<Sample> all = new ArrayList<>(recent);
+            return all.subList(Math.max(0, all.size() - limit), all.size());
+        }
+    }
+
+    public Map<String, List<Sample>> all(int limit) {
+        Map<String, List<Sample>> result = new TreeMap<>();
+        for (String sensor : samples.keySet()) {
+            result.put(sensor, of(sensor, limit));
+        }
+        return result;
+    }
+
+    public static final class Sample {
+
+        final long ts;
+        final float value;
+
+        Sample(long ts, float value) {
+            this.ts = ts;
+            this.value = value;
+        }
+    }
+}
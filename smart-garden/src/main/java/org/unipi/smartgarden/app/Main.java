@@ -1,34 +1,72 @@
 package org.unipi.smartgarden.app;
 
 import org.eclipse.californium.elements.exception.ConnectorException;
+import org.unipi.smartgarden.api.QueryApiServer;
+import org.unipi.smartgarden.api.RecentSamples;
+import org.unipi.smartgarden.cluster.ClusterMembership;
 import org.unipi.smartgarden.configuration.Configuration;
+import org.unipi.smartgarden.control.ActuatorCommandBus;
+import org.unipi.smartgarden.control.ActuatorPolicy;
 import org.unipi.smartgarden.control.ControlLogicThread;
+import org.unipi.smartgarden.control.ManualCommands;
+import org.unipi.smartgarden.control.SamplingRateController;
 import org.unipi.smartgarden.db.DBDriver;
+import org.unipi.smartgarden.db.SampleCompressor;
+import org.unipi.smartgarden.db.SampleStore;
+import org.unipi.smartgarden.db.SegmentStore;
+import org.unipi.smartgarden.metrics.DeliveryStats;
+import org.unipi.smartgarden.metrics.Metrics;
+import org.unipi.smartgarden.metrics.MetricsServer;
 import org.unipi.smartgarden.mqtt.MQTTHandler;
 import org.unipi.smartgarden.coap.COAPNetworkController;
+import org.unipi.smartgarden.coap.CoapGroupCommander;
+import org.unipi.smartgarden.coap.OscoreContexts;
+import org.unipi.smartgarden.snapshot.SnapshotManager;
+import org.unipi.smartgarden.util.AsyncLogger;
 import org.unipi.smartgarden.util.ConsoleUtils;
 
 import com.google.gson.Gson;
 
 import java.io.IOException;
+import java.nio.file.Path;
 import java.util.HashMap;
 import java.util.Map;
 import java.util.Scanner;
+import java.util.UUID;
+import java.util.concurrent.CompletableFuture;
 
 public class Main {
 
     private static final String LOG = "[Smart Garden]";
+    private static final int METRICS_PORT = 9464;
+    private static final int API_PORT = 8080;
+    private static final int API_HISTORY = 120;  // samples kept per sensor for /api/history
+    private static final int COAP_PORT = 5683;
+    private static final String BROKER_URI = "tcp://localhost:1883";
+    private static final String DEFAULT_SHARE_GROUP = "smartgarden";
+    private static final String SNAPSHOT_FILE = "smartgarden-state.json";
+    private static final String OSCORE_STATE_FILE = "smartgarden-oscore.json";
 
     private static final String[] possibleCommands = {
             "current status",
             "show actuators",
+            "show nodes",
+            "show command stats",
+            "show delivery stats",
+            "show cluster",
+            "show sampling rates",
             "trigger irrigation",
             "trigger grow_light",
             "trigger fertilizer",
             "trigger fan",
             "trigger heater",
+            "set <actuator> <on|off|sinc|sdec>",
+            "group <actuator> <on|off|sinc|sdec> [zone]",
+            "show groups",
             "get configuration",
             "set grow_light auto",
+            "set console quiet",
+            "set console verbose",
             "help",
             "quit"
     };
@@ -36,6 +74,41 @@ public class Main {
 
     public static void main(String[] args) throws ConnectorException, IOException {
 
+        // clustered mode: --instance <id> [--share-group <group>] [--coap-port N] [--metrics-port N]
+        // query API: [--api-port N] [--api-token T] (or SMARTGARDEN_API_TOKEN), --api-expose to listen beyond localhost
+        // without MySQL: --data-dir <dir> keeps the samples in local segment files
+        String instanceId = null;
+        String dataDir = null;
+        String shareGroup = DEFAULT_SHARE_GROUP;
+        int coapPort = COAP_PORT;
+        int metricsPort = METRICS_PORT;
+        int apiPort = API_PORT;
+        boolean apiExposed = false;
+        String apiToken = System.getenv("SMARTGARDEN_API_TOKEN");
+        for (int i = 0; i < args.length; i++) {
+            String option = args[i];
+            // the only option without a value
+            if (option.equals("--api-expose")) {
+                apiExposed = true;
+                continue;
+            }
+            if (i + 1 == args.length) {
+                ConsoleUtils.printError(LOG + " Missing value for " + option);
+                break;
+            }
+            String value = args[++i];
+            switch (option) {
+                case "--instance" -> instanceId = value;
+                case "--share-group" -> shareGroup = value;
+                case "--coap-port" -> coapPort = Integer.parseInt(value);
+                case "--metrics-port" -> metricsPort = Integer.parseInt(value);
+                case "--api-port" -> apiPort = Integer.parseInt(value);
+                case "--api-token" -> apiToken = value;
+                case "--data-dir" -> dataDir = value;
+                default -> ConsoleUtils.printError(LOG + " Ignoring unknown option: " + option);
+            }
+        }
+
         ConsoleUtils.println(LOG + " Welcome to the Smart Garden System!");
 
         ConsoleUtils.println(LOG + " Loading configuration...");
@@ -51,27 +124,83 @@ public class Main {
 
         ConsoleUtils.println(configuration.toString());
 
-        DBDriver db = new DBDriver();
+        // before the first HttpServer: small replies on keep-alive connections must not wait for delayed ACKs
+        System.setProperty("sun.net.httpserver.nodelay", "true");
+        MetricsServer metricsServer = new MetricsServer(metricsPort);
+        Metrics.counterFunction("smartgarden_log_dropped_total",
+                "Log records dropped because the logger ring was full", ConsoleUtils::getDroppedCount);
+
+        SampleStore db = dataDir == null ? new DBDriver() : new SegmentStore(Path.of(dataDir));
 
         Map<String, String> sensorTopicMap = new HashMap<>();
+        SampleCompressor compressor = new SampleCompressor(db);
         for (var sensor : configuration.getSensors()) {
             sensorTopicMap.put(sensor.getId(), sensor.getTopic());
+            compressor.configure(sensor.getId(), SampleCompressor.parseMethod(sensor.getCompression()),
+                    sensor.getDeviation());
         }
-        MQTTHandler mqttHandler = new MQTTHandler(sensorTopicMap, db);
+        MQTTHandler mqttHandler = instanceId == null
+                ? new MQTTHandler(sensorTopicMap, db)
+                : new MQTTHandler(sensorTopicMap, db, BROKER_URI, instanceId, shareGroup);
+        mqttHandler.setCompressor(compressor);
 
-        COAPNetworkController coapController = new COAPNetworkController(configuration.getActuators(), db, mqttHandler);
-
-        ConsoleUtils.println(LOG + " Waiting 15 seconds for CoAP device registration...");
+        OscoreContexts oscore = null;
         try {
-            Thread.sleep(15000);
-        } catch (InterruptedException e) {
-            ConsoleUtils.printError(LOG + " Sleep interrupted.");
+            oscore = OscoreContexts.of(configuration.getOscore(), Path.of(OSCORE_STATE_FILE));
+        } catch (Exception e) {
+            ConsoleUtils.printError(LOG + " Invalid OSCORE configuration: " + e.getMessage());
+            System.exit(1);
+        }
+        // the instances would share the controller's Sender ID, and so its nonces
+        if (oscore != null && instanceId != null) {
+            ConsoleUtils.printError(LOG + " OSCORE is not supported in clustered mode.");
+            System.exit(1);
+        }
+        COAPNetworkController coapController = new COAPNetworkController(configuration.getActuators(), db, coapPort,
+                oscore);
+        ActuatorCommandBus commandBus = new ActuatorCommandBus(coapController, mqttHandler, db, configuration.getActuators());
+        CoapGroupCommander groupCommander = new CoapGroupCommander(coapController);
+
+        ClusterMembership cluster = null;
+        if (instanceId != null) {
+            cluster = new ClusterMembership(BROKER_URI, instanceId, coapController);
+            cluster.addRebalanceListener(commandBus::onOwnershipChanged);
+            cluster.addRebalanceListener(groupCommander::onOwnershipChanged);
         }
 
-        ControlLogicThread controlLogic = new ControlLogicThread(mqttHandler, coapController);
-        controlLogic.start();
+        ControlLogicThread controlLogic = new ControlLogicThread(mqttHandler, commandBus,
+                new ActuatorPolicy(configuration.getPolicies()));
+
+        SnapshotManager snapshots = new SnapshotManager(
+                instanceId == null ? SNAPSHOT_FILE : "smartgarden-state-" + instanceId + ".json",
+                mqttHandler, coapController, commandBus, controlLogic);
+        // with the endpoints of the last run the nodes need not register again
+        if (!snapshots.restore()) {
+            ConsoleUtils.println(LOG + " Waiting 15 seconds for CoAP device registration...");
+            try {
+                Thread.sleep(15000);
+            } catch (InterruptedException e) {
+                ConsoleUtils.printError(LOG + " Sleep interrupted.");
+            }
+        }
 
-        Map<String, Boolean> actuatorState = new HashMap<>();
+        mqttHandler.addSampleListener(controlLogic);
+        SamplingRateController samplingRates = new SamplingRateController(mqttHandler, commandBus::getKnownState);
+        mqttHandler.addSampleListener(samplingRates);
+        if (cluster != null) samplingRates.setOwnership(cluster::owns);
+        controlLogic.start();
+        snapshots.start();
+
+        ManualCommands manualCommands = new ManualCommands(configuration.getActuators(), commandBus, controlLogic,
+                groupCommander, cluster);
+        RecentSamples recentSamples = new RecentSamples(API_HISTORY);
+        mqttHandler.addSampleListener(recentSamples);
+        if (apiToken == null || apiToken.isBlank()) {
+            apiToken = UUID.randomUUID().toString();
+            ConsoleUtils.println(LOG + " API token for commands (set --api-token to fix it): " + apiToken);
+        }
+        QueryApiServer apiServer = new QueryApiServer(apiPort, apiExposed, apiToken, mqttHandler, commandBus,
+                controlLogic, manualCommands, recentSamples, configuration.getActuators());
 
         Scanner scanner = new Scanner(System.in);
         printPossibleCommands();
@@ -82,102 +211,53 @@ public class Main {
             String userInput = scanner.nextLine().trim().toLowerCase();
             ConsoleUtils.setTyping(false);
 
+            // trigger/set/group: shared with the query API
+            if (userInput.startsWith("group ") || userInput.startsWith("set ") && !userInput.startsWith("set console")
+                    || userInput.startsWith("trigger ") && !userInput.equals("trigger fertilizer")) {
+                ConsoleUtils.println(LOG + " Executing command: " + userInput);
+                report(manualCommands.execute(userInput));
+                continue;
+            }
+
             if (isValidCommand(userInput)) {
                 ConsoleUtils.println(LOG + " Executing command: " + userInput);
                 
-                if (userInput.equals("set grow_light auto")) {
-		    controlLogic.enableGrowLightAutoMode();
-		    continue;
-		}
-
-                if (userInput.startsWith("trigger ")) {
-                    String shortName = userInput.replace("trigger ", "").trim();
-
-                    if (!configuration.getActuators().contains(shortName)) {
-                        ConsoleUtils.printError(LOG + " Unknown actuator: " + shortName);
-                        continue;
+                if (userInput.equals("trigger fertilizer")) {
+                    ConsoleUtils.println(LOG + " Select fertilizer mode:");
+                    ConsoleUtils.println(LOG + "   1 - sinc (acidic)");
+                    ConsoleUtils.println(LOG + "   2 - sdec (alkaline)");
+                    ConsoleUtils.println(LOG + "   3 - off");
+                    ConsoleUtils.print("> ");
+                    ConsoleUtils.setTyping(true);
+                    String choice = scanner.nextLine().trim();
+                    ConsoleUtils.setTyping(false);
+
+                    String mode = switch (choice) {
+                        case "1" -> "sinc";
+                        case "2" -> "sdec";
+                        case "3" -> "off";
+                        default -> null;
+                    };
+                    if (mode == null) {
+                        ConsoleUtils.printError(LOG + " Invalid fertilizer mode.");
+                    } else {
+                        report(manualCommands.set("fertilizer", mode));
                     }
-
-                    if (shortName.equals("fertilizer")) {
-			    ConsoleUtils.println(LOG + " Select fertilizer mode:");
-			    ConsoleUtils.println(LOG + "   1 - sinc (acidic)");
-			    ConsoleUtils.println(LOG + "   2 - sdec (alkaline)");
-			    ConsoleUtils.println(LOG + "   3 - off");
-			    ConsoleUtils.print("> ");
-			    ConsoleUtils.setTyping(true);
-			    String choice = scanner.nextLine().trim();
-			    ConsoleUtils.setTyping(false);
-
-			    String mode = switch (choice) {
-				case "1" -> "sinc";
-				case "2" -> "sdec";
-				case "3" -> "off";
-				default -> null;
-			    };
-
-			    if (mode == null) {
-				ConsoleUtils.printError(LOG + " Invalid fertilizer mode.");
-				continue;
-			    }
-
-			    try {
-				coapController.sendCommand(shortName, mode);
-				mqttHandler.simulateFertilizer(mode);
-				
-				// Manual override logic for fertilizer
-				if (!"off".equalsIgnoreCase(mode)) {
-				    controlLogic.setManualOverride(shortName, true);
-				    ConsoleUtils.println(LOG + " Manual override activated for " + shortName);
-				} else {
-				    controlLogic.setManualOverride(shortName, false);
-				    ConsoleUtils.println(LOG + " Manual override cleared for " + shortName);
-			        }  
-			    } catch (Exception e) {
-				ConsoleUtils.printError(LOG + " Failed to send fertilizer command.");
-				e.printStackTrace();
-			    }
-			} else {
-			    boolean currentState;
-		    	    try {
-				    String state = coapController.getActuatorState(shortName);
-				    currentState = "on".equalsIgnoreCase(state);
-			    } catch (Exception e) {
-				    ConsoleUtils.printError(LOG + " Could not fetch current state for " + shortName + ". Assuming OFF.");
-				    currentState = false;
-			    }
-			    String nextCommand = currentState ? "off" : "on";
-
-			    try {
-				coapController.sendCommand(shortName, nextCommand);
-				actuatorState.put(shortName, !currentState);
-				
-				  if ("grow_light".equals(shortName)) {
-				      controlLogic.setGrowLightManualMode(true);
-				      controlLogic.setGrowLightState(!currentState);
-				      ConsoleUtils.println(LOG + " Manual override activated for " + shortName);
-				  } else if ("irrigation".equals(shortName)) {
-				      if ("on".equalsIgnoreCase(nextCommand)) {
-					  controlLogic.setManualOverride(shortName, true);
-					  ConsoleUtils.println(LOG + " Manual override activated for " + shortName);
-				      } else {
-					  controlLogic.setManualOverride(shortName, false);
-					  ConsoleUtils.println(LOG + " Manual override cleared for " + shortName);
-				      }
-
-				  } else if ("fan".equals(shortName) || "heater".equals(shortName)) {
-				      controlLogic.setManualOverride(shortName, true);
-				      ConsoleUtils.println(LOG + " Manual override activated for " + shortName);
-				  }
-			    } catch (Exception e) {
-				ConsoleUtils.printError(LOG + " Failed to send toggle command to " + shortName);
-				e.printStackTrace();
-			    }
-			}
-
                     continue;
                 }
 
                 switch (userInput) {
+                    case "set console quiet":
+                        // per-message output keeps going to smartgarden.log
+                        ConsoleUtils.setConsoleLevel(AsyncLogger.Level.INFO);
+                        ConsoleUtils.println(LOG + " Per-message output hidden from the console.");
+                        break;
+
+                    case "set console verbose":
+                        ConsoleUtils.setConsoleLevel(AsyncLogger.Level.DEBUG);
+                        ConsoleUtils.println(LOG + " Per-message output shown on the console.");
+                        break;
+
                     case "quit":
                         ConsoleUtils.println(LOG + " Shutting down...");
                         controlLogic.stopThread();
@@ -186,9 +266,17 @@ public class Main {
                         } catch (InterruptedException e) {
                             ConsoleUtils.printError(LOG + " Error while stopping control logic thread.");
                         }
+                        apiServer.close();
+                        snapshots.close();
+                        commandBus.close();
+                        groupCommander.close();
+                        if (cluster != null) cluster.close();
                         mqttHandler.close();
                         coapController.close();
+                        if (oscore != null) oscore.save();
+                        compressor.flush();
                         db.close();
+                        metricsServer.close();
                         scanner.close();
                         ConsoleUtils.closeLogger();
                         ConsoleUtils.println(LOG + " Bye!");
@@ -201,9 +289,11 @@ public class Main {
 
                     case "show actuators":
 		        ConsoleUtils.println(LOG + " Current actuator states:");
+		        Map<String, CompletableFuture<String>> states =
+		                coapController.getActuatorStatesAsync(configuration.getActuators());
 		        for (String shortName : configuration.getActuators()) {
 			    try {
-			        String state = coapController.getActuatorState(shortName);
+			        String state = states.get(shortName).join();
 			        String line = "  - " + shortName + ": " + state;
   
 			        if (shortName.equals("grow_light") && controlLogic.isGrowLightManual()) {
@@ -217,6 +307,54 @@ public class Main {
 		        }
 		        break;
 
+                    case "show nodes":
+                        ConsoleUtils.println(LOG + " " + coapController.getRegistry().size()
+                                + " actuator resources registered:");
+                        for (var entry : coapController.getRegistry().byNode().entrySet()) {
+                            ConsoleUtils.println("  - " + entry.getKey() + ": " + entry.getValue());
+                        }
+                        break;
+
+                    case "show command stats":
+                        ConsoleUtils.println(LOG + " Actuator commands issued: " + commandBus.getIssuedCount()
+                                + ", suppressed: " + commandBus.getSuppressedCount());
+                        break;
+
+                    case "show delivery stats":
+                        ConsoleUtils.println(LOG + " Delivery per device:");
+                        for (String line : DeliveryStats.summary()) {
+                            ConsoleUtils.println("  - " + line);
+                        }
+                        break;
+
+                    case "show cluster":
+                        if (cluster == null) {
+                            ConsoleUtils.println(LOG + " Running as a single instance.");
+                        } else {
+                            ConsoleUtils.println(LOG + " Instance " + cluster.getInstanceId()
+                                    + (cluster.isConnected() ? ", members: " + cluster.getMembers()
+                                    : ", disconnected from the broker"));
+                            ConsoleUtils.println(LOG + " Commanding: " + cluster.getOwnedEndpoints());
+                        }
+                        break;
+
+                    case "show sampling rates":
+                        ConsoleUtils.println(LOG + " Reporting intervals (s) per node:");
+                        for (var entry : samplingRates.getIntervals().entrySet()) {
+                            ConsoleUtils.println("  - " + entry.getKey() + ": " + entry.getValue());
+                        }
+                        break;
+
+                    case "show groups":
+                        ConsoleUtils.println(LOG + " Group members per zone:");
+                        for (var entry : groupCommander.describeMembers().entrySet()) {
+                            ConsoleUtils.println("  zone " + entry.getKey() + ":");
+                            for (String member : entry.getValue()) {
+                                ConsoleUtils.println("    - " + member);
+                            }
+                        }
+                        break;
+
                     case "get configuration":
                         ConsoleUtils.println(configuration.toString());
                         break;
@@ -232,6 +370,14 @@ public class Main {
         }
     }
 
+    private static void report(ManualCommands.Result result) {
+        if (result.isOk()) {
+            ConsoleUtils.println(LOG + " " + result.getMessage());
+        } else {
+            ConsoleUtils.printError(LOG + " " + result.getMessage());
+        }
+    }
+
     private static void printPossibleCommands() {
         ConsoleUtils.println(LOG + " Available commands:");
         for (String command : possibleCommands) {
@@ -0,0 +1,338 @@
+package org.unipi.smartgarden.cluster;
+
+import org.eclipse.paho.client.mqttv3.IMqttDeliveryToken;
+import org.eclipse.paho.client.mqttv3.MqttCallback;
+import org.eclipse.paho.client.mqttv3.MqttClient;
+import org.eclipse.paho.client.mqttv3.MqttConnectOptions;
+import org.eclipse.paho.client.mqttv3.MqttException;
+import org.eclipse.paho.client.mqttv3.MqttMessage;
+import org.eclipse.paho.client.mqttv3.persist.MemoryPersistence;
+import org.json.JSONException;
+import org.json.JSONObject;
+import org.unipi.smartgarden.coap.ActuatorEndpoint;
+import org.unipi.smartgarden.coap.ActuatorRegistry;
+import org.unipi.smartgarden.coap.COAPNetworkController;
+import org.unipi.smartgarden.coap.RegistrationListener;
+import org.unipi.smartgarden.metrics.Metrics;
+import org.unipi.smartgarden.util.ConsoleUtils;
+
+import java.nio.charset.StandardCharsets;
+import java.util.HashSet;
+import java.util.List;
+import java.util.Set;
+import java.util.TreeSet;
+import java.util.concurrent.CopyOnWriteArrayList;
+import java.util.concurrent.Executors;
+import java.util.concurrent.ScheduledExecutorService;
+import java.util.concurrent.ThreadLocalRandom;
+import java.util.concurrent.TimeUnit;
+import java.util.concurrent.atomic.AtomicBoolean;
+import java.util.concurrent.atomic.AtomicInteger;
+
+/**
+ * ClusterMembership - Tracks the backend instances of a cluster through
+ * retained MQTT topics and decides which instance owns which actuator
+ * endpoint, keyed "actuator@node" so the nodes of one type spread over the
+ * instances.
+ *
+ * Every instance keeps a retained message on smartgarden/cluster/members/<id>
+ * and sets an empty retained last will on it, so the broker clears the entry
+ * when the instance dies. Ownership is computed locally by each instance on a
+ * consistent-hash ring built from the live members, so all of them agree
+ * without coordination. Node registrations are shared on
+ * smartgarden/cluster/registry/<actuator>/<node>, whichever instance received
+ * them, and cleared there when the endpoint is removed.
+ *
+ * An instance that loses the broker owns nothing until it has joined again,
+ * since the others take its endpoints over once its last will is published.
+ */
+public class ClusterMembership implements MqttCallback, RegistrationListener {
+
+    private static final String LOG = "[Cluster]";
+    private static final String MEMBERS_TOPIC = "smartgarden/cluster/members/";
+    private static final String REGISTRY_TOPIC = "smartgarden/cluster/registry/";
+    // rejoin backoff: 0.5 s doubling up to 30 s, +-20 % jitter
+    private static final long REJOIN_MIN_MS = 500;
+    private static final long REJOIN_MAX_MS = 30_000;
+
+    private final String instanceId;
+    private final COAPNetworkController coapController;
+    private final List<Runnable> rebalanceListeners = new CopyOnWriteArrayList<>();
+
+    private final Set<String> members = new HashSet<>(); // guarded by this
+    private volatile HashRing ring;
+    private volatile Set<String> owned = Set.of();
+    private volatile boolean connected;
+    private volatile boolean closing;
+    // URI of the registry message being applied, not shared back (callback thread)
+    private volatile String applying;
+
+    private MqttClient client;
+    private final MqttConnectOptions options = new MqttConnectOptions();
+    private final AtomicInteger rejoinAttempts = new AtomicInteger();
+    private final AtomicBoolean rejoinPending = new AtomicBoolean();
+    private final ScheduledExecutorService scheduler = Executors.newSingleThreadScheduledExecutor(r -> {
+        Thread t = new Thread(r, "cluster-rejoin");
+        t.setDaemon(true);
+        return t;
+    });
+
+    public ClusterMembership(String brokerUri, String instanceId, COAPNetworkController coapController) {
+        this.instanceId = instanceId;
+        this.coapController = coapController;
+
+        members.add(instanceId);
+        ring = new HashRing(members);
+
+        Metrics.gauge("smartgarden_cluster_members", "Live backend instances in the cluster",
+                () -> ring.getMembers().size());
+        Metrics.gauge("smartgarden_cluster_owned_actuators", "Actuator endpoints commanded by this instance",
+                () -> getOwnedEndpoints().size());
+
+        coapController.setOwnership(this::owns);
+        coapController.addRegistrationListener(this);
+
+        options.setCleanSession(true);
+        options.setKeepAliveInterval(10); // a dead instance is dropped within ~15 s
+        options.setConnectionTimeout(5);
+        options.setWill(MEMBERS_TOPIC + instanceId, new byte[0], 1, true);
+        try {
+            client = new MqttClient(brokerUri, "SmartGardenApp-" + instanceId + "-cluster", new MemoryPersistence());
+            client.setCallback(this);
+        } catch (MqttException e) {
+            ConsoleUtils.printError(LOG + " Invalid broker " + brokerUri + ": " + e.getMessage());
+            client = null;
+            return;
+        }
+        if (!join()) scheduleRejoin();
+    }
+
+    // connects, starts again from this instance alone and announces it; the retained
+    // members and registrations follow. Runs on the constructor or the rejoin thread.
+    private boolean join() {
+        if (closing) return false;
+        try {
+            if (!client.isConnected()) client.connect(options);
+            synchronized (this) {
+                members.clear();
+                members.add(instanceId);
+            }
+            client.subscribe(MEMBERS_TOPIC + "+", 1);
+            client.subscribe(REGISTRY_TOPIC + "#", 1);
+            client.publish(MEMBERS_TOPIC + instanceId,
+                    ("{\"instance\":\"" + instanceId + "\",\"since\":" + System.currentTimeMillis() + "}")
+                            .getBytes(StandardCharsets.UTF_8), 1, true);
+            // the retained members came in meanwhile: only now claim a share of the ring
+            connected = true;
+            rebalance();
+        } catch (MqttException e) {
+            ConsoleUtils.printError(LOG + " Failed to join the cluster: " + e.getMessage());
+            leave();
+            return false;
+        }
+        // registrations received while away
+        for (ActuatorEndpoint endpoint : coapController.getRegistry().all()) {
+            onRegistration(endpoint.getActuator(), endpoint.getUri(), endpoint.getZone());
+        }
+        rejoinAttempts.set(0);
+        ConsoleUtils.println(LOG + " Joined cluster as " + instanceId);
+        return true;
+    }
+
+    private void scheduleRejoin() {
+        if (closing || !rejoinPending.compareAndSet(false, true)) return;
+        int attempt = rejoinAttempts.getAndIncrement();
+        long delay = Math.min(REJOIN_MAX_MS, REJOIN_MIN_MS << Math.min(attempt, 6));
+        delay = (long) (delay * ThreadLocalRandom.current().nextDouble(0.8, 1.2));
+        ConsoleUtils.println(LOG + " Rejoining in " + delay + " ms");
+        scheduler.schedule(() -> {
+            rejoinPending.set(false);
+            if (!join()) scheduleRejoin();
+        }, delay, TimeUnit.MILLISECONDS);
+    }
+
+    // off the broker: the others take over once the last will is out, so give everything up now
+    private void leave() {
+        connected = false;
+        rebalance();
+    }
+
+    public String getInstanceId() {
+        return instanceId;
+    }
+
+    public boolean owns(String key) {
+        return connected && instanceId.equals(ring.ownerOf(key));
+    }
+
+    public boolean isConnected() {
+        return connected;
+    }
+
+    public String ownerOf(String key) {
+        return ring.ownerOf(key);
+    }
+
+    public Set<String> getMembers() {
+        return ring.getMembers();
+    }
+
+    /**
+     * Instances commanding the registered nodes of an actuator type.
+     */
+    public Set<String> ownersOf(String actuator) {
+        Set<String> owners = new TreeSet<>();
+        for (ActuatorEndpoint endpoint : coapController.getRegistry().find(actuator, ActuatorRegistry.ALL_ZONES)) {
+            owners.add(ring.ownerOf(endpoint.getKey()));
+        }
+        return owners;
+    }
+
+    /**
+     * Keys ("actuator@node") of the registered endpoints this instance commands.
+     */
+    public Set<String> getOwnedEndpoints() {
+        return connected ? ownedEndpoints(ring) : Set.of();
+    }
+
+    /**
+     * Called after ownership moved between instances, on the MQTT callback thread.
+     */
+    public void addRebalanceListener(Runnable listener) {
+        rebalanceListeners.add(listener);
+    }
+
+    @Override
+    public void onRegistration(String actuatorName, String uri) {
+        onRegistration(actuatorName, uri, ActuatorRegistry.DEFAULT_ZONE);
+    }
+
+    @Override
+    public void onRegistration(String actuatorName, String uri, int zone) {
+        if (client == null || !connected) return;  // shared again on rejoin
+        if (uri.equals(applying)) return;          // came from the registry topic
+        String node = ActuatorEndpoint.nodeOf(uri);
+        String payload = new JSONObject().put("uri", uri).put("zone", zone).toString();
+        try {
+            client.publish(REGISTRY_TOPIC + actuatorName + "/" + node,
+                    payload.getBytes(StandardCharsets.UTF_8), 1, true);
+        } catch (MqttException e) {
+            ConsoleUtils.printError(LOG + " Failed to share registration of " + actuatorName + ": " + e.getMessage());
+        }
+    }
+
+    @Override
+    public void onRemoval(String actuatorName, String uri) {
+        if (client == null || !connected) return;
+        try {
+            client.publish(REGISTRY_TOPIC + actuatorName + "/" + ActuatorEndpoint.nodeOf(uri), new byte[0], 1, true);
+        } catch (MqttException e) {
+            ConsoleUtils.printError(LOG + " Failed to share removal of " + actuatorName + ": " + e.getMessage());
+        }
+    }
+
+    @Override
+    public void messageArrived(String topic, MqttMessage message) {
+        String payload = new String(message.getPayload(), StandardCharsets.UTF_8).trim();
+
+        if (topic.startsWith(MEMBERS_TOPIC)) {
+            String member = topic.substring(MEMBERS_TOPIC.length());
+            boolean changed;
+            synchronized (this) {
+                changed = payload.isEmpty() ? members.remove(member) : members.add(member);
+            }
+            if (changed) {
+                ConsoleUtils.println(LOG + " Instance " + member + (payload.isEmpty() ? " left" : " joined"));
+                rebalance();
+            }
+        } else if (topic.startsWith(REGISTRY_TOPIC) && payload.isEmpty()) {
+            // removed by another instance
+            String[] parts = topic.substring(REGISTRY_TOPIC.length()).split("/", 2);
+            if (parts.length < 2) return;
+            for (ActuatorEndpoint endpoint : coapController.getRegistry().onNode(parts[1])) {
+                if (endpoint.getActuator().equals(parts[0])) coapController.removeActuator(endpoint.getUri());
+            }
+        } else if (topic.startsWith(REGISTRY_TOPIC)) {
+            String actuator = topic.substring(REGISTRY_TOPIC.length()).split("/", 2)[0];
+            // older instances publish the bare URI on registry/<actuator>
+            String uri = payload;
+            int zone = ActuatorRegistry.DEFAULT_ZONE;
+            if (payload.startsWith("{")) {
+                try {
+                    JSONObject json = new JSONObject(payload);
+                    uri = json.getString("uri");
+                    zone = json.optInt("zone", zone);
+                } catch (JSONException e) {
+                    ConsoleUtils.printError(LOG + " Invalid registration on " + topic + ": " + payload);
+                    return;
+                }
+            }
+            ActuatorEndpoint known = coapController.getRegistry().get(uri);
+            if (known == null || known.getZone() != zone) {
+                applying = uri;
+                try {
+                    coapController.registerActuator(actuator, uri, zone);
+                } finally {
+                    applying = null;
+                }
+            }
+        }
+    }
+
+    private void rebalance() {
+        HashRing next;
+        synchronized (this) {
+            next = new HashRing(members);
+        }
+        Set<String> before = owned;
+        ring = next;
+        owned = connected ? ownedEndpoints(next) : Set.of();
+
+        if (!owned.equals(before)) {
+            ConsoleUtils.println(LOG + " Members " + next.getMembers() + ", now commanding " + owned);
+            for (Runnable listener : rebalanceListeners) {
+                listener.run();
+            }
+        }
+    }
+
+    private Set<String> ownedEndpoints(HashRing r) {
+        Set<String> result = new TreeSet<>();
+        for (ActuatorEndpoint endpoint : coapController.getRegistry().all()) {
+            if (instanceId.equals(r.ownerOf(endpoint.getKey()))) result.add(endpoint.getKey());
+        }
+        return Set.copyOf(result);
+    }
+
+    @Override
+    public void connectionLost(Throwable cause) {
+        ConsoleUtils.printError(LOG + " Connection lost, commanding nothing until rejoined: " + cause.getMessage());
+        leave();
+        scheduleRejoin();
+    }
+
+    @Override
+    public void deliveryComplete(IMqttDeliveryToken token) {
+        // Not needed
+    }
+
+    /**
+     * Leaves the cluster: the retained entry is cleared right away so the other
+     * instances take over without waiting for the keep-alive to expire.
+     */
+    public void close() {
+        closing = true;
+        scheduler.shutdownNow();
+        if (client == null) return;
+        try {
+            if (client.isConnected()) {
+                client.publish(MEMBERS_TOPIC + instanceId, new byte[0], 1, true);
+                client.disconnect();
+            }
+            client.close();
+            ConsoleUtils.println(LOG + " Left cluster.");
+        } catch (MqttException e) {
+            ConsoleUtils.printError(LOG + " Error while leaving the cluster: " + e.getMessage());
+        }
+    }
+}
@@ -0,0 +1,60 @@
+package org.unipi.smartgarden.cluster;
+
+import java.nio.charset.StandardCharsets;
+import java.security.MessageDigest;
+import java.security.NoSuchAlgorithmException;
+import java.util.Collection;
+import java.util.Map;
+import java.util.Set;
+import java.util.TreeMap;
+import java.util.TreeSet;
+
+/**
+ * HashRing - Immutable consistent-hash ring over the cluster members. Each
+ * member is placed at several points of the ring so keys spread evenly, and a
+ * membership change only moves the keys of the member that joined or left.
+ */
+public class HashRing {
+
+    private static final int VIRTUAL_NODES = 128;
+
+    private final TreeMap<Long, String> ring = new TreeMap<>();
+    private final Set<String> members;
+
+    public HashRing(Collection<String> members) {
+        this.members = new TreeSet<>(members);
+        for (String member : this.members) {
+            for (int i = 0; i < VIRTUAL_NODES; i++) {
+                ring.put(hash(member + "#" + i), member);
+            }
+        }
+    }
+
+    /**
+     * Member owning the key: the first point clockwise from its hash, or null
+     * on an empty ring.
+     */
+    public String ownerOf(String key) {
+        if (ring.isEmpty()) return null;
+        Map.Entry<Long, String> entry = ring.ceilingEntry(hash(key));
+        return entry != null ? entry.getValue() : ring.firstEntry().getValue();
+    }
+
+    public Set<String> getMembers() {
+        return members;
+    }
+
+    // first 8 bytes of the MD5 digest, as ketama does
+    private static long hash(String key) {
+        try {
+            byte[] digest = MessageDigest.getInstance("MD5").digest(key.getBytes(StandardCharsets.UTF_8));
+            long h = 0;
+            for (int i = 0; i < 8; i++) {
+                h = (h << 8) | (digest[i] & 0xff);
+            }
+            return h;
+        } catch (NoSuchAlgorithmException e) {
+            throw new IllegalStateException("MD5 not available", e);
+        }
+    }
+}
@@ -0,0 +1,74 @@
+package org.unipi.smartgarden.coap;
+
+import java.net.URI;
+
+/**
+ * ActuatorEndpoint - One actuator resource on one node: its type ("fan",
+ * "irrigation", ...), the URI of the resource, the node address and the garden
+ * zone the node declared when registering.
+ */
+public class ActuatorEndpoint {
+
+    private final String actuator;
+    private final String uri;
+    private final String node;
+    private final int zone;
+    private final long seq;  // registration order, the first node of a type is its reference
+
+    ActuatorEndpoint(String actuator, String uri, int zone, long seq) {
+        this.actuator = actuator;
+        this.uri = uri;
+        this.node = nodeOf(uri);
+        this.zone = zone;
+        this.seq = seq;
+    }
+
+    public String getActuator() {
+        return actuator;
+    }
+
+    public String getUri() {
+        return uri;
+    }
+
+    /**
+     * Node address, the host and port of the URI: nodes simulated on one host
+     * differ only by port.
+     */
+    public String getNode() {
+        return node;
+    }
+
+    public int getZone() {
+        return zone;
+    }
+
+    long getSeq() {
+        return seq;
+    }
+
+    /**
+     * Cluster ownership key, "actuator@node".
+     */
+    public String getKey() {
+        return keyOf(actuator, uri);
+    }
+
+    public static String keyOf(String actuator, String uri) {
+        return actuator + "@" + nodeOf(uri);
+    }
+
+    public static String nodeOf(String uri) {
+        try {
+            String authority = URI.create(uri).getRawAuthority();
+            return authority == null ? uri : authority;
+        } catch (IllegalArgumentException e) {
+            return uri;
+        }
+    }
+
+    @Override
+    public String toString() {
+        return actuator + "@" + node + " (zone " + zone + ")";
+    }
+}
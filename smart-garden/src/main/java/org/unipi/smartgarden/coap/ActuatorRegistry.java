@@ -0,0 +1,130 @@
+package org.unipi.smartgarden.coap;
+
+import java.util.ArrayList;
+import java.util.Comparator;
+import java.util.List;
+import java.util.Map;
+import java.util.NavigableSet;
+import java.util.NoSuchElementException;
+import java.util.TreeMap;
+import java.util.concurrent.ConcurrentHashMap;
+import java.util.concurrent.ConcurrentSkipListSet;
+
+/**
+ * ActuatorRegistry - Actuator resources of every registered node, indexed by
+ * resource URI, by node and by type and zone, so that "all fans in zone 3" is
+ * a single map lookup. Reads are lock-free from any thread; registrations are
+ * serialized so the indexes always agree. Each index keeps the endpoints in
+ * registration order.
+ */
+public class ActuatorRegistry {
+
+    public static final int ALL_ZONES = 0;
+    public static final int DEFAULT_ZONE = 1;
+
+    private static final Comparator<ActuatorEndpoint> BY_SEQ = Comparator.comparingLong(ActuatorEndpoint::getSeq);
+
+    private final Map<String, ActuatorEndpoint> byUri = new ConcurrentHashMap<>();
+    private final Map<String, NavigableSet<ActuatorEndpoint>> byNode = new ConcurrentHashMap<>();
+    // type -> every zone, under ALL_ZONES too
+    private final Map<String, Map<Integer, NavigableSet<ActuatorEndpoint>>> byType = new ConcurrentHashMap<>();
+
+    private long nextSeq;  // guarded by this
+
+    /**
+     * Adds the resource, or moves it to the new zone when the node registers
+     * again. Returns the endpoint now registered for the URI.
+     */
+    public synchronized ActuatorEndpoint register(String actuator, String uri, int zone) {
+        ActuatorEndpoint previous = byUri.get(uri);
+        if (previous != null && previous.getActuator().equals(actuator) && previous.getZone() == zone) {
+            return previous;
+        }
+        if (previous != null) unindex(previous);
+
+        // a re-registration keeps its place in the order
+        ActuatorEndpoint endpoint = new ActuatorEndpoint(actuator, uri, zone,
+                previous != null ? previous.getSeq() : nextSeq++);
+        byUri.put(uri, endpoint);
+        byNode.computeIfAbsent(endpoint.getNode(), n -> new ConcurrentSkipListSet<>(BY_SEQ)).add(endpoint);
+        Map<Integer, NavigableSet<ActuatorEndpoint>> zones = byType.computeIfAbsent(actuator, t -> new ConcurrentHashMap<>());
+        zones.computeIfAbsent(ALL_ZONES, z -> new ConcurrentSkipListSet<>(BY_SEQ)).add(endpoint);
+        zones.computeIfAbsent(zone, z -> new ConcurrentSkipListSet<>(BY_SEQ)).add(endpoint);
+        return endpoint;
+    }
+
+    public synchronized boolean remove(String uri) {
+        ActuatorEndpoint endpoint = byUri.remove(uri);
+        if (endpoint == null) return false;
+        unindex(endpoint);
+        return true;
+    }
+
+    private void unindex(ActuatorEndpoint endpoint) {
+        NavigableSet<ActuatorEndpoint> onNode = byNode.get(endpoint.getNode());
+        if (onNode != null) {
+            onNode.remove(endpoint);
+            if (onNode.isEmpty()) byNode.remove(endpoint.getNode());
+        }
+        Map<Integer, NavigableSet<ActuatorEndpoint>> zones = byType.get(endpoint.getActuator());
+        if (zones != null) {
+            zones.get(ALL_ZONES).remove(endpoint);
+            NavigableSet<ActuatorEndpoint> inZone = zones.get(endpoint.getZone());
+            inZone.remove(endpoint);
+            if (inZone.isEmpty()) zones.remove(endpoint.getZone());
+        }
+    }
+
+    public ActuatorEndpoint get(String uri) {
+        return byUri.get(uri);
+    }
+
+    /**
+     * Endpoints of a type in a zone (ALL_ZONES for the whole garden).
+     */
+    public List<ActuatorEndpoint> find(String actuator, int zone) {
+        Map<Integer, NavigableSet<ActuatorEndpoint>> zones = byType.get(actuator);
+        NavigableSet<ActuatorEndpoint> endpoints = zones == null ? null : zones.get(zone);
+        return endpoints == null ? List.of() : new ArrayList<>(endpoints);
+    }
+
+    /**
+     * First registered endpoint of a type, or null if none.
+     */
+    public ActuatorEndpoint first(String actuator) {
+        Map<Integer, NavigableSet<ActuatorEndpoint>> zones = byType.get(actuator);
+        NavigableSet<ActuatorEndpoint> endpoints = zones == null ? null : zones.get(ALL_ZONES);
+        if (endpoints == null) return null;
+        try {
+            return endpoints.first();
+        } catch (NoSuchElementException e) {
+            return null;  // removed meanwhile
+        }
+    }
+
+    public List<ActuatorEndpoint> onNode(String node) {
+        NavigableSet<ActuatorEndpoint> endpoints = byNode.get(node);
+        return endpoints == null ? List.of() : new ArrayList<>(endpoints);
+    }
+
+    /**
+     * Node -> its endpoints, sorted by node address.
+     */
+    public Map<String, List<ActuatorEndpoint>> byNode() {
+        Map<String, List<ActuatorEndpoint>> nodes = new TreeMap<>();
+        for (Map.Entry<String, NavigableSet<ActuatorEndpoint>> entry : byNode.entrySet()) {
+            nodes.put(entry.getKey(), new ArrayList<>(entry.getValue()));
+        }
+        return nodes;
+    }
+
+    public List<ActuatorEndpoint> all() {
+        List<ActuatorEndpoint> endpoints = new ArrayList<>(byUri.values());
+        endpoints.sort(BY_SEQ);
+        return endpoints;
+    }
+
+    public int size() {
+        return byUri.size();
+    }
+}
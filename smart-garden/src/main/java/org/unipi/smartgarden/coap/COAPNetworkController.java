@@ -3,142 +3,463 @@ package org.unipi.smartgarden.coap;
 import org.eclipse.californium.core.*;
 import org.eclipse.californium.core.coap.CoAP;
 import org.eclipse.californium.core.coap.MediaTypeRegistry;
+import org.eclipse.californium.core.coap.Request;
+import org.eclipse.californium.core.network.CoapEndpoint;
 import org.eclipse.californium.core.server.resources.CoapExchange;
 import org.eclipse.californium.core.CoapResource;
 import org.eclipse.californium.elements.exception.ConnectorException;
-import org.unipi.smartgarden.db.DBDriver;
+import org.unipi.smartgarden.db.SampleStore;
+import org.unipi.smartgarden.metrics.Counter;
+import org.unipi.smartgarden.metrics.Histogram;
+import org.unipi.smartgarden.metrics.Metrics;
 import org.unipi.smartgarden.util.ConsoleUtils;
-import org.unipi.smartgarden.mqtt.MQTTHandler;
 
 import java.nio.charset.StandardCharsets;
 import org.json.JSONObject;
 import org.json.JSONArray;
 
 import java.io.IOException;
+import java.util.ArrayList;
+import java.util.Collection;
 import java.util.HashMap;
+import java.util.LinkedHashMap;
 import java.util.List;
 import java.util.Map;
+import java.util.concurrent.CompletableFuture;
+import java.util.concurrent.ConcurrentHashMap;
+import java.util.concurrent.CopyOnWriteArrayList;
+import java.util.concurrent.ExecutionException;
+import java.util.concurrent.ExecutorService;
+import java.util.concurrent.Executors;
+import java.util.concurrent.atomic.AtomicInteger;
+import java.util.function.Predicate;
 
 public class COAPNetworkController extends CoapServer {
 
     private static final String LOG = "[CoAP Controller]";
     private static final int COAP_PORT = 5683;
+    // consecutive requests without an answer after which a node is dropped
+    private static final int MAX_FAILURES = 3;
+
+    private final ActuatorRegistry registry = new ActuatorRegistry();
+    // node -> consecutive requests it did not answer
+    private final Map<String, AtomicInteger> failures = new ConcurrentHashMap<>();
+    // "device" of the registration -> node it last registered from
+    private final Map<String, String> devices = new ConcurrentHashMap<>();
+    // one pooled client per endpoint URI, reused by every request to that node
+    private final Map<String, CoapClient> clients = new ConcurrentHashMap<>();
+    // runs response handling off the Californium threads
+    private final ExecutorService callbackExecutor = Executors.newFixedThreadPool(2, r -> {
+        Thread t = new Thread(r, "coap-callbacks");
+        t.setDaemon(true);
+        return t;
+    });
+    private final SampleStore db;
+    private final OscoreContexts oscore; // null = plaintext CoAP
+    private final List<RegistrationListener> registrationListeners = new CopyOnWriteArrayList<>();
+    // actuators this instance may command; all of them unless clustered
+    private volatile Predicate<String> ownership;  // endpoint key -> commanded here; null when not clustered
+
+    private static final Histogram RTT = Metrics.histogram(
+            "smartgarden_coap_rtt_seconds", "Round-trip time of CoAP requests to actuators", "actuator");
+    private static final Counter TIMEOUTS = Metrics.counter(
+            "smartgarden_coap_timeouts_total", "CoAP requests that got no response", "actuator");
+    private static final Counter REMOVED = Metrics.counter("smartgarden_coap_removed_endpoints_total",
+            "Endpoints dropped because their node stopped answering or registered elsewhere", "actuator");
+
+    public COAPNetworkController(List<String> actuatorList, SampleStore db) {
+        this(actuatorList, db, COAP_PORT);
+    }
 
-    private final Map<String, String> actuatorEndpoints = new HashMap<>();
-    private final DBDriver db;
-    private final MQTTHandler mqttHandler;
+    public COAPNetworkController(List<String> actuatorList, SampleStore db, int port) {
+        this(actuatorList, db, port, null);
+    }
 
-    public COAPNetworkController(List<String> actuatorList, DBDriver db, MQTTHandler mqttHandler) {
-        super(COAP_PORT);
+    /**
+     * With oscore, the nodes must register and are commanded over OSCORE.
+     */
+    public COAPNetworkController(List<String> actuatorList, SampleStore db, int port, OscoreContexts oscore) {
         this.db = db;
-        this.mqttHandler = mqttHandler;
+        this.oscore = oscore;
+        addEndpoint(oscore != null ? oscore.newEndpoint(port) : new CoapEndpoint.Builder().setPort(port).build());
 
         add(new RegistrationResource("registration"));
 
-        ConsoleUtils.println(LOG + " CoAP server started on port " + COAP_PORT);
+        ConsoleUtils.println(LOG + " CoAP server started on port " + port + (oscore != null ? " (OSCORE)" : ""));
         start();
     }
 
-    public void sendCommand(String actuatorName, String command) throws ConnectorException, IOException {
-	    String endpoint = actuatorEndpoints.get(actuatorName);
-	    if (endpoint == null) {
-		ConsoleUtils.printError(LOG + " Unknown or unregistered actuator: " + actuatorName);
-		return;
-	    }
-
-	    String c = command == null ? "" : command.toLowerCase().trim();
-	    if ("fertilizer".equals(actuatorName)) {
-		if ("sinc".equals(c))      c = "acidic";
-		else if ("sdec".equals(c)) c = "alkaline";
-		else if (!"acidic".equals(c) && !"alkaline".equals(c) && !"off".equals(c)) {
-		    ConsoleUtils.printError(LOG + " Invalid fertilizer command: " + command);
-		    return;
-		}
-	    }
-
-	    CoapClient client = new CoapClient(endpoint);
-	    CoapResponse response = client.put(c, MediaTypeRegistry.TEXT_PLAIN);
-
-	    if (response != null && response.isSuccess()) {
-    ConsoleUtils.println(LOG + " Command sent to " + actuatorName + ": " + c);
-
-    try {
-        if ("heater".equals(actuatorName) && "on".equalsIgnoreCase(c)) {
-            sendCommand("fan", "off");
-        } else if ("fan".equals(actuatorName) && "on".equalsIgnoreCase(c)) {
-            sendCommand("heater", "off");
-        }
-    } catch (Exception e) {
-        ConsoleUtils.printError(LOG + " Failed to enforce heater/fan mutual exclusion: " + e.getMessage());
-    }
-
-    try {
-        if ("fertilizer".equals(actuatorName)) {
-            int code =
-                "off".equals(c) ? 0 :
-                ("sinc".equals(c) || "acidic".equals(c)) ? 1 :
-                ("sdec".equals(c) || "alkaline".equals(c)) ? 2 : 0;
-            db.insertSample("fertilizer", code, null);
-        } else {
-            float v = "on".equals(c) ? 1f : 0f;
-            db.insertSample(actuatorName, v, null);
+    /**
+     * Adds the resource of a node to the actuators of its type.
+     */
+    public void registerActuator(String actuatorName, String uri) {
+        registerActuator(actuatorName, uri, ActuatorRegistry.DEFAULT_ZONE);
+    }
+
+    /**
+     * Adds the resource of a node in a zone and tells the listeners, whatever
+     * the source (a node, another instance, a snapshot). Returns false when the
+     * resource was already registered in that zone (a registration refresh).
+     */
+    public boolean registerActuator(String actuatorName, String uri, int zone) {
+        ActuatorEndpoint previous = registry.get(uri);
+        ActuatorEndpoint endpoint = registry.register(actuatorName, uri, zone);
+        if (endpoint == previous) return false;
+        ConsoleUtils.println(LOG + " Registered actuator: " + actuatorName + " at " + uri + " (zone " + zone + ")");
+        for (RegistrationListener listener : registrationListeners) {
+            listener.onRegistration(actuatorName, uri, zone);
         }
-    } catch (Exception e) {
-        ConsoleUtils.printError(LOG + " DB persist failed for " + actuatorName + ": " + e.getMessage());
+        return true;
     }
 
-    mqttHandler.sendCommand(actuatorName, c);
-    ConsoleUtils.println(LOG + " MQTT command published to topic: " + actuatorName);
+    /**
+     * Drops a resource from the registry; the listeners are told if it was there.
+     */
+    public boolean removeActuator(String uri) {
+        ActuatorEndpoint endpoint = registry.get(uri);
+        if (endpoint == null || !registry.remove(uri)) return false;
+        CoapClient client = clients.remove(uri);
+        if (client != null) client.shutdown();
+        REMOVED.inc(endpoint.getActuator());
+        for (RegistrationListener listener : registrationListeners) {
+            listener.onRemoval(endpoint.getActuator(), uri);
+        }
+        return true;
+    }
 
-} else {
-    ConsoleUtils.printError(LOG + " Failed to send command to " + actuatorName);
-}
+    /**
+     * Drops every resource of a node (host:port).
+     */
+    public void removeNode(String node, String reason) {
+        failures.remove(node);
+        List<ActuatorEndpoint> endpoints = registry.onNode(node);
+        if (endpoints.isEmpty()) return;
+        ConsoleUtils.println(LOG + " Removing node " + node + ": " + reason);
+        for (ActuatorEndpoint endpoint : endpoints) {
+            removeActuator(endpoint.getUri());
+        }
+    }
+
+    /**
+     * One GET to every registered node; the ones that do not answer are
+     * removed. Used on the endpoints restored from a snapshot.
+     */
+    public void probeNodes() {
+        for (Map.Entry<String, List<ActuatorEndpoint>> entry : registry.byNode().entrySet()) {
+            getActuatorStateAsync(entry.getValue().get(0)).whenComplete((state, e) -> {
+                if (e != null) removeNode(entry.getKey(), "no answer since the restart");
+            });
+        }
+    }
 
+    public ActuatorRegistry getRegistry() {
+        return registry;
     }
 
+    /**
+     * Actuator -> URI of the first node registered for it.
+     */
+    public Map<String, String> getActuatorEndpoints() {
+        Map<String, String> endpoints = new HashMap<>();
+        for (ActuatorEndpoint endpoint : registry.all()) {
+            endpoints.putIfAbsent(endpoint.getActuator(), endpoint.getUri());
+        }
+        return endpoints;
+    }
 
+    /**
+     * URI of the first node registered for the actuator.
+     */
+    public String getEndpoint(String actuatorName) {
+        ActuatorEndpoint endpoint = registry.first(actuatorName);
+        return endpoint == null ? null : endpoint.getUri();
+    }
 
-    public String getActuatorState(String actuatorName) throws ConnectorException, IOException {
-        String endpoint = actuatorEndpoints.get(actuatorName);
-        if (endpoint == null) {
-            ConsoleUtils.printError(LOG + " Unknown or unregistered actuator: " + actuatorName);
-            return null;
+    public void addRegistrationListener(RegistrationListener listener) {
+        registrationListeners.add(listener);
+    }
+
+    /**
+     * Restricts commands to the endpoints whose key ("actuator@node") the
+     * predicate accepts (clustered mode). Reads stay allowed on every endpoint.
+     */
+    public void setOwnership(Predicate<String> ownership) {
+        this.ownership = ownership;
+    }
+
+    /**
+     * Whether this instance commands at least one node of the actuator type
+     * (always true unless clustered).
+     */
+    public boolean owns(String actuatorName) {
+        return ownership == null || !commanded(actuatorName).isEmpty();
+    }
+
+    public boolean owns(String actuatorName, String uri) {
+        Predicate<String> p = ownership;
+        return p == null || p.test(ActuatorEndpoint.keyOf(actuatorName, uri));
+    }
+
+    /**
+     * The registered endpoints of the actuator type this instance commands.
+     */
+    public List<ActuatorEndpoint> commanded(String actuatorName) {
+        List<ActuatorEndpoint> targets = new ArrayList<>(registry.find(actuatorName, ActuatorRegistry.ALL_ZONES));
+        Predicate<String> p = ownership;
+        if (p != null) targets.removeIf(endpoint -> !p.test(endpoint.getKey()));
+        return targets;
+    }
+
+    public void sendCommand(String actuatorName, String command) throws ConnectorException, IOException {
+        await(sendCommandAsync(actuatorName, command));
+    }
+
+    /**
+     * Non-blocking PUT to every node with the actuator that this instance
+     * commands, on the pooled client of each endpoint. The future completes with
+     * true once all of them acknowledged the command. Persistence and the MQTT
+     * mirror are left to the ActuatorCommandBus.
+     */
+    public CompletableFuture<Boolean> sendCommandAsync(String actuatorName, String command) {
+        List<ActuatorEndpoint> targets = commanded(actuatorName);
+        if (targets.isEmpty()) {
+            ConsoleUtils.printError(LOG + " No " + actuatorName + " node registered and commanded here");
+            return CompletableFuture.completedFuture(false);
         }
+        return sendCommandAsync(targets, command);
+    }
 
-        CoapClient client = new CoapClient(endpoint);
-        CoapResponse response = client.get();
+    /**
+     * Same as sendCommandAsync(actuatorName, command), on a set of endpoints
+     * (e.g. registry.find("fan", 3)). The PUTs go out at once.
+     */
+    public CompletableFuture<Boolean> sendCommandAsync(Collection<ActuatorEndpoint> targets, String command) {
+        List<CompletableFuture<Boolean>> results = new ArrayList<>(targets.size());
+        for (ActuatorEndpoint target : targets) {
+            results.add(sendCommandAsync(target.getActuator(), target.getUri(), command).exceptionally(e -> false));
+        }
+        return CompletableFuture.allOf(results.toArray(new CompletableFuture[0]))
+                .thenApply(v -> results.stream().allMatch(CompletableFuture::join));
+    }
 
-        if (response != null && response.isSuccess()) {
-            String payload = response.getResponseText();
-            try {
-                JSONObject json = new JSONObject(payload);
-                if (json.has("mode")) {
-                    return json.getString("mode");
-                } else if (json.has("state")) {
-                    return json.getString("state");
-                } else {
-                    ConsoleUtils.printError(LOG + " Unexpected JSON format in GET response: " + payload);
+    /**
+     * Same as sendCommandAsync(actuatorName, command), on an explicit resource URI.
+     */
+    public CompletableFuture<Boolean> sendCommandAsync(String actuatorName, String endpoint, String command) {
+        if (!owns(actuatorName, endpoint)) {
+            ConsoleUtils.printError(LOG + " Not commanding " + ActuatorEndpoint.keyOf(actuatorName, endpoint)
+                    + ": owned by another instance");
+            return CompletableFuture.completedFuture(false);
+        }
+
+        String c = command == null ? "" : command.toLowerCase().trim();
+        if ("fertilizer".equals(actuatorName)) {
+            if ("sinc".equals(c))      c = "acidic";
+            else if ("sdec".equals(c)) c = "alkaline";
+            else if (!"acidic".equals(c) && !"alkaline".equals(c) && !"off".equals(c)) {
+                ConsoleUtils.printError(LOG + " Invalid fertilizer command: " + command);
+                return CompletableFuture.completedFuture(false);
+            }
+        }
+        final String payload = c;
+
+        Request put = Request.newPut();
+        put.getOptions().setContentFormat(MediaTypeRegistry.TEXT_PLAIN);
+        put.setPayload(payload);
+
+        CompletableFuture<CoapResponse> response = new CompletableFuture<>();
+        clientFor(endpoint).advanced(new ResponseHandler(actuatorName, ActuatorEndpoint.nodeOf(endpoint), response),
+                secure(put));
+
+        return response.thenApplyAsync(r -> {
+            if (r == null || !r.isSuccess()) {
+                ConsoleUtils.printError(LOG + " Failed to send command to " + actuatorName);
+                return false;
+            }
+            ConsoleUtils.debug(LOG + " Command sent to " + actuatorName + ": " + payload);
+            return true;
+        }, callbackExecutor);
+    }
+
+    public String getActuatorState(String actuatorName) throws ConnectorException, IOException {
+        return await(getActuatorStateAsync(actuatorName));
+    }
+
+    /**
+     * Non-blocking GET of the actuator state ("mode" or "state" field) from
+     * every node with the actuator commanded here, the same targets as
+     * sendCommandAsync. The future completes with null when the actuator is
+     * unknown, a node answers with an error or the nodes disagree, and
+     * exceptionally when a node cannot be reached.
+     */
+    public CompletableFuture<String> getActuatorStateAsync(String actuatorName) {
+        List<ActuatorEndpoint> targets = commanded(actuatorName);
+        if (targets.isEmpty()) {
+            ConsoleUtils.printError(LOG + " No " + actuatorName + " node registered and commanded here");
+            return CompletableFuture.completedFuture(null);
+        }
+        if (targets.size() == 1) return getActuatorStateAsync(targets.get(0));
+
+        List<CompletableFuture<String>> states = new ArrayList<>(targets.size());
+        for (ActuatorEndpoint target : targets) {
+            states.add(getActuatorStateAsync(target));
+        }
+        return CompletableFuture.allOf(states.toArray(new CompletableFuture[0])).thenApply(v -> {
+            String state = states.get(0).join();
+            for (CompletableFuture<String> other : states) {
+                if (state == null || !state.equalsIgnoreCase(other.join())) {
+                    ConsoleUtils.debug(LOG + " The " + actuatorName + " nodes are not in the same state");
                     return null;
                 }
-            } catch (Exception e) {
-                ConsoleUtils.printError(LOG + " Failed to parse actuator GET response: " + payload);
-                e.printStackTrace();
+            }
+            return state;
+        });
+    }
+
+    /**
+     * Same as getActuatorStateAsync(actuatorName), on one node.
+     */
+    public CompletableFuture<String> getActuatorStateAsync(ActuatorEndpoint endpoint) {
+        CompletableFuture<CoapResponse> response = new CompletableFuture<>();
+        clientFor(endpoint.getUri()).advanced(new ResponseHandler(endpoint.getActuator(), endpoint.getNode(), response),
+                secure(Request.newGet()));
+
+        return response.thenApply(r -> parseState(endpoint, r));
+    }
+
+    /**
+     * Issues one GET per actuator at once; a sweep is bounded by the slowest node.
+     */
+    public Map<String, CompletableFuture<String>> getActuatorStatesAsync(List<String> actuatorNames) {
+        Map<String, CompletableFuture<String>> states = new LinkedHashMap<>();
+        for (String name : actuatorNames) {
+            states.put(name, getActuatorStateAsync(name));
+        }
+        return states;
+    }
+
+    /**
+     * One GET per endpoint at once, e.g. on registry.find("fan", 3).
+     */
+    public Map<ActuatorEndpoint, CompletableFuture<String>> getActuatorStatesAsync(Collection<ActuatorEndpoint> endpoints) {
+        Map<ActuatorEndpoint, CompletableFuture<String>> states = new LinkedHashMap<>();
+        for (ActuatorEndpoint endpoint : endpoints) {
+            states.put(endpoint, getActuatorStateAsync(endpoint));
+        }
+        return states;
+    }
+
+    private String parseState(ActuatorEndpoint endpoint, CoapResponse response) {
+        if (response == null || !response.isSuccess()) {
+            ConsoleUtils.printError(LOG + " Failed to GET from actuator: " + endpoint);
+            return null;
+        }
+
+        String payload = response.getResponseText();
+        try {
+            JSONObject json = new JSONObject(payload);
+            if (json.has("mode")) {
+                return json.getString("mode");
+            } else if (json.has("state")) {
+                return json.getString("state");
+            } else {
+                ConsoleUtils.printError(LOG + " Unexpected JSON format in GET response: " + payload);
                 return null;
             }
-        } else {
-            ConsoleUtils.printError(LOG + " Failed to GET from actuator: " + actuatorName);
+        } catch (Exception e) {
+            ConsoleUtils.printError(LOG + " Failed to parse actuator GET response: " + payload);
+            e.printStackTrace();
             return null;
         }
     }
 
-    public void triggerHeater(boolean on) throws ConnectorException, IOException {
-        sendCommand("heater", on ? "on" : "off");
+    private CoapClient clientFor(String endpoint) {
+        return clients.computeIfAbsent(endpoint, this::newClient);
+    }
+
+    /**
+     * Client for a node resource, on the OSCORE endpoint when OSCORE is on.
+     */
+    public CoapClient newClient(String uri) {
+        CoapClient client = new CoapClient(uri);
+        if (oscore != null) client.setEndpoint(getEndpoints().get(0));
+        return client;
+    }
+
+    /**
+     * Marks a request to a node for OSCORE protection when OSCORE is on.
+     */
+    public Request secure(Request request) {
+        if (oscore == null) return request;
+        oscore.reserveSequenceNumbers();
+        return OscoreContexts.protect(request);
+    }
+
+    public boolean usesOscore() {
+        return oscore != null;
+    }
+
+    /**
+     * Node (host:port) -> OSCORE id of the registered nodes; empty without OSCORE.
+     */
+    public Map<String, Integer> getOscoreBindings() {
+        return oscore != null ? oscore.getBindings() : Map.of();
+    }
+
+    public void bindOscore(String node, int id) {
+        if (oscore != null && !oscore.bind(node, id)) {
+            ConsoleUtils.printError(LOG + " No OSCORE context for node " + id + " (" + node + ")");
+        }
+    }
+
+    private static <T> T await(CompletableFuture<T> future) throws IOException {
+        try {
+            return future.get();
+        } catch (InterruptedException e) {
+            Thread.currentThread().interrupt();
+            throw new IOException("Interrupted while waiting for CoAP response", e);
+        } catch (ExecutionException e) {
+            Throwable cause = e.getCause();
+            if (cause instanceof IOException) throw (IOException) cause;
+            throw new IOException(cause);
+        }
     }
 
-    public void triggerFan(boolean on) throws ConnectorException, IOException {
-        sendCommand("fan", on ? "on" : "off");
+    /**
+     * Bridges the Californium callback into a CompletableFuture, records the
+     * round-trip time of the request and drops a node after MAX_FAILURES
+     * requests in a row without an answer.
+     */
+    private class ResponseHandler implements CoapHandler {
+
+        private final String actuatorName;
+        private final String node;
+        private final CompletableFuture<CoapResponse> future;
+        private final long start = System.nanoTime();
+
+        ResponseHandler(String actuatorName, String node, CompletableFuture<CoapResponse> future) {
+            this.actuatorName = actuatorName;
+            this.node = node;
+            this.future = future;
+        }
+
+        @Override
+        public void onLoad(CoapResponse response) {
+            RTT.observeSince(actuatorName, start);
+            failures.remove(node);
+            future.complete(response);
+        }
+
+        @Override
+        public void onError() {
+            TIMEOUTS.inc(actuatorName);
+            if (failures.computeIfAbsent(node, n -> new AtomicInteger()).incrementAndGet() >= MAX_FAILURES) {
+                callbackExecutor.execute(() -> removeNode(node, MAX_FAILURES + " requests without an answer"));
+            }
+            future.completeExceptionally(new IOException("CoAP request failed or timed out"));
+        }
     }
-    
+
     public void logModeEvent(String actuator, String mode) {
 	  try { db.insertModeEvent(actuator, mode); }
 	  catch (Exception e) {
@@ -147,6 +468,11 @@ public class COAPNetworkController extends CoapServer {
     }
 
     public void close() {
+        for (CoapClient client : clients.values()) {
+            client.shutdown();
+        }
+        clients.clear();
+        callbackExecutor.shutdown();
         this.stop();
         this.destroy();
         ConsoleUtils.println(LOG + " CoAP server shut down.");
@@ -162,9 +488,19 @@ public class COAPNetworkController extends CoapServer {
         @Override
         public void handlePOST(CoapExchange exchange) {
             String sourceIP = exchange.getSourceAddress().getHostAddress();
+            // nodes answer on the port they registered from (5683 on the dongles)
+            String host = sourceIP.contains(":") ? "[" + sourceIP + "]" : sourceIP;
+            int sourcePort = exchange.getSourcePort();
             String payload = new String(exchange.getRequestPayload(), StandardCharsets.UTF_8);
 
-            ConsoleUtils.println(LOG + " Registration received from " + sourceIP + ": " + payload);
+            // nodes renew their registration every few minutes
+            ConsoleUtils.debug(LOG + " Registration received from " + sourceIP + ": " + payload);
+
+            // the OSCORE layer has already verified the request if it carries the option
+            if (oscore != null && !exchange.advanced().getRequest().getOptions().hasOscore()) {
+                exchange.respond(CoAP.ResponseCode.UNAUTHORIZED, "OSCORE required.");
+                return;
+            }
 
             try {
                 JSONObject json = new JSONObject(payload);
@@ -173,14 +509,29 @@ public class COAPNetworkController extends CoapServer {
                     exchange.respond(CoAP.ResponseCode.BAD_REQUEST, "Invalid registration payload.");
                     return;
                 }
+                // the node is who its verified context says, whatever the payload claims
+                if (oscore != null && !oscore.bindVerified(host + ":" + sourcePort,
+                        OscoreContexts.idOf(exchange.advanced().getCryptographicContextID()),
+                        exchange.advanced().getRequest().getOptions().getOscore())) {
+                    exchange.respond(CoAP.ResponseCode.FORBIDDEN, "Unknown OSCORE id.");
+                    return;
+                }
+
+                // the same node at a new address: its old resources are gone
+                String node = host + ":" + sourcePort;
+                String before = devices.put(json.getString("device"), node);
+                if (before != null && !before.equals(node)) {
+                    removeNode(before, "registered again from " + node);
+                }
+                failures.remove(node);
 
                 JSONArray resources = json.getJSONArray("resources");
+                int zone = json.optInt("zone", ActuatorRegistry.DEFAULT_ZONE);
                 for (int i = 0; i < resources.length(); i++) {
                     String path = resources.getString(i);
-                    String fullUri = "coap://[" + sourceIP + "]:5683/" + path;
-		    actuatorEndpoints.put(path, fullUri);
-		    ConsoleUtils.println(LOG + " Registered actuator: " + path + " at " + fullUri);
-		    
+                    String fullUri = "coap://" + node + "/" + path;
+		    if (!registerActuator(path, fullUri, zone)) continue;  // refresh, nothing changed
+
 		    try {
 			db.insertModeEvent(path, "auto");
 
@@ -195,7 +546,8 @@ public class COAPNetworkController extends CoapServer {
 		    }
                 }
 
-                exchange.respond(CoAP.ResponseCode.CREATED, "Success");
+                // the controller clock follows, the node timestamps its representations with it
+                exchange.respond(CoAP.ResponseCode.CREATED, "Success " + System.currentTimeMillis());
 
             } catch (Exception e) {
                 ConsoleUtils.printError(LOG + " Error while registering: " + e.getMessage());
@@ -0,0 +1,327 @@
+package org.unipi.smartgarden.coap;
+
+import org.eclipse.californium.core.CoapClient;
+import org.eclipse.californium.core.CoapHandler;
+import org.eclipse.californium.core.CoapObserveRelation;
+import org.eclipse.californium.core.CoapResponse;
+import org.eclipse.californium.core.coap.CoAP;
+import org.eclipse.californium.core.coap.MediaTypeRegistry;
+import org.eclipse.californium.core.coap.Request;
+import org.json.JSONObject;
+import org.unipi.smartgarden.metrics.Counter;
+import org.unipi.smartgarden.metrics.DeliveryStats;
+import org.unipi.smartgarden.metrics.Histogram;
+import org.unipi.smartgarden.metrics.Metrics;
+import org.unipi.smartgarden.util.ConsoleUtils;
+
+import java.util.ArrayList;
+import java.util.HashSet;
+import java.util.List;
+import java.util.Map;
+import java.util.Set;
+import java.util.TreeMap;
+import java.util.concurrent.CompletableFuture;
+import java.util.concurrent.ConcurrentHashMap;
+import java.util.concurrent.CopyOnWriteArrayList;
+import java.util.concurrent.Executors;
+import java.util.concurrent.ScheduledExecutorService;
+import java.util.concurrent.TimeUnit;
+
+/**
+ * CoapGroupCommander - Commands every node of an actuator type at once with a
+ * single non-confirmable PUT to an IPv6 multicast group, instead of one
+ * confirmable PUT per node.
+ *
+ * Nodes join ff05::5347:[zone]:[type] for their zone and for zone 0 (the whole
+ * garden). The commander observes the member resources this instance owns,
+ * so each node holds one relation per resource whatever the cluster size, and
+ * counts a member as done when its notification reports the requested state;
+ * members still missing after CONFIRM_TIMEOUT_MS get a unicast PUT.
+ *
+ * Plain OSCORE cannot protect a multicast request: when the controller runs
+ * with OSCORE the group PUT is skipped and every member gets the unicast PUT.
+ * The same goes for a group with members owned by another instance, which the
+ * multicast would reach too.
+ */
+public class CoapGroupCommander implements RegistrationListener {
+
+    private static final String LOG = "[CoAP Groups]";
+
+    public static final int DEFAULT_ZONE = ActuatorRegistry.DEFAULT_ZONE;
+    public static final int ALL_ZONES = ActuatorRegistry.ALL_ZONES;
+
+    // group id of each actuator type, the last 16 bits of the group address
+    private static final List<String> TYPES = List.of("fertilizer", "irrigation", "grow_light", "fan", "heater");
+    private static final String GROUP_PREFIX = "ff05::5347:";
+
+    private static final long CONFIRM_TIMEOUT_MS = 3000;
+
+    /**
+     * How a group command ended: every member brought to the state, every
+     * member already in it (nothing sent), no known member in the group, or
+     * some member not brought to it even by unicast.
+     */
+    public enum Outcome { APPLIED, UNCHANGED, NO_MEMBERS, FAILED }
+
+    private static final Counter GROUP_COMMANDS = Metrics.counter(
+            "smartgarden_group_commands_total", "Multicast group commands sent", "actuator");
+    private static final Counter FALLBACKS = Metrics.counter(
+            "smartgarden_group_fallbacks_total", "Group members commanded by unicast after no confirmation", "actuator");
+    private static final Histogram CONFIRM_TIME = Metrics.histogram(
+            "smartgarden_group_confirm_seconds", "Group command to the last member notification", "actuator");
+
+    private final COAPNetworkController coapController;
+
+    // member resource URI -> member
+    private final Map<String, Member> members = new ConcurrentHashMap<>();
+    private final List<PendingGroupCommand> pending = new CopyOnWriteArrayList<>();
+
+    private final ScheduledExecutorService scheduler = Executors.newSingleThreadScheduledExecutor(r -> {
+        Thread t = new Thread(r, "coap-groups");
+        t.setDaemon(true);
+        return t;
+    });
+
+    public CoapGroupCommander(COAPNetworkController coapController) {
+        this.coapController = coapController;
+        coapController.addRegistrationListener(this);
+    }
+
+    @Override
+    public void onRegistration(String actuatorName, String uri) {
+        onRegistration(actuatorName, uri, DEFAULT_ZONE);
+    }
+
+    @Override
+    public void onRegistration(String actuatorName, String uri, int zone) {
+        if (!TYPES.contains(actuatorName)) return;
+
+        Member member = new Member(actuatorName, uri, zone);
+        Member previous = members.put(uri, member);
+        if (previous != null) previous.cancel();
+        if (coapController.owns(actuatorName, uri)) member.observe();
+    }
+
+    /**
+     * Observes the members of the actuators this instance now owns and drops
+     * the relations of those it handed over.
+     */
+    public void onOwnershipChanged() {
+        for (Member member : members.values()) {
+            if (coapController.owns(member.actuatorName, member.uri)) {
+                member.observe();
+            } else {
+                member.stopObserving();
+            }
+        }
+    }
+
+    @Override
+    public void onRemoval(String actuatorName, String uri) {
+        Member member = members.remove(uri);
+        if (member != null) member.cancel();
+    }
+
+    /**
+     * URI of the group of an actuator type in a zone (ALL_ZONES for the whole garden).
+     */
+    public static String groupUri(String actuatorName, int zone) {
+        int type = TYPES.indexOf(actuatorName) + 1;
+        return "coap://[" + GROUP_PREFIX + Integer.toHexString(zone) + ":" + Integer.toHexString(type) + "]/"
+                + actuatorName;
+    }
+
+    /**
+     * Sets every member of the group to state ("on", "off", "acidic", "alkaline").
+     * The future completes with APPLIED once every member reported the state,
+     * with FAILED if some member could not be brought to it even by unicast.
+     */
+    public CompletableFuture<Outcome> sendGroupCommand(String actuatorName, int zone, String state) {
+        if (!TYPES.contains(actuatorName)) {
+            ConsoleUtils.printError(LOG + " Unknown actuator type: " + actuatorName);
+            return CompletableFuture.completedFuture(Outcome.FAILED);
+        }
+        int known = 0;
+        int foreign = 0;  // commanded by another instance
+        Set<String> waiting = new HashSet<>();
+        for (Member member : members.values()) {
+            if (!member.in(actuatorName, zone)) continue;
+            if (!coapController.owns(actuatorName, member.uri)) {
+                foreign++;
+                continue;
+            }
+            known++;
+            // a member that never notified counts as not in the state
+            if (!state.equals(member.state)) waiting.add(member.uri);
+        }
+        if (known == 0 && foreign > 0) {
+            ConsoleUtils.printError(LOG + " Not commanding " + actuatorName + ": owned by other instances");
+            return CompletableFuture.completedFuture(Outcome.FAILED);
+        }
+        if (known == 0) {
+            return CompletableFuture.completedFuture(Outcome.NO_MEMBERS);
+        }
+        if (waiting.isEmpty()) {
+            return CompletableFuture.completedFuture(Outcome.UNCHANGED);
+        }
+
+        PendingGroupCommand command = new PendingGroupCommand(actuatorName, state, waiting);
+        pending.add(command);
+        CompletableFuture<Outcome> outcome = command.result.thenApply(ok -> ok ? Outcome.APPLIED : Outcome.FAILED);
+        // the multicast would also reach the members of other instances
+        if (coapController.usesOscore() || foreign > 0) {
+            fallback(command);
+            return outcome;
+        }
+
+        Request put = Request.newPut();
+        put.setURI(groupUri(actuatorName, zone));
+        put.setType(CoAP.Type.NON);
+        put.getOptions().setContentFormat(MediaTypeRegistry.TEXT_PLAIN);
+        put.setPayload(state);
+        put.send(coapController.getEndpoints().get(0));
+
+        GROUP_COMMANDS.inc(actuatorName);
+        ConsoleUtils.debug(LOG + " " + actuatorName + " zone " + zone + " -> " + state
+                + " (" + waiting.size() + " members to confirm)");
+
+        scheduler.schedule(() -> fallback(command), CONFIRM_TIMEOUT_MS, TimeUnit.MILLISECONDS);
+        return outcome;
+    }
+
+    // members that did not notify the new state in time get a confirmable unicast PUT
+    private void fallback(PendingGroupCommand command) {
+        List<String> missing;
+        synchronized (command) {
+            if (command.result.isDone()) return;
+            missing = new ArrayList<>(command.waiting);
+        }
+        pending.remove(command);
+
+        List<CompletableFuture<Boolean>> retries = new ArrayList<>();
+        for (String uri : missing) {
+            FALLBACKS.inc(command.actuatorName);
+            retries.add(coapController.sendCommandAsync(command.actuatorName, uri, command.state)
+                    .exceptionally(e -> false));
+        }
+        ConsoleUtils.println(LOG + " " + missing.size() + " " + command.actuatorName
+                + " members did not confirm, retrying by unicast");
+
+        CompletableFuture.allOf(retries.toArray(new CompletableFuture[0])).thenRun(() -> {
+            boolean ok = retries.stream().allMatch(CompletableFuture::join);
+            command.result.complete(ok);
+        });
+    }
+
+    private void onNotification(Member member, String state) {
+        member.state = state;
+        for (PendingGroupCommand command : pending) {
+            if (!command.actuatorName.equals(member.actuatorName) || !command.state.equals(state)) continue;
+
+            boolean done;
+            synchronized (command) {
+                done = command.waiting.remove(member.uri) && command.waiting.isEmpty();
+            }
+            if (done) {
+                pending.remove(command);
+                CONFIRM_TIME.observeSince(command.actuatorName, command.start);
+                command.result.complete(true);
+            }
+        }
+    }
+
+    /**
+     * Zone -> "actuator@uri: state" of every member, for the CLI.
+     */
+    public Map<Integer, List<String>> describeMembers() {
+        Map<Integer, List<String>> byZone = new TreeMap<>();
+        for (Member member : members.values()) {
+            byZone.computeIfAbsent(member.zone, z -> new ArrayList<>())
+                    .add(member.actuatorName + "@" + member.uri + ": " + member.state);
+        }
+        return byZone;
+    }
+
+    public void close() {
+        scheduler.shutdownNow();
+        for (Member member : members.values()) {
+            member.cancel();
+        }
+        members.clear();
+    }
+
+    private class Member implements CoapHandler {
+
+        private final String actuatorName;
+        private final String uri;
+        private final String stream;  // delivery tracking: the representations of one resource
+        private final int zone;
+        private final CoapClient client;
+        private CoapObserveRelation relation;
+        private volatile String state;  // null until the first notification
+
+        Member(String actuatorName, String uri, int zone) {
+            this.actuatorName = actuatorName;
+            this.uri = uri;
+            this.stream = ActuatorEndpoint.nodeOf(uri) + "/" + actuatorName;
+            this.zone = zone;
+            this.client = coapController.newClient(uri);
+        }
+
+        boolean in(String actuator, int groupZone) {
+            return actuatorName.equals(actuator) && (groupZone == ALL_ZONES || zone == groupZone);
+        }
+
+        synchronized void observe() {
+            if (relation != null) return;
+            relation = client.observe(coapController.secure(Request.newGet().setObserve()), this);
+        }
+
+        synchronized void stopObserving() {
+            if (relation == null) return;
+            relation.proactiveCancel();
+            relation = null;
+        }
+
+        void cancel() {
+            stopObserving();
+            client.shutdown();
+        }
+
+        @Override
+        public void onLoad(CoapResponse response) {
+            if (response == null || !response.isSuccess()) return;
+            try {
+                JSONObject json = new JSONObject(response.getResponseText());
+                if (json.has("seq")) {
+                    DeliveryStats.record(stream, json.getLong("seq"), json.optLong("ts", 0),
+                            System.currentTimeMillis());
+                }
+                String mode = json.optString("mode", json.optString("state", null));
+                if (mode != null) onNotification(this, mode.toLowerCase());
+            } catch (Exception e) {
+                ConsoleUtils.debug(LOG + " Unparsable notification from " + uri);
+            }
+        }
+
+        @Override
+        public void onError() {
+            ConsoleUtils.debug(LOG + " Observe of " + uri + " failed");
+        }
+    }
+
+    private static class PendingGroupCommand {
+
+        private final String actuatorName;
+        private final String state;
+        private final Set<String> waiting;  // guarded by this
+        private final long start = System.nanoTime();
+        private final CompletableFuture<Boolean> result = new CompletableFuture<>();
+
+        PendingGroupCommand(String actuatorName, String state, Set<String> waiting) {
+            this.actuatorName = actuatorName;
+            this.state = state;
+            this.waiting = waiting;
+        }
+    }
+}
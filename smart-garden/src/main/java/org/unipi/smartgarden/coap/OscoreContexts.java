@@ -0,0 +1,362 @@
+package org.unipi.smartgarden.coap;
+
+import com.google.gson.Gson;
+import org.eclipse.californium.core.coap.Request;
+import org.eclipse.californium.core.network.CoapEndpoint;
+import org.eclipse.californium.cose.AlgorithmID;
+import org.eclipse.californium.elements.util.Bytes;
+import org.eclipse.californium.elements.util.StringUtil;
+import org.eclipse.californium.oscore.CoapOSException;
+import org.eclipse.californium.oscore.HashMapCtxDB;
+import org.eclipse.californium.oscore.OSCoreCoapStackFactory;
+import org.eclipse.californium.oscore.OSCoreCtx;
+import org.eclipse.californium.oscore.OSException;
+import org.unipi.smartgarden.configuration.OscoreConfig;
+import org.unipi.smartgarden.util.ConsoleUtils;
+
+import java.io.IOException;
+import java.io.Reader;
+import java.io.Writer;
+import java.nio.charset.StandardCharsets;
+import java.nio.file.Files;
+import java.nio.file.Path;
+import java.nio.file.StandardCopyOption;
+import java.util.ArrayList;
+import java.util.Arrays;
+import java.util.Collection;
+import java.util.HashMap;
+import java.util.HashSet;
+import java.util.List;
+import java.util.Map;
+import java.util.Set;
+import java.util.TreeMap;
+import java.util.TreeSet;
+import java.util.concurrent.ConcurrentHashMap;
+
+/**
+ * OscoreContexts - OSCORE (RFC 8613) security contexts for the CoAP nodes built
+ * with MAKE_WITH_OSCORE=1. Every node and the controller share the master
+ * secret and salt; a node is told apart by its OSCORE id (make OSCORE_ID=n),
+ * its Sender ID. The controller's Sender ID is CONTROLLER_ID towards every node.
+ *
+ * No (key, nonce) pair is ever used twice across restarts:
+ * <ul>
+ *   <li>a node picks a fresh random ID Context at every boot (Appendix B.2), so
+ *   each boot has its own keys and may start its sequence numbers at 0. The
+ *   context is derived here when the first request under it arrives, and
+ *   stays tentative until a request verified under it binds the node: only
+ *   then does it replace the session of the earlier boot. ID Contexts seen
+ *   before are refused, so an old registration cannot be replayed under a
+ *   re-derived context.</li>
+ *   <li>the controller keeps its own sender sequence numbers in the state file
+ *   (Appendix B.1): it writes a limit SEQ_RESERVE ahead of the number in use,
+ *   and resumes from the limit after a restart. The last seen recipient
+ *   sequence number is kept too, for the replay window.</li>
+ * </ul>
+ */
+public class OscoreContexts {
+
+    private static final String LOG = "[OSCORE]";
+
+    public static final byte CONTROLLER_ID = 0x00;
+
+    private static final AlgorithmID AEAD = AlgorithmID.AES_CCM_16_64_128;
+    private static final AlgorithmID HKDF = AlgorithmID.HKDF_HMAC_SHA_256;
+    private static final int REPLAY_WINDOW = 32;
+    private static final int MAX_UNFRAGMENTED_SIZE = 1024;
+    // ID Context of a node: its OSCORE id and 8 random bytes drawn at boot
+    private static final int ID_CONTEXT_LENGTH = 9;
+    // sender sequence numbers reserved by each write of the state file
+    private static final int SEQ_RESERVE = 256;
+    private static final int SEEN_CONTEXTS = 64;
+
+    private final byte[] masterSecret;
+    private final byte[] masterSalt;
+    private final Set<Integer> nodeIds;
+    private final Path stateFile;  // null: nothing persisted (benchmarks)
+    private final Gson gson = new Gson();
+    private final NodeCtxDB db = new NodeCtxDB();
+
+    // OSCORE id -> context of the node's current boot (guarded by this)
+    private final Map<Integer, Session> sessions = new HashMap<>();
+    // OSCORE id -> context derived for a new ID Context, nothing verified under it yet (guarded by this)
+    private final Map<Integer, Session> tentative = new HashMap<>();
+    // OSCORE id -> ID Contexts (hex) of its earlier boots (guarded by this)
+    private final Map<Integer, List<String>> seen = new HashMap<>();
+    // node (host:port) -> OSCORE id, bound on verified registrations
+    private final Map<String, Integer> bindings = new ConcurrentHashMap<>();
+
+    public OscoreContexts(byte[] masterSecret, byte[] masterSalt, Collection<Integer> nodeIds, Path stateFile) {
+        for (int id : nodeIds) {
+            if (id <= 0 || id > 255) throw new IllegalArgumentException("OSCORE id out of range: " + id);
+        }
+        this.masterSecret = masterSecret;
+        this.masterSalt = masterSalt;
+        this.nodeIds = new HashSet<>(nodeIds);
+        this.stateFile = stateFile;
+        load();
+        ConsoleUtils.println(LOG + " Nodes " + new TreeSet<>(this.nodeIds) + ", "
+                + sessions.size() + " security contexts restored");
+    }
+
+    /**
+     * The contexts of the configuration, or null when OSCORE is off.
+     */
+    public static OscoreContexts of(OscoreConfig config, Path stateFile) {
+        if (config == null || !config.isEnabled()) return null;
+        return new OscoreContexts(StringUtil.hex2ByteArray(config.getMasterSecret()),
+                StringUtil.hex2ByteArray(config.getMasterSalt()), config.getNodes(), stateFile);
+    }
+
+    /**
+     * Endpoint protecting the requests that carry the OSCORE option and
+     * unprotecting the incoming ones.
+     */
+    public CoapEndpoint newEndpoint(int port) {
+        return new CoapEndpoint.Builder()
+                .setPort(port)
+                .setCustomCoapStackArgument(db)
+                .setCoapStackFactory(new OSCoreCoapStackFactory())
+                .build();
+    }
+
+    /**
+     * Marks a request to be protected with the context of its destination.
+     */
+    public static Request protect(Request request) {
+        request.getOptions().setOscore(Bytes.EMPTY);
+        return request;
+    }
+
+    /**
+     * Derives a tentative context for the ID Context of a new node boot, so the
+     * request carrying it can be verified. False if the id is not provisioned,
+     * the ID Context is malformed or was already used by an earlier boot.
+     */
+    public synchronized boolean deriveSession(int id, byte[] idContext) {
+        if (!nodeIds.contains(id) || idContext == null || idContext.length != ID_CONTEXT_LENGTH
+                || (idContext[0] & 0xff) != id) {
+            return false;
+        }
+        String hex = StringUtil.byteArray2Hex(idContext);
+        Session current = sessions.get(id);
+        if (current != null && current.idContext.equals(hex)) return true;
+        Session pending = tentative.get(id);
+        if (pending != null && pending.idContext.equals(hex)) return true;
+        if (seen.getOrDefault(id, List.of()).contains(hex)) {
+            ConsoleUtils.printError(LOG + " Node " + id + " reused the ID Context of an earlier boot, refused");
+            return false;
+        }
+
+        Session session;
+        try {
+            session = new Session(id, hex, 0, 0);
+        } catch (OSException e) {
+            ConsoleUtils.printError(LOG + " Cannot derive the context of node " + id + ": " + e.getMessage());
+            return false;
+        }
+        // one tentative context per node: a forged ID Context only displaces another unverified one
+        if (pending != null) db.removeContext(pending.ctx);
+        tentative.put(id, session);
+        db.addContext(session.ctx);
+        ConsoleUtils.debug(LOG + " Tentative context of node " + id + " (ID Context " + hex + ")");
+        return true;
+    }
+
+    /**
+     * Binds node (host:port) after a request from it passed verification under
+     * the context of OSCORE id: if that was the tentative context of a new
+     * boot, it becomes the node's session and the one of the earlier boot is
+     * retired. oscoreOption is the value of the request's OSCORE option.
+     */
+    public synchronized boolean bindVerified(String node, int id, byte[] oscoreOption) {
+        Session pending = tentative.get(id);
+        String idContext = idContextOf(oscoreOption);
+        if (pending != null && pending.idContext.equals(idContext)) {
+            tentative.remove(id);
+            Session current = sessions.put(id, pending);
+            if (current != null) {
+                db.removeContext(current.ctx);
+                List<String> earlier = seen.computeIfAbsent(id, k -> new ArrayList<>());
+                earlier.add(current.idContext);
+                if (earlier.size() > SEEN_CONTEXTS) earlier.remove(0);
+            }
+            for (Map.Entry<String, Integer> binding : bindings.entrySet()) {
+                if (binding.getValue() == id) addUri(binding.getKey(), pending.ctx);
+            }
+            ConsoleUtils.println(LOG + " New session of node " + id + " (ID Context " + idContext + ")");
+        }
+        return bind(node, id);
+    }
+
+    /**
+     * Uses the current context of OSCORE id for the requests to node (host:port);
+     * false if the node has no session.
+     */
+    public synchronized boolean bind(String node, int id) {
+        Session session = sessions.get(id);
+        if (session == null) return false;
+        if (!addUri(node, session.ctx)) return false;
+        bindings.put(node, id);
+        save();
+        return true;
+    }
+
+    // kid context (hex) of an OSCORE option value (RFC 8613 6.1), null if it has none
+    private static String idContextOf(byte[] option) {
+        if (option == null || option.length == 0) return null;
+        int flags = option[0] & 0xff;
+        int offset = 1 + (flags & 0x07);  // partial IV
+        if ((flags & 0x10) == 0 || offset >= option.length) return null;
+        int length = option[offset] & 0xff;
+        if (offset + 1 + length > option.length) return null;
+        return StringUtil.byteArray2Hex(Arrays.copyOfRange(option, offset + 1, offset + 1 + length));
+    }
+
+    /**
+     * OSCORE id of the context that verified a request, from its Recipient ID
+     * (the node's Sender ID); -1 if there is none.
+     */
+    public static int idOf(byte[] recipientId) {
+        return recipientId != null && recipientId.length == 1 ? recipientId[0] & 0xff : -1;
+    }
+
+    /**
+     * Moves the persisted sequence number limit ahead before the controller
+     * gets close to it. Called before every protected request.
+     */
+    public synchronized void reserveSequenceNumbers() {
+        boolean moved = false;
+        for (Session session : sessions.values()) {
+            if (session.ctx.getSenderSeq() + SEQ_RESERVE / 2 >= session.seqLimit) {
+                session.seqLimit = session.ctx.getSenderSeq() + SEQ_RESERVE;
+                moved = true;
+            }
+        }
+        if (moved) save();
+    }
+
+    /**
+     * Node (host:port) -> OSCORE id, for the snapshot.
+     */
+    public Map<String, Integer> getBindings() {
+        return new TreeMap<>(bindings);
+    }
+
+    /**
+     * Writes the current limits and replay state, e.g. at shutdown.
+     */
+    public synchronized void save() {
+        if (stateFile == null) return;
+        State state = new State();
+        for (Session session : sessions.values()) {
+            state.sessions.add(new SavedSession(session.id, session.idContext, session.seqLimit,
+                    session.ctx.getReceiverSeq()));
+        }
+        state.seen = new HashMap<>(seen);
+
+        Path tmp = stateFile.resolveSibling(stateFile.getFileName() + ".tmp");
+        try {
+            try (Writer writer = Files.newBufferedWriter(tmp, StandardCharsets.UTF_8)) {
+                gson.toJson(state, writer);
+            }
+            Files.move(tmp, stateFile, StandardCopyOption.REPLACE_EXISTING, StandardCopyOption.ATOMIC_MOVE);
+        } catch (IOException e) {
+            ConsoleUtils.printError(LOG + " Failed to write " + stateFile + ": " + e.getMessage());
+        }
+    }
+
+    private void load() {
+        if (stateFile == null || !Files.exists(stateFile)) return;
+        State state;
+        try (Reader reader = Files.newBufferedReader(stateFile, StandardCharsets.UTF_8)) {
+            state = gson.fromJson(reader, State.class);
+        } catch (Exception e) {
+            throw new IllegalStateException("Cannot read " + stateFile
+                    + ": delete it and restart the nodes to start new sessions", e);
+        }
+        if (state == null) return;
+        if (state.seen != null) seen.putAll(state.seen);
+        for (SavedSession saved : state.sessions) {
+            if (!nodeIds.contains(saved.id)) continue;
+            try {
+                // everything below the limit may have been used before the restart
+                Session session = new Session(saved.id, saved.idContext, saved.seqLimit, saved.receiverSeq);
+                sessions.put(saved.id, session);
+                db.addContext(session.ctx);
+            } catch (OSException e) {
+                ConsoleUtils.printError(LOG + " Cannot restore the context of node " + saved.id + ": " + e.getMessage());
+            }
+        }
+        // nothing above the old limits is used until the new ones are on disk
+        for (Session session : sessions.values()) {
+            session.seqLimit = session.ctx.getSenderSeq() + SEQ_RESERVE;
+        }
+        save();
+    }
+
+    private boolean addUri(String node, OSCoreCtx ctx) {
+        try {
+            db.addContext("coap://" + node, ctx);
+            return true;
+        } catch (OSException e) {
+            ConsoleUtils.printError(LOG + " Cannot bind " + node + ": " + e.getMessage());
+            return false;
+        }
+    }
+
+    private final class Session {
+
+        final int id;
+        final String idContext;  // hex
+        final OSCoreCtx ctx;
+        int seqLimit;            // persisted: no sender sequence number at or above it was used
+
+        Session(int id, String idContext, int senderSeq, int receiverSeq) throws OSException {
+            byte[] nodeId = {(byte) id};
+            this.id = id;
+            this.idContext = idContext;
+            this.ctx = new OSCoreCtx(masterSecret, true, AEAD, new byte[]{CONTROLLER_ID}, nodeId, HKDF,
+                    REPLAY_WINDOW, masterSalt, StringUtil.hex2ByteArray(idContext), MAX_UNFRAGMENTED_SIZE);
+            if (senderSeq > 0) ctx.setSenderSeq(senderSeq);
+            if (receiverSeq > 0) ctx.setReceiverSeq(receiverSeq);
+            this.seqLimit = senderSeq;
+        }
+    }
+
+    /**
+     * Context store that derives a tentative context for a provisioned node when
+     * a request arrives under an ID Context it does not know yet.
+     */
+    private final class NodeCtxDB extends HashMapCtxDB {
+
+        // not synchronized here: deriveSession locks OscoreContexts first, then the store
+        @Override
+        public OSCoreCtx getContext(byte[] rid, byte[] idContext) throws CoapOSException {
+            OSCoreCtx ctx = super.getContext(rid, idContext);
+            if (ctx == null && idContext != null && deriveSession(idOf(rid), idContext)) {
+                ctx = super.getContext(rid, idContext);
+            }
+            return ctx;
+        }
+    }
+
+    private static class State {
+        List<SavedSession> sessions = new ArrayList<>();
+        Map<Integer, List<String>> seen = new HashMap<>();
+    }
+
+    private static class SavedSession {
+        int id;
+        String idContext;
+        int seqLimit;
+        int receiverSeq;
+
+        SavedSession(int id, String idContext, int seqLimit, int receiverSeq) {
+            this.id = id;
+            this.idContext = idContext;
+            this.seqLimit = seqLimit;
+            this.receiverSeq = receiverSeq;
+        }
+    }
+}
@@ -0,0 +1,26 @@
+package org.unipi.smartgarden.coap;
+
+/**
+ * RegistrationListener - Notified by the COAPNetworkController when a node
+ * registers one of its actuator resources through /registration, or when a
+ * resource is removed.
+ */
+public interface RegistrationListener {
+
+    void onRegistration(String actuatorName, String uri);
+
+    /**
+     * Same as onRegistration(actuatorName, uri), with the garden zone the node
+     * declared (1 when it did not declare one).
+     */
+    default void onRegistration(String actuatorName, String uri, int zone) {
+        onRegistration(actuatorName, uri);
+    }
+
+    /**
+     * The resource was dropped: its node stopped answering or registered again
+     * from another address.
+     */
+    default void onRemoval(String actuatorName, String uri) {
+    }
+}
@@ -0,0 +1,123 @@
+package org.unipi.smartgarden.coap;
+
+import org.eclipse.californium.core.CoapClient;
+import org.eclipse.californium.core.CoapResource;
+import org.eclipse.californium.core.CoapResponse;
+import org.eclipse.californium.core.CoapServer;
+import org.eclipse.californium.core.coap.CoAP;
+import org.eclipse.californium.core.coap.MediaTypeRegistry;
+import org.eclipse.californium.core.server.resources.CoapExchange;
+import org.eclipse.californium.elements.exception.ConnectorException;
+import org.json.JSONArray;
+import org.json.JSONObject;
+
+import java.io.IOException;
+import java.util.List;
+
+/**
+ * SimulatedActuatorNode - In-process stand-in for coap-device.c: one observable
+ * resource per actuator answering GET with {"mode":"..."} and accepting the same
+ * PUT commands as the firmware. Used by benchmarks and load tests.
+ */
+public class SimulatedActuatorNode extends CoapServer {
+
+    private final int port;
+
+    public SimulatedActuatorNode(int port, List<String> actuators) {
+        super(port);
+        this.port = port;
+        for (String name : actuators) {
+            add(new ActuatorResource(name));
+        }
+    }
+
+    public int getPort() {
+        return port;
+    }
+
+    public String uriOf(String actuator) {
+        return "coap://127.0.0.1:" + port + "/" + actuator;
+    }
+
+    /**
+     * Registers this node with the controller the way coap-device.c does,
+     * sending the POST from the node's own endpoint so the controller learns
+     * its port.
+     */
+    public boolean registerWith(String registrationUri, List<String> actuators) {
+        CoapClient client = new CoapClient(registrationUri);
+        client.setEndpoint(getEndpoints().get(0));
+        try {
+            String payload = new JSONObject()
+                    .put("device", "simulatedNode-" + port)
+                    .put("resources", new JSONArray(actuators))
+                    .toString();
+            CoapResponse response = client.post(payload, MediaTypeRegistry.APPLICATION_JSON);
+            return response != null && response.isSuccess();
+        } catch (ConnectorException | IOException e) {
+            return false;
+        } finally {
+            client.shutdown();
+        }
+    }
+
+    public void close() {
+        stop();
+        destroy();
+    }
+
+    private static class ActuatorResource extends CoapResource {
+
+        private volatile String mode = "off";
+
+        ActuatorResource(String name) {
+            super(name);
+            setObservable(true);
+            getAttributes().setTitle("Simulated " + name);
+            getAttributes().addResourceType("Control");
+        }
+
+        @Override
+        public void handleGET(CoapExchange exchange) {
+            exchange.respond(CoAP.ResponseCode.CONTENT, json(), MediaTypeRegistry.APPLICATION_JSON);
+        }
+
+        @Override
+        public void handlePUT(CoapExchange exchange) {
+            String command = exchange.getRequestText().trim().toLowerCase();
+            String next = "fertilizer".equals(getName()) ? fertilizerMode(command) : switchMode(command);
+
+            if (next == null) {
+                exchange.respond(CoAP.ResponseCode.BAD_REQUEST);
+                return;
+            }
+
+            mode = next;
+            changed();
+            exchange.respond(CoAP.ResponseCode.CHANGED, json(), MediaTypeRegistry.APPLICATION_JSON);
+        }
+
+        private String json() {
+            return "{\"mode\":\"" + mode + "\"}";
+        }
+
+        private static String switchMode(String command) {
+            return ("on".equals(command) || "off".equals(command)) ? command : null;
+        }
+
+        private static String fertilizerMode(String command) {
+            switch (command) {
+                case "sinc":
+                case "acidic":
+                    return "acidic";
+                case "sdec":
+                case "alkaline":
+                    return "alkaline";
+                case "off":
+                    return "off";
+                default:
+                    return null;
+            }
+        }
+    }
+}
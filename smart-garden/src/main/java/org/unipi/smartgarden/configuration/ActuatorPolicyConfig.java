@@ -0,0 +1,55 @@
+package org.unipi.smartgarden.configuration;
+
+/**
+ * ActuatorPolicyConfig - Anti-churn settings of one actuator, from the
+ * "policies" section of devices.json. Missing fields disable the setting.
+ */
+public class ActuatorPolicyConfig {
+
+    private float hysteresis;          // band around the threshold, in sensor units
+    private long minOnSeconds;         // min time on before an automatic switch off
+    private long minOffSeconds;        // min time off before an automatic switch on
+    private int maxSwitchesPerHour;    // 0 = unlimited
+
+    public ActuatorPolicyConfig() {
+        // required by Gson
+    }
+
+    public float getHysteresis() {
+        return hysteresis;
+    }
+
+    public void setHysteresis(float hysteresis) {
+        this.hysteresis = hysteresis;
+    }
+
+    public long getMinOnSeconds() {
+        return minOnSeconds;
+    }
+
+    public void setMinOnSeconds(long minOnSeconds) {
+        this.minOnSeconds = minOnSeconds;
+    }
+
+    public long getMinOffSeconds() {
+        return minOffSeconds;
+    }
+
+    public void setMinOffSeconds(long minOffSeconds) {
+        this.minOffSeconds = minOffSeconds;
+    }
+
+    public int getMaxSwitchesPerHour() {
+        return maxSwitchesPerHour;
+    }
+
+    public void setMaxSwitchesPerHour(int maxSwitchesPerHour) {
+        this.maxSwitchesPerHour = maxSwitchesPerHour;
+    }
+
+    @Override
+    public String toString() {
+        return "hysteresis=" + hysteresis + ", minOn=" + minOnSeconds + "s, minOff=" + minOffSeconds
+                + "s, maxSwitches/h=" + maxSwitchesPerHour;
+    }
+}
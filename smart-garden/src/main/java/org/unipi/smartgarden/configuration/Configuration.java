@@ -1,11 +1,15 @@
 package org.unipi.smartgarden.configuration;
 
+import java.util.HashMap;
 import java.util.List;
+import java.util.Map;
 
 public class Configuration {
 
     private List<SensorConfig> sensors;
     private List<String> actuators;
+    private Map<String, ActuatorPolicyConfig> policies = new HashMap<>(); // actuator -> policy
+    private OscoreConfig oscore; // null = plaintext CoAP
 
     public Configuration() {
         // required by Gson
@@ -27,11 +31,29 @@ public class Configuration {
         this.actuators = actuators;
     }
 
+    public Map<String, ActuatorPolicyConfig> getPolicies() {
+        return policies != null ? policies : new HashMap<>();
+    }
+
+    public void setPolicies(Map<String, ActuatorPolicyConfig> policies) {
+        this.policies = policies;
+    }
+
+    public OscoreConfig getOscore() {
+        return oscore;
+    }
+
+    public void setOscore(OscoreConfig oscore) {
+        this.oscore = oscore;
+    }
+
     @Override
     public String toString() {
         return "Configuration {\n" +
                 "  sensors=" + sensors + ",\n" +
-                "  actuators=" + actuators + "\n" +
+                "  actuators=" + actuators + ",\n" +
+                "  policies=" + policies + ",\n" +
+                "  oscore=" + oscore + "\n" +
                 '}';
     }
 }
@@ -0,0 +1,57 @@
+package org.unipi.smartgarden.configuration;
+
+import java.util.ArrayList;
+import java.util.List;
+
+/**
+ * OscoreConfig - Pre-provisioned OSCORE material, from the "oscore" section of
+ * devices.json. Must match oscore-keys.h and the OSCORE_ID of every CoAP node.
+ */
+public class OscoreConfig {
+
+    private boolean enabled;
+    private String masterSecret;                   // hex, 16 bytes
+    private String masterSalt;                     // hex, 8 bytes
+    private List<Integer> nodes = new ArrayList<>(); // OSCORE_ID of every node
+
+    public OscoreConfig() {
+        // required by Gson
+    }
+
+    public boolean isEnabled() {
+        return enabled;
+    }
+
+    public void setEnabled(boolean enabled) {
+        this.enabled = enabled;
+    }
+
+    public String getMasterSecret() {
+        return masterSecret;
+    }
+
+    public void setMasterSecret(String masterSecret) {
+        this.masterSecret = masterSecret;
+    }
+
+    public String getMasterSalt() {
+        return masterSalt;
+    }
+
+    public void setMasterSalt(String masterSalt) {
+        this.masterSalt = masterSalt;
+    }
+
+    public List<Integer> getNodes() {
+        return nodes != null ? nodes : new ArrayList<>();
+    }
+
+    public void setNodes(List<Integer> nodes) {
+        this.nodes = nodes;
+    }
+
+    @Override
+    public String toString() {
+        return "OscoreConfig{enabled=" + enabled + ", nodes=" + nodes + "}";
+    }
+}
@@ -4,6 +4,8 @@ public class SensorConfig {
 
     private String id;
     private String topic;
+    private String compression;  // "swinging-door" (default), "deadband" or "none"
+    private Float deviation;     // error bound of the stored series, in the sensor unit
 
     public SensorConfig() {
         // Default constructor for Gson
@@ -17,6 +19,14 @@ public class SensorConfig {
         return topic;
     }
 
+    public String getCompression() {
+        return compression;
+    }
+
+    public Float getDeviation() {
+        return deviation;
+    }
+
     public void setId(String id) {
         this.id = id;
     }
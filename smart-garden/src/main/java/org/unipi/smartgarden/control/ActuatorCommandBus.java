@@ -0,0 +1,317 @@
+package org.unipi.smartgarden.control;
+
+import org.unipi.smartgarden.coap.COAPNetworkController;
+import org.unipi.smartgarden.db.SampleStore;
+import org.unipi.smartgarden.metrics.Counter;
+import org.unipi.smartgarden.metrics.Metrics;
+import org.unipi.smartgarden.mqtt.MQTTHandler;
+import org.unipi.smartgarden.util.ConsoleUtils;
+
+import java.util.ArrayList;
+import java.util.HashMap;
+import java.util.List;
+import java.util.Map;
+import java.util.concurrent.CompletableFuture;
+import java.util.concurrent.ConcurrentHashMap;
+import java.util.concurrent.Executors;
+import java.util.concurrent.ScheduledExecutorService;
+import java.util.concurrent.TimeUnit;
+import java.util.concurrent.atomic.AtomicLong;
+
+/**
+ * ActuatorCommandBus - Single entry point for actuator commands. It keeps the
+ * last known state of every actuator, coalesces the commands submitted for the
+ * same actuator within a short window (last one wins) and drops the ones that
+ * would not change anything. Each effective change is dispatched exactly once:
+ * CoAP PUT, then DB row and MQTT mirror.
+ */
+public class ActuatorCommandBus implements ActuatorGateway {
+
+    private static final String LOG = "[Command Bus]";
+    private static final long COALESCE_WINDOW_MS = 250;
+
+    private final COAPNetworkController coapController;
+    private final MQTTHandler mqttHandler;
+    private final SampleStore db;
+    private final List<String> actuators;
+
+    // last state confirmed by the node (PUT acknowledged or GET answered)
+    private final Map<String, String> knownStates = new ConcurrentHashMap<>();
+    // commands sent and not acknowledged yet (guarded by this)
+    private final Map<String, String> inFlight = new HashMap<>();
+    // commands waiting for the end of their coalescing window (guarded by this)
+    private final Map<String, PendingCommand> pending = new HashMap<>();
+
+    private static final Counter SWITCHES = Metrics.counter(
+            "smartgarden_actuator_switches_total", "Actuator state changes acknowledged by the nodes", "actuator");
+
+    private final AtomicLong issued = new AtomicLong();
+    private final AtomicLong suppressed = new AtomicLong();
+
+    private final ScheduledExecutorService scheduler = Executors.newSingleThreadScheduledExecutor(r -> {
+        Thread t = new Thread(r, "command-bus");
+        t.setDaemon(true);
+        return t;
+    });
+
+    public ActuatorCommandBus(COAPNetworkController coapController, MQTTHandler mqttHandler,
+                              SampleStore db, List<String> actuators) {
+        this.coapController = coapController;
+        this.mqttHandler = mqttHandler;
+        this.db = db;
+        this.actuators = actuators;
+
+        Metrics.counterFunction("smartgarden_commands_issued_total",
+                "Actuator commands sent to the network", issued::get);
+        Metrics.counterFunction("smartgarden_commands_suppressed_total",
+                "Actuator commands dropped as redundant or coalesced", suppressed::get);
+    }
+
+    /**
+     * Requests a state for an actuator. The future completes with SWITCHED once
+     * the node acknowledged the requested state, UNCHANGED if the actuator
+     * already was (or was about to be) in it, SUPERSEDED if a later command in
+     * the coalescing window asked for another state.
+     */
+    @Override
+    public synchronized CompletableFuture<Outcome> submit(String actuator, String command) {
+        String desired = normalize(actuator, command);
+        if (desired == null) {
+            ConsoleUtils.printError(LOG + " Invalid command for " + actuator + ": " + command);
+            return CompletableFuture.completedFuture(Outcome.FAILED);
+        }
+        if (!coapController.owns(actuator)) {
+            ConsoleUtils.debug(LOG + " Ignoring " + command + " for " + actuator + ": owned by another instance");
+            return CompletableFuture.completedFuture(Outcome.FAILED);
+        }
+
+        PendingCommand waiting = pending.get(actuator);
+        if (waiting != null) {
+            // merged into the command already waiting for this actuator
+            suppressed.incrementAndGet();
+            return waiting.add(desired);
+        }
+
+        if (desired.equals(expectedState(actuator))) {
+            suppressed.incrementAndGet();
+            return CompletableFuture.completedFuture(Outcome.UNCHANGED);
+        }
+
+        PendingCommand created = new PendingCommand();
+        CompletableFuture<Outcome> result = created.add(desired);
+        pending.put(actuator, created);
+        scheduler.schedule(() -> dispatch(actuator), COALESCE_WINDOW_MS, TimeUnit.MILLISECONDS);
+        return result;
+    }
+
+    private void dispatch(String actuator) {
+        PendingCommand command;
+        synchronized (this) {
+            command = pending.remove(actuator);
+            if (command == null) return;
+
+            if (command.desired().equals(expectedState(actuator))) {
+                suppressed.incrementAndGet();
+                command.complete(Outcome.UNCHANGED);
+                return;
+            }
+            inFlight.put(actuator, command.desired());
+        }
+
+        String desired = command.desired();
+        issued.incrementAndGet();
+
+        coapController.sendCommandAsync(actuator, desired).whenComplete((ok, error) -> {
+            synchronized (this) {
+                inFlight.remove(actuator);
+            }
+
+            if (error == null && Boolean.TRUE.equals(ok)) {
+                knownStates.put(actuator, desired);
+                SWITCHES.inc(actuator);
+                mirror(actuator, desired);
+                command.complete(Outcome.SWITCHED);
+            } else {
+                // the node may or may not have applied it: ask again next time
+                knownStates.remove(actuator);
+                if (error != null) {
+                    ConsoleUtils.printError(LOG + " Command to " + actuator + " failed: " + error.getMessage());
+                }
+                command.complete(Outcome.FAILED);
+            }
+        });
+    }
+
+    private void mirror(String actuator, String state) {
+        try {
+            if ("fertilizer".equals(actuator)) {
+                int code = "acidic".equals(state) ? 1 : "alkaline".equals(state) ? 2 : 0;
+                db.insertSample("fertilizer", code, null);
+            } else {
+                db.insertSample(actuator, "on".equals(state) ? 1f : 0f, null);
+            }
+        } catch (Exception e) {
+            ConsoleUtils.printError(LOG + " DB persist failed for " + actuator + ": " + e.getMessage());
+        }
+
+        mqttHandler.sendCommand(actuator, state);
+
+        // heater and fan are mutually exclusive
+        if ("heater".equals(actuator) && "on".equals(state)) {
+            submit("fan", "off");
+        } else if ("fan".equals(actuator) && "on".equals(state)) {
+            submit("heater", "off");
+        }
+    }
+
+    /**
+     * Records a state reached outside the bus (a multicast group command) and
+     * mirrors it to the DB and MQTT like a dispatched command.
+     */
+    public void applied(String actuator, String state) {
+        String previous = knownStates.put(actuator, state);
+        if (state.equals(previous)) return;
+        SWITCHES.inc(actuator);
+        mirror(actuator, state);
+    }
+
+    /**
+     * Current state of the actuator: the known one when available, otherwise
+     * fetched with a GET and remembered.
+     */
+    @Override
+    public CompletableFuture<String> currentState(String actuator) {
+        String state;
+        synchronized (this) {
+            state = expectedState(actuator);
+        }
+        if (state != null) {
+            return CompletableFuture.completedFuture(state);
+        }
+
+        return coapController.getActuatorStateAsync(actuator).thenApply(s -> {
+            if (s != null) knownStates.putIfAbsent(actuator, s.toLowerCase());
+            return s;
+        });
+    }
+
+    /**
+     * Re-reads the given actuators from the network, to catch changes the bus did
+     * not issue (button triggers, node reboots).
+     */
+    @Override
+    public CompletableFuture<Void> refreshStates(List<String> toRefresh) {
+        List<String> owned = new ArrayList<>();
+        for (String actuator : toRefresh) {
+            if (actuators.contains(actuator) && coapController.owns(actuator)) owned.add(actuator);
+        }
+        Map<String, CompletableFuture<String>> states = coapController.getActuatorStatesAsync(owned);
+        List<CompletableFuture<Void>> reads = new ArrayList<>();
+        for (Map.Entry<String, CompletableFuture<String>> entry : states.entrySet()) {
+            reads.add(entry.getValue().handle((state, e) -> {
+                if (e != null) {
+                    ConsoleUtils.printError(LOG + " Could not refresh state of " + entry.getKey());
+                } else if (state != null) {
+                    knownStates.put(entry.getKey(), state.toLowerCase());
+                }
+                return null;
+            }));
+        }
+        return CompletableFuture.allOf(reads.toArray(new CompletableFuture[0]));
+    }
+
+    @Override
+    public boolean owns(String actuator) {
+        return coapController.owns(actuator);
+    }
+
+    @Override
+    public void logModeEvent(String actuator, String mode) {
+        coapController.logModeEvent(actuator, mode);
+    }
+
+    /**
+     * Forgets the known states: the nodes this instance commands for a type
+     * may have changed, so each state is read again from the nodes now behind it.
+     */
+    public void onOwnershipChanged() {
+        knownStates.clear();
+    }
+
+    public Map<String, String> getKnownStates() {
+        return new HashMap<>(knownStates);
+    }
+
+    /**
+     * Seeds the state of an actuator from a snapshot; the next refresh replaces it
+     * with what the node reports.
+     */
+    public void restoreState(String actuator, String state) {
+        if (state != null && coapController.owns(actuator)) {
+            knownStates.putIfAbsent(actuator, state);
+        }
+    }
+
+    public String getKnownState(String actuator) {
+        return knownStates.get(actuator);
+    }
+
+    public long getIssuedCount() {
+        return issued.get();
+    }
+
+    public long getSuppressedCount() {
+        return suppressed.get();
+    }
+
+    public void close() {
+        scheduler.shutdown();
+    }
+
+    // state the actuator will be in once the in-flight command (if any) lands
+    private String expectedState(String actuator) {
+        String state = inFlight.get(actuator);
+        return state != null ? state : knownStates.get(actuator);
+    }
+
+    /**
+     * Canonical state for a command (fertilizer sinc/sdec become acidic/alkaline),
+     * or null if the command is not valid for the actuator.
+     */
+    public static String normalize(String actuator, String command) {
+        String c = command == null ? "" : command.toLowerCase().trim();
+
+        if ("fertilizer".equals(actuator)) {
+            if ("sinc".equals(c)) return "acidic";
+            if ("sdec".equals(c)) return "alkaline";
+            return ("acidic".equals(c) || "alkaline".equals(c) || "off".equals(c)) ? c : null;
+        }
+        return ("on".equals(c) || "off".equals(c)) ? c : null;
+    }
+
+    // the commands merged in one coalescing window, the last one wins (guarded by the bus)
+    private static class PendingCommand {
+
+        private final List<String> requested = new ArrayList<>();
+        private final List<CompletableFuture<Outcome>> results = new ArrayList<>();
+
+        CompletableFuture<Outcome> add(String desired) {
+            CompletableFuture<Outcome> result = new CompletableFuture<>();
+            requested.add(desired);
+            results.add(result);
+            return result;
+        }
+
+        String desired() {
+            return requested.get(requested.size() - 1);
+        }
+
+        // outcome of the state sent; the callers that asked for another one were superseded
+        void complete(Outcome outcome) {
+            String sent = desired();
+            for (int i = 0; i < results.size(); i++) {
+                results.get(i).complete(requested.get(i).equals(sent) ? outcome : Outcome.SUPERSEDED);
+            }
+        }
+    }
+}
@@ -0,0 +1,39 @@
+package org.unipi.smartgarden.control;
+
+import java.util.List;
+import java.util.concurrent.CompletableFuture;
+
+/**
+ * ActuatorGateway - What the control logic needs from the actuators. The live
+ * implementation is the ActuatorCommandBus; the replay engine uses in-memory
+ * actuators driven by a virtual clock.
+ */
+public interface ActuatorGateway {
+
+    /**
+     * How a submitted command ended: the actuator was switched to the state
+     * requested, was already in it (nothing sent), a later command for the
+     * same actuator replaced it before it was sent, or it failed.
+     */
+    enum Outcome { SWITCHED, UNCHANGED, SUPERSEDED, FAILED }
+
+    /**
+     * Requests a state for an actuator; completes once the command ended.
+     */
+    CompletableFuture<Outcome> submit(String actuator, String command);
+
+    CompletableFuture<String> currentState(String actuator);
+
+    /**
+     * Re-reads the state of the given actuators, called before the sweep of the
+     * rule driving them; completes once every read has answered or failed.
+     */
+    CompletableFuture<Void> refreshStates(List<String> actuators);
+
+    /**
+     * Whether this instance commands the actuator (always true unless clustered).
+     */
+    boolean owns(String actuator);
+
+    void logModeEvent(String actuator, String mode);
+}
@@ -0,0 +1,88 @@
+package org.unipi.smartgarden.control;
+
+import org.unipi.smartgarden.configuration.ActuatorPolicyConfig;
+import org.unipi.smartgarden.metrics.Counter;
+import org.unipi.smartgarden.metrics.Metrics;
+
+import java.util.ArrayDeque;
+import java.util.Deque;
+import java.util.HashMap;
+import java.util.Map;
+
+/**
+ * ActuatorPolicy - Limits how often the automatic rules may switch an actuator:
+ * a minimum time in the on and off states, and a maximum number of switches in
+ * any sliding hour. Manual commands and the heater/fan interlock are not
+ * subject to it. Shared by the rule workers of the control thread.
+ */
+public class ActuatorPolicy {
+
+    private static final long HOUR_MS = 3_600_000L;
+    private static final ActuatorPolicyConfig NONE = new ActuatorPolicyConfig();
+
+    private static final Counter HELD = Metrics.counter(
+            "smartgarden_policy_held_total", "Automatic switches held back by dwell time or rate limit", "actuator");
+
+    private final Map<String, ActuatorPolicyConfig> configs;
+    private final Map<String, Long> lastSwitch = new HashMap<>();
+    private final Map<String, Deque<Long>> recentSwitches = new HashMap<>();
+
+    public ActuatorPolicy(Map<String, ActuatorPolicyConfig> configs) {
+        this.configs = configs;
+    }
+
+    /**
+     * A policy that allows every switch, with no hysteresis.
+     */
+    public static ActuatorPolicy none() {
+        return new ActuatorPolicy(Map.of());
+    }
+
+    public float hysteresis(String actuator) {
+        return configOf(actuator).getHysteresis();
+    }
+
+    /**
+     * Whether the actuator may go from current to desired at time now. A switch
+     * to a state it is already in is always allowed. With current null (state
+     * unknown) the longer of the two dwell times applies.
+     */
+    public synchronized boolean allows(String actuator, String current, String desired, long now) {
+        if (desired.equalsIgnoreCase(current)) return true;
+
+        ActuatorPolicyConfig config = configOf(actuator);
+        Long since = lastSwitch.get(actuator);
+        if (since != null) {
+            long dwell = current == null
+                    ? Math.max(config.getMinOnSeconds(), config.getMinOffSeconds())
+                    : "off".equalsIgnoreCase(current) ? config.getMinOffSeconds() : config.getMinOnSeconds();
+            if (now - since < dwell * 1000) {
+                HELD.inc(actuator);
+                return false;
+            }
+        }
+
+        if (config.getMaxSwitchesPerHour() > 0) {
+            Deque<Long> recent = recentSwitches.computeIfAbsent(actuator, a -> new ArrayDeque<>());
+            while (!recent.isEmpty() && recent.peekFirst() <= now - HOUR_MS) {
+                recent.pollFirst();
+            }
+            if (recent.size() >= config.getMaxSwitchesPerHour()) {
+                HELD.inc(actuator);
+                return false;
+            }
+        }
+        return true;
+    }
+
+    public synchronized void recordSwitch(String actuator, long now) {
+        lastSwitch.put(actuator, now);
+        if (configOf(actuator).getMaxSwitchesPerHour() > 0) {
+            recentSwitches.computeIfAbsent(actuator, a -> new ArrayDeque<>()).addLast(now);
+        }
+    }
+
+    private ActuatorPolicyConfig configOf(String actuator) {
+        return configs.getOrDefault(actuator, NONE);
+    }
+}
@@ -1,28 +1,103 @@
 package org.unipi.smartgarden.control;
 
-import org.eclipse.californium.elements.exception.ConnectorException;
-import org.unipi.smartgarden.coap.COAPNetworkController;
+import org.unipi.smartgarden.metrics.Counter;
+import org.unipi.smartgarden.metrics.Histogram;
+import org.unipi.smartgarden.metrics.Metrics;
 import org.unipi.smartgarden.mqtt.MQTTHandler;
+import org.unipi.smartgarden.mqtt.SampleListener;
 import org.unipi.smartgarden.util.ConsoleUtils;
 
+import java.time.Clock;
+import java.util.concurrent.CompletableFuture;
 import java.util.concurrent.ConcurrentHashMap;
-import java.io.IOException;
+import java.util.concurrent.ExecutorService;
+import java.util.concurrent.Executors;
+import java.util.concurrent.TimeUnit;
+import java.util.concurrent.TimeoutException;
+import java.util.HashMap;
+import java.util.HashSet;
+import java.util.LinkedHashMap;
+import java.util.LinkedHashSet;
+import java.util.List;
 import java.util.Map;
+import java.util.Set;
+
+import static org.unipi.smartgarden.control.ControlRules.MOISTURE_LOWER;
+import static org.unipi.smartgarden.control.ControlRules.MOISTURE_UPPER;
+import static org.unipi.smartgarden.control.ControlRules.PH_LOWER;
+import static org.unipi.smartgarden.control.ControlRules.PH_UPPER;
+import static org.unipi.smartgarden.control.ControlRules.TEMP_LOWER;
+import static org.unipi.smartgarden.control.ControlRules.TEMP_UPPER;
 
 /**
- * ControlLogicThread - Periodically checks sensor values and sends commands
- * to actuators to maintain optimal environmental conditions in the smart garden.
+ * ControlLogicThread - Re-evaluates the control rule of a sensor as soon as a
+ * new sample for it arrives, and sends commands to actuators to maintain optimal
+ * environmental conditions in the smart garden. Evaluations of the same rule are
+ * coalesced within a debounce window, and a slow periodic sweep re-checks each
+ * rule as a safety net.
+ *
+ * Each rule has its own sweep period and time budget and runs on its own worker:
+ * actuator states not read within the budget count as unknown, and an error ends
+ * the pass of that rule only, so a slow or unreachable node never delays the
+ * other rules.
+ *
+ * All timing goes through the Clock, so the same rules can be driven by the
+ * replay engine on a virtual clock (see runDuePasses and nextDueTime).
  */
-public class ControlLogicThread extends Thread {
+public class ControlLogicThread extends Thread implements SampleListener {
 
     private final MQTTHandler mqttHandler;
-    private final COAPNetworkController coapController;
+    private final ActuatorGateway actuators;
+    private final ActuatorPolicy policy;
+    private final Clock clock;
     private final Map<String, Boolean> manualOverride = new ConcurrentHashMap<>();
     private volatile boolean running = true;
-    private boolean growLightManualMode = false;
-    private boolean growLightOn = false;
-
-    private static final long SLEEP_INTERVAL_MS = 10_000; // 10 seconds
+    private volatile boolean growLightManualMode = false;
+    private volatile boolean growLightOn = false;
+
+    // Rules with a new sample waiting to be evaluated (guarded by wakeup)
+    private final Object wakeup = new Object();
+    private final Set<String> pendingRules = new LinkedHashSet<>();
+    // Last evaluation time and next sweep time per rule (guarded by wakeup), first sweep right away
+    private final Map<String, Long> lastEvaluation = new HashMap<>();
+    private final Map<String, Long> nextSweep = new HashMap<>();
+    // Rules whose worker is evaluating them (guarded by wakeup)
+    private final Set<String> busyRules = new HashSet<>();
+    // One worker per rule; null when the rules are evaluated inline
+    private final Map<String, ExecutorService> workers;
+
+    private static final Histogram PASS_DURATION = Metrics.histogram(
+            "smartgarden_control_pass_seconds", "Duration of one evaluation of a control rule", "rule");
+    private static final Counter DEADLINE_MISSES = Metrics.counter(
+            "smartgarden_control_deadline_misses_total", "Rule evaluations that overran their time budget", "rule");
+    private static final Counter OVERRUNS = Metrics.counter(
+            "smartgarden_control_overruns_total", "Sweeps due while the previous evaluation of the rule was running", "rule");
+    private static final Counter FAILURES = Metrics.counter(
+            "smartgarden_control_failures_total", "Rule evaluations ended by an error", "rule");
+    private static final Counter STATE_TIMEOUTS = Metrics.counter(
+            "smartgarden_control_state_timeouts_total", "Actuator states not read within the rule budget", "actuator");
+
+    private static final long DEBOUNCE_MS = 2_000;        // min spacing between two evaluations of a rule
+
+    // Control rules, keyed by the sensor that drives them
+    private static final String RULE_TEMPERATURE = "temperature"; // fan + heater
+    private static final String RULE_PH = "pH";                   // fertilizer
+    private static final String RULE_MOISTURE = "soilMoisture";   // irrigation
+    private static final String RULE_LIGHT = "light";             // grow_light
+    private static final List<String> RULES = List.of(RULE_TEMPERATURE, RULE_PH, RULE_MOISTURE, RULE_LIGHT);
+
+    // Safety-net sweep period of each rule
+    private static final Map<String, Long> SWEEP_INTERVAL_MS = Map.of(
+            RULE_TEMPERATURE, 60_000L,
+            RULE_PH, 120_000L,
+            RULE_MOISTURE, 30_000L,
+            RULE_LIGHT, 60_000L);
+    // Time budget of one evaluation, state reads included
+    private static final Map<String, Long> BUDGET_MS = Map.of(
+            RULE_TEMPERATURE, 2_000L,
+            RULE_PH, 2_000L,
+            RULE_MOISTURE, 1_500L,
+            RULE_LIGHT, 1_500L);
 
     // CoAP resource paths
     private static final String FERTILIZER = "fertilizer";
@@ -31,222 +106,329 @@ public class ControlLogicThread extends Thread {
     private static final String FAN = "fan";
     private static final String HEATER = "heater";
 
-    // Thresholds
-    private static final float TEMP_LOWER = 18.0f;
-    private static final float TEMP_UPPER = 26.0f;
+    // Actuators driven by each rule
+    private static final Map<String, List<String>> RULE_ACTUATORS = Map.of(
+            RULE_TEMPERATURE, List.of(FAN, HEATER),
+            RULE_PH, List.of(FERTILIZER),
+            RULE_MOISTURE, List.of(IRRIGATION),
+            RULE_LIGHT, List.of(GROW_LIGHT));
 
-    private static final float PH_LOWER = 6.0f;
-    private static final float PH_UPPER = 7.5f;
+    // Constructor
+    public ControlLogicThread(MQTTHandler mqttHandler, ActuatorGateway actuators, ActuatorPolicy policy) {
+        this(mqttHandler, actuators, policy, Clock.systemUTC(), startWorkers());
+    }
 
-    private static final float MOISTURE_LOWER = 35.0f;
-    private static final float MOISTURE_UPPER = 70.0f;
+    /**
+     * Evaluates the rules inline and in order on the thread calling runDuePasses,
+     * as the replay engine needs on a virtual clock.
+     */
+    public ControlLogicThread(MQTTHandler mqttHandler, ActuatorGateway actuators, ActuatorPolicy policy,
+                              Clock clock) {
+        this(mqttHandler, actuators, policy, clock, null);
+    }
 
-    private static final float LIGHT_LOWER = 30.0f;  // percentage
-    
-    // Constructor
-    public ControlLogicThread(MQTTHandler mqttHandler, COAPNetworkController coapController) {
+    private ControlLogicThread(MQTTHandler mqttHandler, ActuatorGateway actuators, ActuatorPolicy policy,
+                               Clock clock, Map<String, ExecutorService> workers) {
         this.mqttHandler = mqttHandler;
-        this.coapController = coapController;
+        this.actuators = actuators;
+        this.policy = policy;
+        this.clock = clock;
+        this.workers = workers;
         this.manualOverride.put(FAN, false);
         this.manualOverride.put(HEATER, false);
         this.manualOverride.put(FERTILIZER, false);
         this.manualOverride.put(IRRIGATION, false);
         
-        coapController.logModeEvent(FAN, "auto");   
-        coapController.logModeEvent(HEATER, "auto");
-        coapController.logModeEvent(IRRIGATION, "auto");
-        coapController.logModeEvent(FERTILIZER, "auto");
-        coapController.logModeEvent(GROW_LIGHT, "auto");
+        actuators.logModeEvent(FAN, "auto");   
+        actuators.logModeEvent(HEATER, "auto");
+        actuators.logModeEvent(IRRIGATION, "auto");
+        actuators.logModeEvent(FERTILIZER, "auto");
+        actuators.logModeEvent(GROW_LIGHT, "auto");
+    }
+
+    private static Map<String, ExecutorService> startWorkers() {
+        Map<String, ExecutorService> workers = new HashMap<>();
+        for (String rule : RULES) {
+            workers.put(rule, Executors.newSingleThreadExecutor(r -> {
+                Thread t = new Thread(r, "control-" + rule);
+                t.setDaemon(true);
+                return t;
+            }));
+        }
+        return workers;
+    }
+
+    @Override
+    public void onSample(String sensorName, float value) {
+        if (!RULES.contains(sensorName)) return;
+
+        synchronized (wakeup) {
+            if (pendingRules.add(sensorName)) {
+                wakeup.notifyAll();
+            }
+        }
     }
 
     @Override
     public void run() {
         while (running) {
-            try {
-                Thread.sleep(SLEEP_INTERVAL_MS);
-            } catch (InterruptedException e) {
-                ConsoleUtils.printError("[Control Logic] Sleep interrupted.");
-                break;
+            runDuePasses();
+
+            synchronized (wakeup) {
+                long delay = nextDueTime() - clock.millis();
+                if (delay > 0 && running) {
+                    try {
+                        wakeup.wait(delay);
+                    } catch (InterruptedException e) {
+                        ConsoleUtils.printError("[Control Logic] Wait interrupted.");
+                        break;
+                    }
+                }
+            }
+        }
+
+        if (workers != null) {
+            workers.values().forEach(ExecutorService::shutdown);
+        }
+        ConsoleUtils.println("[Control Logic] Thread stopped.");
+    }
+
+    /**
+     * Runs what is due at the current clock time: the rules whose sweep is due,
+     * and the rules with a new sample whose debounce window has elapsed. A rule
+     * still being evaluated by its worker is run again once it is done.
+     */
+    public void runDuePasses() {
+        Map<String, Boolean> due = new LinkedHashMap<>(); // rule -> sweep
+        long now = clock.millis();
+
+        synchronized (wakeup) {
+            for (String rule : RULES) {
+                boolean sweep = now >= nextSweep.getOrDefault(rule, 0L);
+                if (sweep) {
+                    nextSweep.put(rule, now + SWEEP_INTERVAL_MS.get(rule));
+                }
+                if (busyRules.contains(rule)) {
+                    if (sweep && pendingRules.add(rule)) OVERRUNS.inc(rule);
+                    continue;
+                }
+                if (!sweep && !(pendingRules.contains(rule)
+                        && lastEvaluation.getOrDefault(rule, 0L) + DEBOUNCE_MS <= now)) {
+                    continue;
+                }
+                pendingRules.remove(rule);
+                lastEvaluation.put(rule, now);
+                // in a cluster, only the instance commanding the actuators runs the rule
+                if (!ownsAnyActuatorOf(rule)) continue;
+                due.put(rule, sweep);
+                if (workers != null) busyRules.add(rule);
+            }
+        }
+
+        for (Map.Entry<String, Boolean> entry : due.entrySet()) {
+            String rule = entry.getKey();
+            boolean sweep = entry.getValue();
+            if (workers == null) {
+                runPass(rule, sweep);
+                continue;
             }
+            workers.get(rule).execute(() -> {
+                try {
+                    runPass(rule, sweep);
+                } finally {
+                    synchronized (wakeup) {
+                        busyRules.remove(rule);
+                        wakeup.notifyAll();
+                    }
+                }
+            });
+        }
+    }
 
-            try {
-                checkTemperature();
-            } catch (ConnectorException | IOException e) {
-                throw new RuntimeException(e);
+    /**
+     * Clock time at which runDuePasses has something to do next.
+     */
+    public long nextDueTime() {
+        synchronized (wakeup) {
+            long at = Long.MAX_VALUE;
+            for (String rule : RULES) {
+                if (busyRules.contains(rule)) continue; // woken up when its worker is done
+                at = Math.min(at, nextSweep.getOrDefault(rule, 0L));
+                if (pendingRules.contains(rule)) {
+                    at = Math.min(at, lastEvaluation.getOrDefault(rule, 0L) + DEBOUNCE_MS);
+                }
             }
+            return at;
+        }
+    }
 
-            checkPH();
-            checkSoilMoisture();
-            checkLight();
+    // one evaluation of a rule, within its budget; an error ends this pass only
+    private void runPass(String rule, boolean sweep) {
+        long start = System.nanoTime();
+        long deadline = start + TimeUnit.MILLISECONDS.toNanos(BUDGET_MS.get(rule));
+        try {
+            if (sweep) {
+                // pick up changes not issued by the bus before re-checking the rule
+                try {
+                    await(actuators.refreshStates(RULE_ACTUATORS.get(rule)), deadline);
+                } catch (TimeoutException e) {
+                    ConsoleUtils.debug("[Control Logic] State refresh for " + rule + " cut at the deadline");
+                }
+            }
+            evaluate(rule, deadline);
+        } catch (Exception e) {
+            FAILURES.inc(rule);
+            ConsoleUtils.printError("[Control Logic] Evaluation of " + rule + " failed: " + e);
+        }
+        PASS_DURATION.observeSince(rule, start);
+        if (System.nanoTime() - deadline > 0) {
+            DEADLINE_MISSES.inc(rule);
         }
+    }
 
-        ConsoleUtils.println("[Control Logic] Thread stopped.");
+    private static <T> T await(CompletableFuture<T> future, long deadline) throws Exception {
+        return future.get(Math.max(0, deadline - System.nanoTime()), TimeUnit.NANOSECONDS);
+    }
+
+    private void evaluate(String rule, long deadline) {
+        switch (rule) {
+            case RULE_TEMPERATURE:
+                checkTemperature(deadline);
+                break;
+            case RULE_PH:
+                checkPH(deadline);
+                break;
+            case RULE_MOISTURE:
+                checkSoilMoisture(deadline);
+                break;
+            case RULE_LIGHT:
+                checkLight(deadline);
+                break;
+        }
+    }
+
+    private boolean ownsAnyActuatorOf(String rule) {
+        for (String actuator : RULE_ACTUATORS.get(rule)) {
+            if (actuators.owns(actuator)) return true;
+        }
+        return false;
     }
 
     public void stopThread() {
         running = false;
+        synchronized (wakeup) {
+            wakeup.notifyAll();
+        }
     }
 
     public void setManualOverride(String actuator, boolean override) {
         manualOverride.put(actuator, override);
-        coapController.logModeEvent(actuator, override ? "manual" : "auto");
+        actuators.logModeEvent(actuator, override ? "manual" : "auto");
+    }
+
+    private void checkTemperature(long deadline) {
+        Float temperature = mqttHandler.getLatestValue("temperature");
+        if (temperature == null) return;
+
+        String fanState = stateOf(FAN, deadline);
+        String heaterState = stateOf(HEATER, deadline);
+
+        boolean fanOverride = manualOverride.getOrDefault(FAN, false);
+        boolean heaterOverride = manualOverride.getOrDefault(HEATER, false);
+
+        // MANUAL OVERRIDE
+        if (fanOverride || heaterOverride) {
+            if (temperature < TEMP_LOWER) {
+                ConsoleUtils.debug("[Control Logic] (override) Temp too low: " + temperature);
+                actuators.submit(HEATER, "on");
+                actuators.submit(FAN, "off");
+                // Reset override heater
+                if (heaterOverride) {
+                    ConsoleUtils.println("[Control Logic] Resetting manual override for heater");
+                    setManualOverride(HEATER, false);
+                }
+            } else if (temperature > TEMP_UPPER) {
+                ConsoleUtils.debug("[Control Logic] (override) Temp too high: " + temperature);
+                actuators.submit(FAN, "on");
+                actuators.submit(HEATER, "off");
+                // Reset override fan
+                if (fanOverride) {
+                    ConsoleUtils.println("[Control Logic] Resetting manual override for fan");
+                    setManualOverride(FAN, false);
+                }
+            } else {
+                ConsoleUtils.debug("[Control Logic] (override) Temp within range: " + temperature);
+            }
+            return;
+        }
+
+        // AUTOMATIC MODE
+        if (temperature < TEMP_LOWER) {
+            ConsoleUtils.debug("[Control Logic] Temp too low: " + temperature + " (heater " + heaterState + ")");
+        } else if (temperature > TEMP_UPPER) {
+            ConsoleUtils.debug("[Control Logic] Temp too high: " + temperature + " (fan " + fanState + ")");
+        } else {
+            ConsoleUtils.debug("[Control Logic] Temp within range: " + temperature);
+        }
+        // switch off first, so heater and fan are never requested on together
+        String heater = ControlRules.heaterCommand(temperature, "on".equalsIgnoreCase(heaterState),
+                policy.hysteresis(HEATER));
+        String fan = ControlRules.fanCommand(temperature, "on".equalsIgnoreCase(fanState),
+                policy.hysteresis(FAN));
+        if ("off".equals(heater)) request(HEATER, heaterState, heater);
+        if ("off".equals(fan)) request(FAN, fanState, fan);
+        if ("on".equals(heater)) request(HEATER, heaterState, heater);
+        if ("on".equals(fan)) request(FAN, fanState, fan);
+    }
+
+    private void checkPH(long deadline) {
+        Float pH = mqttHandler.getLatestValue("pH");
+        if (pH == null) return;
+
+        boolean fertOverride = manualOverride.getOrDefault(FERTILIZER, false);
+        String fertState = stateOf(FERTILIZER, deadline);
+
+        // MANUAL
+        if (fertOverride) {
+            if ("acidic".equalsIgnoreCase(fertState)) {
+                if (pH <= PH_LOWER) {
+                    actuators.submit(FERTILIZER, "off");
+                    setManualOverride(FERTILIZER, false);
+                }
+            } else if ("alkaline".equalsIgnoreCase(fertState)) {
+                if (pH >= PH_UPPER) {
+                    actuators.submit(FERTILIZER, "off");
+                    setManualOverride(FERTILIZER, false);
+                }
+            } else {
+                // override but state=off → exit from override
+                setManualOverride(FERTILIZER, false);
+            }
+            return;
+        }
+
+        // AUTO
+        if (pH < PH_LOWER) {
+            ConsoleUtils.debug("[Control Logic] pH too low: " + pH);
+        } else if (pH > PH_UPPER) {
+            ConsoleUtils.debug("[Control Logic] pH too high: " + pH);
+        } else {
+            ConsoleUtils.debug("[Control Logic] pH within acceptable range: " + pH);
+        }
+        request(FERTILIZER, fertState, ControlRules.fertilizerCommand(pH, fertState, policy.hysteresis(FERTILIZER)));
     }
 
-    private void checkTemperature() throws ConnectorException, IOException {
-	    Float temperature = mqttHandler.getLatestValue("temperature");
-	    if (temperature == null) return;
-
-	    String fanState = coapController.getActuatorState(FAN);
-	    String heaterState = coapController.getActuatorState(HEATER);
-
-	    boolean fanOverride = manualOverride.getOrDefault(FAN, false);
-	    boolean heaterOverride = manualOverride.getOrDefault(HEATER, false);
-
-	    boolean withinRange = temperature >= TEMP_LOWER && temperature <= TEMP_UPPER;
-
-	    // MANUAL OVERRIDE
-	    if (fanOverride || heaterOverride) {
-		if (temperature < TEMP_LOWER) {
-		    ConsoleUtils.println("[Control Logic] (override) Temp too low: " + temperature);
-		    if (!"on".equalsIgnoreCase(heaterState)) {
-		        mqttHandler.simulateHeater("on");
-		        coapController.sendCommand(HEATER, "on");
-		    }
-		    if (!"off".equalsIgnoreCase(fanState)) {
-		        coapController.sendCommand(FAN, "off");
-		    }
-		    // Reset override heater
-		    if (heaterOverride) {
-		        ConsoleUtils.println("[Control Logic] Resetting manual override for heater");
-		        setManualOverride(HEATER, false);
-		    }
-		} else if (temperature > TEMP_UPPER) {
-		    ConsoleUtils.println("[Control Logic] (override) Temp too high: " + temperature);
-		    if (!"on".equalsIgnoreCase(fanState)) {
-		        mqttHandler.simulateFan("on");
-		        coapController.sendCommand(FAN, "on");
-		    }
-		    if (!"off".equalsIgnoreCase(heaterState)) {
-		        coapController.sendCommand(HEATER, "off");
-		    }
-		    // Reset override fan
-		    if (fanOverride) {
-		        ConsoleUtils.println("[Control Logic] Resetting manual override for fan");
-		        setManualOverride(FAN, false);
-		    }
-		} else {
-		    ConsoleUtils.println("[Control Logic] (override) Temp within range: " + temperature);
-		}
-		return;
-	    }
-
-	    // AUTOMATIC MODE
-	    if (temperature < TEMP_LOWER) {
-		ConsoleUtils.println("[Control Logic] Temp too low: " + temperature);
-		if (!"on".equalsIgnoreCase(heaterState)) {
-		    mqttHandler.simulateHeater("on");
-		    coapController.sendCommand(HEATER, "on");
-		}
-		if (!"off".equalsIgnoreCase(fanState)) {
-		    coapController.sendCommand(FAN, "off");
-		}
-
-	    } else if (temperature > TEMP_UPPER) {
-		ConsoleUtils.println("[Control Logic] Temp too high: " + temperature);
-		if (!"on".equalsIgnoreCase(fanState)) {
-		    mqttHandler.simulateFan("on");
-		    coapController.sendCommand(FAN, "on");
-		}
-		if (!"off".equalsIgnoreCase(heaterState)) {
-		    coapController.sendCommand(HEATER, "off");
-		}
-
-	    } else {
-		ConsoleUtils.println("[Control Logic] Temp within range: " + temperature);
-		if (!"off".equalsIgnoreCase(fanState)) {
-		    coapController.sendCommand(FAN, "off");
-		}
-		if (!"off".equalsIgnoreCase(heaterState)) {
-		    coapController.sendCommand(HEATER, "off");
-		}
-	    }
-	}
-
-	private void checkPH() {
-	    Float pH = mqttHandler.getLatestValue("pH");
-	    if (pH == null) return;
-
-	    boolean fertOverride = manualOverride.getOrDefault(FERTILIZER, false);
-
-	    try {
-		String fertState = coapController.getActuatorState(FERTILIZER);
-		
-		// MANUAL
-		if (fertOverride) {
-		    if ("acidic".equalsIgnoreCase(fertState)) {
-		        if (pH <= PH_LOWER) {
-		            mqttHandler.simulateFertilizer("off");
-		            coapController.sendCommand(FERTILIZER, "off");
-		            setManualOverride(FERTILIZER, false);
-		        }
-		    } else if ("alkaline".equalsIgnoreCase(fertState)) {
-		        if (pH >= PH_UPPER) {
-		            mqttHandler.simulateFertilizer("off");
-		            coapController.sendCommand(FERTILIZER, "off");
-		            setManualOverride(FERTILIZER, false); 
-		        }
-		    } else {
-		        // override but state=off → exit from override
-		        setManualOverride(FERTILIZER, false);
-		    }
-		    return;
-		}
-
-		// AUTO
-		if (pH < PH_LOWER) {
-		    ConsoleUtils.println("[Control Logic] pH too low: " + pH);
-		    if (!"alkaline".equalsIgnoreCase(fertState)) {
-		        mqttHandler.simulateFertilizer("sdec");
-		        coapController.sendCommand(FERTILIZER, "sdec");
-		    }
-
-		} else if (pH > PH_UPPER) {
-		    ConsoleUtils.println("[Control Logic] pH too high: " + pH);
-		    if (!"acidic".equalsIgnoreCase(fertState)) {
-		        mqttHandler.simulateFertilizer("sinc");
-		        coapController.sendCommand(FERTILIZER, "sinc");
-		    }
-
-		} else {
-		    ConsoleUtils.println("[Control Logic] pH within acceptable range: " + pH);
-		    if (!"off".equalsIgnoreCase(fertState)) {
-		        mqttHandler.simulateFertilizer("off");
-		        coapController.sendCommand(FERTILIZER, "off");
-		    }
-		}
-
-	    } catch (ConnectorException | IOException e) {
-		throw new RuntimeException(e);
-	    }
-	}
-
-
-  private void checkSoilMoisture() {
-    Float moisture = mqttHandler.getLatestValue("soilMoisture");
-    if (moisture == null) return;
-
-    boolean irrigationOverride = manualOverride.getOrDefault(IRRIGATION, false);
-
-    try {
-        String irrigationState = coapController.getActuatorState(IRRIGATION);
+    private void checkSoilMoisture(long deadline) {
+        Float moisture = mqttHandler.getLatestValue("soilMoisture");
+        if (moisture == null) return;
+
+        boolean irrigationOverride = manualOverride.getOrDefault(IRRIGATION, false);
 
         // MANUAL
         if (irrigationOverride) {
-            if ("on".equalsIgnoreCase(irrigationState)) {
+            if ("on".equalsIgnoreCase(stateOf(IRRIGATION, deadline))) {
                 if (moisture >= MOISTURE_UPPER) {
-                    mqttHandler.simulateIrrigation("off");
-                    if (!"off".equalsIgnoreCase(irrigationState))
-                        coapController.sendCommand(IRRIGATION, "off");
+                    actuators.submit(IRRIGATION, "off");
                     setManualOverride(IRRIGATION, false);
                 }
             } else {
@@ -257,78 +439,93 @@ public class ControlLogicThread extends Thread {
 
         // AUTO
         if (moisture < MOISTURE_LOWER) {
-            ConsoleUtils.println("[Control Logic] Soil moisture too low: " + moisture);
-            mqttHandler.simulateIrrigation("on");
-            if (!"on".equalsIgnoreCase(irrigationState)) {
-                coapController.sendCommand(IRRIGATION, "on");
-            }
-
+            ConsoleUtils.debug("[Control Logic] Soil moisture too low: " + moisture);
         } else if (moisture > MOISTURE_UPPER) {
-            ConsoleUtils.println("[Control Logic] Soil moisture too high: " + moisture);
-            mqttHandler.simulateIrrigation("off");
-            if (!"off".equalsIgnoreCase(irrigationState)) {
-                coapController.sendCommand(IRRIGATION, "off");
-            }
+            ConsoleUtils.debug("[Control Logic] Soil moisture too high: " + moisture);
+        }
+        String irrigationState = stateOf(IRRIGATION, deadline);
+        request(IRRIGATION, irrigationState, ControlRules.irrigationCommand(moisture,
+                "on".equalsIgnoreCase(irrigationState), policy.hysteresis(IRRIGATION)));
+    }
 
-        } else {
-            if (!"off".equalsIgnoreCase(irrigationState)) {
-                coapController.sendCommand(IRRIGATION, "off");
-            }
+    private void checkLight(long deadline) {
+        Float light = mqttHandler.getLatestValue("light");
+        if (light == null) return;
+
+        // MANUAL OVERRIDE
+        if (growLightManualMode) {
+            ConsoleUtils.debug("[Control Logic] (manual) grow_light is " + (growLightOn ? "ON" : "OFF"));
+            actuators.submit(GROW_LIGHT, growLightOn ? "on" : "off");
+            return;
         }
 
-    } catch (ConnectorException | IOException e) {
-        throw new RuntimeException(e);
+        // AUTOMATIC MODE
+        String command = ControlRules.growLightCommand(light);
+        if (command != null) {
+            ConsoleUtils.debug("[Control Logic] Light too low: " + light);
+            request(GROW_LIGHT, stateOf(GROW_LIGHT, deadline), command);
+        }
+    }
+
+    // automatic-mode command, subject to the dwell time and switch rate of the actuator
+    private void request(String actuator, String current, String command) {
+        String desired = ActuatorCommandBus.normalize(actuator, command);
+        if (desired == null || desired.equalsIgnoreCase(current)) return;
+
+        if (!policy.allows(actuator, current, desired, clock.millis())) {
+            ConsoleUtils.debug("[Control Logic] Holding " + actuator + " " + current + " -> " + desired
+                    + " (dwell time or switch rate)");
+            return;
+        }
+        // only the switch to this state, confirmed by the node, counts towards dwell time and rate
+        actuators.submit(actuator, command).thenAccept(outcome -> {
+            if (outcome == ActuatorGateway.Outcome.SWITCHED) policy.recordSwitch(actuator, clock.millis());
+        });
+    }
+
+    // known state from the command bus, fetched from the node only when unknown;
+    // null if it could not be read before the deadline of the rule
+    private String stateOf(String actuator, long deadline) {
+        try {
+            return await(actuators.currentState(actuator), deadline);
+        } catch (TimeoutException e) {
+            STATE_TIMEOUTS.inc(actuator);
+            ConsoleUtils.debug("[Control Logic] No state for " + actuator + " within the deadline");
+            return null;
+        } catch (Exception e) {
+            ConsoleUtils.printError("[Control Logic] Could not read state of " + actuator + ": " + e.getMessage());
+            return null;
+        }
+    }
+
+    public void enableGrowLightAutoMode() {
+        this.growLightManualMode = false;
+        actuators.logModeEvent(GROW_LIGHT, "auto");
+
+        // turn temporarily the lights off for current ambient light evaluation
+        ConsoleUtils.println("[Control Logic] AUTO: probing ambient → turn grow_light OFF once");
+        actuators.submit(GROW_LIGHT, "off");
+    }
+
+    public Map<String, Boolean> getManualOverrides() {
+        return new HashMap<>(manualOverride);
+    }
+
+    /**
+     * Puts back the modes saved in a snapshot, before the thread is started.
+     */
+    public void restoreModes(Map<String, Boolean> overrides, boolean growLightManual, boolean growLightState) {
+        for (Map.Entry<String, Boolean> entry : overrides.entrySet()) {
+            if (Boolean.TRUE.equals(entry.getValue())) {
+                setManualOverride(entry.getKey(), true);
+            }
+        }
+        if (growLightManual) {
+            setGrowLightManualMode(true);
+            setGrowLightState(growLightState);
+        }
     }
-}
 
-    private void checkLight() {
-	    Float light = mqttHandler.getLatestValue("light");
-	    if (light == null) return;
-
-	    try {
-		String lightState = coapController.getActuatorState(GROW_LIGHT);
-
-		// MANUAL OVERRIDE
-		if (growLightManualMode) {
-		    ConsoleUtils.println("[Control Logic] (manual) grow_light is " + (growLightOn ? "ON" : "OFF"));
-		    mqttHandler.simulateGrowLight(growLightOn ? "on" : "off");
-		    if (growLightOn && !"on".equalsIgnoreCase(lightState)) {
-		        coapController.sendCommand(GROW_LIGHT, "on");
-		    } else if (!growLightOn && !"off".equalsIgnoreCase(lightState)) {
-		        coapController.sendCommand(GROW_LIGHT, "off");
-		    }
-		    return;
-		}
-
-		// AUTOMATIC MODE
-		if (light < LIGHT_LOWER) {
-		    ConsoleUtils.println("[Control Logic] Light too low: " + light);
-		    mqttHandler.simulateGrowLight("on");
-		    if (!"on".equalsIgnoreCase(lightState)) {
-		        coapController.sendCommand(GROW_LIGHT, "on");
-		    }
-		}
-		
-	    } catch (ConnectorException | IOException e) {
-		throw new RuntimeException(e);
-	    }
-	}
-
-	public void enableGrowLightAutoMode() {
-	    this.growLightManualMode = false;
-	    coapController.logModeEvent(GROW_LIGHT, "auto");
-
-	    // turn temporarily the lights off for current ambient light evaluation
-	    try {
-		ConsoleUtils.println("[Control Logic] AUTO: probing ambient → turn grow_light OFF once");
-		mqttHandler.simulateGrowLight("off");
-		coapController.sendCommand(GROW_LIGHT, "off");
-	    } catch (ConnectorException | IOException e) {
-		ConsoleUtils.printError("[Control Logic] Failed to apply auto-mode probe");
-		e.printStackTrace();
-	    }
-	}
-	
     public boolean isFanOverride() {
         return manualOverride.getOrDefault(FAN, false);
     }
@@ -336,21 +533,21 @@ public class ControlLogicThread extends Thread {
     public boolean isHeaterOverride() {
         return manualOverride.getOrDefault(HEATER, false);
     }
-    
+
     public void setGrowLightManualMode(boolean manual) {
         this.growLightManualMode = manual;
-        coapController.logModeEvent(GROW_LIGHT, manual ? "manual" : "auto");
+        actuators.logModeEvent(GROW_LIGHT, manual ? "manual" : "auto");
     }
 
     public void setGrowLightState(boolean on) {
         this.growLightOn = on;
     }
-    
+
     public boolean isGrowLightManual() {
         return growLightManualMode;
     }
-    
- }
- 
- 
 
+    public boolean isGrowLightOn() {
+        return growLightOn;
+    }
+}
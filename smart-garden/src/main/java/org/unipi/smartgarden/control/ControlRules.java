@@ -0,0 +1,76 @@
+package org.unipi.smartgarden.control;
+
+/**
+ * ControlRules - Automatic-mode decisions of the control logic, as pure
+ * functions of the latest sensor value. They return the command the actuator
+ * should be in, or null when the rule leaves the actuator as it is.
+ *
+ * The variants taking the current state and a band add hysteresis: an actuator
+ * switched on at a threshold is only switched off once the value has moved
+ * band units back past it.
+ */
+public final class ControlRules {
+
+    // Thresholds
+    public static final float TEMP_LOWER = 18.0f;
+    public static final float TEMP_UPPER = 26.0f;
+
+    public static final float PH_LOWER = 6.0f;
+    public static final float PH_UPPER = 7.5f;
+
+    public static final float MOISTURE_LOWER = 35.0f;
+    public static final float MOISTURE_UPPER = 70.0f;
+
+    public static final float LIGHT_LOWER = 30.0f;  // percentage
+
+    private ControlRules() {
+    }
+
+    public static String heaterCommand(float temperature) {
+        return temperature < TEMP_LOWER ? "on" : "off";
+    }
+
+    public static String fanCommand(float temperature) {
+        return temperature > TEMP_UPPER ? "on" : "off";
+    }
+
+    // pH too low → alkaline (sdec), too high → acidic (sinc)
+    public static String fertilizerCommand(float pH) {
+        if (pH < PH_LOWER) return "sdec";
+        if (pH > PH_UPPER) return "sinc";
+        return "off";
+    }
+
+    public static String irrigationCommand(float moisture) {
+        return moisture < MOISTURE_LOWER ? "on" : "off";
+    }
+
+    public static String heaterCommand(float temperature, boolean on, float band) {
+        if (temperature < TEMP_LOWER) return "on";
+        return (!on || temperature >= TEMP_LOWER + band) ? "off" : "on";
+    }
+
+    public static String fanCommand(float temperature, boolean on, float band) {
+        if (temperature > TEMP_UPPER) return "on";
+        return (!on || temperature <= TEMP_UPPER - band) ? "off" : "on";
+    }
+
+    // mode is the current fertilizer state: off, acidic (sinc) or alkaline (sdec)
+    public static String fertilizerCommand(float pH, String mode, float band) {
+        if (pH < PH_LOWER) return "sdec";
+        if (pH > PH_UPPER) return "sinc";
+        if ("alkaline".equalsIgnoreCase(mode) && pH < PH_LOWER + band) return "sdec";
+        if ("acidic".equalsIgnoreCase(mode) && pH > PH_UPPER - band) return "sinc";
+        return "off";
+    }
+
+    public static String irrigationCommand(float moisture, boolean on, float band) {
+        if (moisture < MOISTURE_LOWER) return "on";
+        return (!on || moisture >= MOISTURE_LOWER + band) ? "off" : "on";
+    }
+
+    // the grow light is only switched on automatically; "set grow_light auto" turns it off
+    public static String growLightCommand(float light) {
+        return light < LIGHT_LOWER ? "on" : null;
+    }
+}
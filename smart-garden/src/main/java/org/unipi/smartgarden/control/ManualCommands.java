@@ -0,0 +1,202 @@
+package org.unipi.smartgarden.control;
+
+import org.unipi.smartgarden.cluster.ClusterMembership;
+import org.unipi.smartgarden.coap.CoapGroupCommander;
+import org.unipi.smartgarden.util.ConsoleUtils;
+
+import java.util.List;
+import java.util.Set;
+
+/**
+ * ManualCommands - The operator commands of the CLI (trigger, set, group), for
+ * the console and the query API alike: ownership checks, the command itself
+ * and the manual override it implies for the control logic.
+ */
+public class ManualCommands {
+
+    private static final String LOG = "[Smart Garden]";
+
+    private final List<String> actuators;
+    private final ActuatorCommandBus commandBus;
+    private final ControlLogicThread controlLogic;
+    private final CoapGroupCommander groupCommander;
+    private final ClusterMembership cluster;  // null when not clustered
+
+    public ManualCommands(List<String> actuators, ActuatorCommandBus commandBus, ControlLogicThread controlLogic,
+                          CoapGroupCommander groupCommander, ClusterMembership cluster) {
+        this.actuators = actuators;
+        this.commandBus = commandBus;
+        this.controlLogic = controlLogic;
+        this.groupCommander = groupCommander;
+        this.cluster = cluster;
+    }
+
+    /**
+     * Runs a command line: trigger <actuator>, set <actuator> <state>,
+     * set grow_light auto, group <actuator> <state> [zone].
+     */
+    public Result execute(String command) {
+        String[] parts = command.trim().toLowerCase().split("\\s+");
+        switch (parts[0]) {
+            case "trigger" -> {
+                if (parts.length == 2) return toggle(parts[1]);
+            }
+            case "set" -> {
+                if (parts.length == 3 && "grow_light".equals(parts[1]) && "auto".equals(parts[2])) {
+                    return growLightAuto();
+                }
+                if (parts.length == 3) return set(parts[1], parts[2]);
+            }
+            case "group" -> {
+                if (parts.length == 3) return group(parts[1], parts[2], CoapGroupCommander.ALL_ZONES);
+                if (parts.length == 4) {
+                    try {
+                        return group(parts[1], parts[2], Integer.parseInt(parts[3]));
+                    } catch (NumberFormatException e) {
+                        return Result.error("Invalid zone: " + parts[3]);
+                    }
+                }
+            }
+            default -> {
+            }
+        }
+        return Result.error("Usage: trigger <actuator> | set <actuator> <state> | set grow_light auto"
+                + " | group <actuator> <on|off|sinc|sdec> [zone]");
+    }
+
+    /**
+     * Switches an on/off actuator to the other state and puts it in manual mode.
+     */
+    public Result toggle(String actuator) {
+        Result refused = checkCommandable(actuator);
+        if (refused != null) return refused;
+        if ("fertilizer".equals(actuator)) return Result.error("Use set fertilizer <sinc|sdec|off>");
+
+        boolean on;
+        try {
+            on = "on".equalsIgnoreCase(commandBus.currentState(actuator).join());
+        } catch (Exception e) {
+            ConsoleUtils.printError(LOG + " Could not fetch current state for " + actuator + ". Assuming OFF.");
+            on = false;
+        }
+        return set(actuator, on ? "off" : "on");
+    }
+
+    /**
+     * Sets an actuator to a state (on/off, or sinc/sdec/off for the fertilizer)
+     * and updates its manual mode.
+     */
+    public Result set(String actuator, String state) {
+        Result refused = checkCommandable(actuator);
+        if (refused != null) return refused;
+        String desired = ActuatorCommandBus.normalize(actuator, state);
+        if (desired == null) return Result.error("Invalid state for " + actuator + ": " + state);
+
+        ActuatorGateway.Outcome outcome;
+        try {
+            outcome = commandBus.submit(actuator, desired).join();
+        } catch (Exception e) {
+            outcome = ActuatorGateway.Outcome.FAILED;
+        }
+        // the override stays as it was otherwise, the control logic keeps the actuator
+        if (outcome == ActuatorGateway.Outcome.SUPERSEDED) {
+            return Result.error(actuator + " " + desired + " replaced by a later command");
+        }
+        if (outcome == ActuatorGateway.Outcome.FAILED) {
+            ConsoleUtils.printError(LOG + " Failed to send " + desired + " to " + actuator);
+            return Result.error("Failed to send " + desired + " to " + actuator);
+        }
+
+        boolean on = !"off".equals(desired);
+        switch (actuator) {
+            case "grow_light" -> {
+                controlLogic.setGrowLightManualMode(true);
+                controlLogic.setGrowLightState(on);
+                return Result.ok(actuator + " set to " + desired + ", manual override activated");
+            }
+            case "irrigation", "fertilizer" -> {
+                controlLogic.setManualOverride(actuator, on);
+                return Result.ok(actuator + " set to " + desired + ", manual override "
+                        + (on ? "activated" : "cleared"));
+            }
+            case "fan", "heater" -> {
+                controlLogic.setManualOverride(actuator, true);
+                return Result.ok(actuator + " set to " + desired + ", manual override activated");
+            }
+            default -> {
+                return Result.ok(actuator + " set to " + desired);
+            }
+        }
+    }
+
+    public Result growLightAuto() {
+        controlLogic.enableGrowLightAutoMode();
+        return Result.ok("grow_light back in automatic mode");
+    }
+
+    /**
+     * One multicast PUT to every node of the zone (CoapGroupCommander.ALL_ZONES for all).
+     */
+    public Result group(String actuator, String command, int zone) {
+        Result refused = checkCommandable(actuator);
+        if (refused != null) return refused;
+        String state = ActuatorCommandBus.normalize(actuator, command);
+        if (state == null) return Result.error("Invalid state for " + actuator + ": " + command);
+
+        String where = zone == CoapGroupCommander.ALL_ZONES ? "every zone" : "zone " + zone;
+        switch (groupCommander.sendGroupCommand(actuator, zone, state).join()) {
+            case NO_MEMBERS -> {
+                return Result.error("No " + actuator + " node known in " + where);
+            }
+            case FAILED -> {
+                return Result.error("Some " + actuator + " nodes did not reach " + state);
+            }
+            case UNCHANGED -> {
+                return Result.ok(actuator + " already " + state + " in " + where);
+            }
+            default -> {
+                // the bus keeps one state per actuator, which a single zone does not set
+                if (zone == CoapGroupCommander.ALL_ZONES) commandBus.applied(actuator, state);
+                return Result.ok(actuator + " set to " + state + " in " + where);
+            }
+        }
+    }
+
+    private Result checkCommandable(String actuator) {
+        if (!actuators.contains(actuator)) return Result.error("Unknown actuator: " + actuator);
+        if (cluster != null && !commandBus.owns(actuator)) {
+            Set<String> owners = cluster.ownersOf(actuator);
+            if (owners.isEmpty()) return Result.error("No " + actuator + " node registered");
+            return Result.error(actuator + " nodes are commanded by instance " + String.join(", ", owners)
+                    + ", trigger it there.");
+        }
+        return null;
+    }
+
+    public static final class Result {
+
+        private final boolean ok;
+        private final String message;
+
+        private Result(boolean ok, String message) {
+            this.ok = ok;
+            this.message = message;
+        }
+
+        static Result ok(String message) {
+            return new Result(true, message);
+        }
+
+        static Result error(String message) {
+            return new Result(false, message);
+        }
+
+        public boolean isOk() {
+            return ok;
+        }
+
+        public String getMessage() {
+            return message;
+        }
+    }
+}
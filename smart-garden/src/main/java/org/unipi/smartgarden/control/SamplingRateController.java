@@ -0,0 +1,208 @@
+package org.unipi.smartgarden.control;
+
+import org.unipi.smartgarden.metrics.Counter;
+import org.unipi.smartgarden.metrics.Metrics;
+import org.unipi.smartgarden.mqtt.MQTTHandler;
+import org.unipi.smartgarden.mqtt.SampleListener;
+import org.unipi.smartgarden.util.ConsoleUtils;
+
+import java.util.ArrayDeque;
+import java.util.Deque;
+import java.util.LinkedHashMap;
+import java.util.Map;
+import java.util.TreeMap;
+import java.util.concurrent.ConcurrentHashMap;
+import java.util.function.Function;
+import java.util.function.Predicate;
+
+/**
+ * SamplingRateController - Sets how often each sensor node reports each sensor,
+ * through the node's control topic smartgarden/rate/<device> (retained, so a
+ * rebooted node gets it back when it subscribes). A sensor reports fast while its
+ * value is close to a threshold, heading towards one, or while the actuator acting
+ * on it is running; slow when its last readings are flat; normal otherwise.
+ * In clustered mode only the instance owning a device sends its rates.
+ */
+public class SamplingRateController implements SampleListener {
+
+    private static final String LOG = "[Sampling Rate]";
+    public static final String RATE_TOPIC = "smartgarden/rate/";
+
+    // seconds between reports; the node reads its probes every 4 s and starts at 16 s
+    static final int FAST_S = 8;
+    static final int NORMAL_S = 48;
+    static final int SLOW_S = 128;
+
+    private static final int HISTORY = 4;
+
+    private static final Counter CHANGES = Metrics.counter(
+            "smartgarden_sampling_rate_changes_total", "Reporting interval changes sent to the nodes", "device");
+
+    private final MQTTHandler mqttHandler;
+    private final Function<String, String> actuatorState;
+    private volatile Predicate<String> ownership = device -> true;
+
+    // device -> sensor -> interval currently requested (guarded by the device map)
+    private final Map<String, Map<String, Integer>> intervals = new ConcurrentHashMap<>();
+    // device/sensor -> last readings, oldest first
+    private final Map<String, Deque<Reading>> history = new ConcurrentHashMap<>();
+
+    /**
+     * actuatorState returns the last known state of an actuator ("on", "off",
+     * "acidic", ...) or null if unknown.
+     */
+    public SamplingRateController(MQTTHandler mqttHandler, Function<String, String> actuatorState) {
+        this.mqttHandler = mqttHandler;
+        this.actuatorState = actuatorState;
+    }
+
+    /**
+     * Restricts the rate updates to the devices accepted by the predicate
+     * (clustered mode).
+     */
+    public void setOwnership(Predicate<String> ownership) {
+        this.ownership = ownership;
+    }
+
+    @Override
+    public void onSample(String sensorName, float value) {
+    }
+
+    @Override
+    public void onDeviceSample(String device, String sensorName, float value) {
+        Range range = RANGES.get(sensorName);
+        if (range == null) return;
+
+        Deque<Reading> readings = history.computeIfAbsent(device + "/" + sensorName, k -> new ArrayDeque<>());
+        int interval;
+        synchronized (readings) {
+            readings.addLast(new Reading(System.currentTimeMillis(), value));
+            if (readings.size() > HISTORY) readings.removeFirst();
+            interval = intervalFor(sensorName, range, readings);
+        }
+
+        if (!ownership.test(device)) {
+            // another instance sends the rates; start over if the device comes back
+            intervals.remove(device);
+            return;
+        }
+
+        Map<String, Integer> deviceIntervals = intervals.computeIfAbsent(device, d -> new LinkedHashMap<>());
+        String payload;
+        synchronized (deviceIntervals) {
+            Integer previous = deviceIntervals.put(sensorName, interval);
+            // sent once even at the node's default, a retained rate from another
+            // owner or an earlier run may be in place
+            if (previous != null && previous == interval) return;
+            payload = toJson(deviceIntervals);
+        }
+
+        CHANGES.inc(device);
+        ConsoleUtils.debug(LOG + " " + device + " " + sensorName + " every " + interval + " s");
+        mqttHandler.publishRetained(RATE_TOPIC + device, payload);
+    }
+
+    private int intervalFor(String sensorName, Range range, Deque<Reading> readings) {
+        Reading last = readings.peekLast();
+        Reading first = readings.peekFirst();
+
+        if (actuatorRunning(sensorName) || range.near(last.value)) return FAST_S;
+
+        // where the trend of the readings held gets to by the next report
+        float slope = last.at > first.at ? (last.value - first.value) * 1000f / (last.at - first.at) : 0f;
+        if (range.near(last.value + slope * NORMAL_S)) return FAST_S;
+
+        if (readings.size() == HISTORY && spread(readings) <= range.stable
+                && !range.near(last.value + slope * SLOW_S)) {
+            return SLOW_S;
+        }
+        return NORMAL_S;
+    }
+
+    private boolean actuatorRunning(String sensorName) {
+        for (String actuator : Range.actuatorsOf(sensorName)) {
+            String state = actuatorState.apply(actuator);
+            if (state != null && !"off".equals(state)) return true;
+        }
+        return false;
+    }
+
+    private static float spread(Deque<Reading> readings) {
+        float min = Float.MAX_VALUE;
+        float max = -Float.MAX_VALUE;
+        for (Reading r : readings) {
+            min = Math.min(min, r.value);
+            max = Math.max(max, r.value);
+        }
+        return max - min;
+    }
+
+    private static String toJson(Map<String, Integer> deviceIntervals) {
+        StringBuilder json = new StringBuilder("{");
+        for (Map.Entry<String, Integer> entry : deviceIntervals.entrySet()) {
+            if (json.length() > 1) json.append(',');
+            json.append('"').append(entry.getKey()).append("\":").append(entry.getValue());
+        }
+        return json.append('}').toString();
+    }
+
+    /**
+     * device -> sensor -> reporting interval in seconds, as last sent.
+     */
+    public Map<String, Map<String, Integer>> getIntervals() {
+        Map<String, Map<String, Integer>> copy = new TreeMap<>();
+        for (Map.Entry<String, Map<String, Integer>> entry : intervals.entrySet()) {
+            synchronized (entry.getValue()) {
+                copy.put(entry.getKey(), new TreeMap<>(entry.getValue()));
+            }
+        }
+        return copy;
+    }
+
+    private static class Reading {
+
+        private final long at;
+        private final float value;
+
+        Reading(long at, float value) {
+            this.at = at;
+            this.value = value;
+        }
+    }
+
+    // thresholds of ControlRules, how close counts as near, and how flat counts as stable
+    private static final Map<String, Range> RANGES = Map.of(
+            "temperature", new Range(ControlRules.TEMP_LOWER, ControlRules.TEMP_UPPER, 1.0f, 0.3f),
+            "pH", new Range(ControlRules.PH_LOWER, ControlRules.PH_UPPER, 0.2f, 0.05f),
+            "soilMoisture", new Range(ControlRules.MOISTURE_LOWER, ControlRules.MOISTURE_UPPER, 5f, 1f),
+            "light", new Range(ControlRules.LIGHT_LOWER, Float.MAX_VALUE, 5f, 2f));
+
+    private static class Range {
+
+        private final float lower;
+        private final float upper;
+        private final float margin;
+        private final float stable;
+
+        Range(float lower, float upper, float margin, float stable) {
+            this.lower = lower;
+            this.upper = upper;
+            this.margin = margin;
+            this.stable = stable;
+        }
+
+        boolean near(float value) {
+            return value <= lower + margin || value >= upper - margin;
+        }
+
+        static String[] actuatorsOf(String sensorName) {
+            return switch (sensorName) {
+                case "temperature" -> new String[]{"heater", "fan"};
+                case "pH" -> new String[]{"fertilizer"};
+                case "soilMoisture" -> new String[]{"irrigation"};
+                case "light" -> new String[]{"grow_light"};
+                default -> new String[0];
+            };
+        }
+    }
+}
@@ -1,15 +1,24 @@
 package org.unipi.smartgarden.db;
 
+import org.unipi.smartgarden.metrics.Histogram;
+import org.unipi.smartgarden.metrics.Metrics;
 import org.unipi.smartgarden.util.ConsoleUtils;
 
 import java.sql.Connection;
 import java.sql.DriverManager;
 import java.sql.PreparedStatement;
+import java.sql.ResultSet;
 import java.sql.SQLException;
+import java.sql.Statement;
+import java.sql.Timestamp;
 import java.util.HashMap;
 import java.util.Map;
+import java.util.concurrent.atomic.AtomicInteger;
 
-public class DBDriver {
+/**
+ * DBDriver - SampleStore on MySQL, or on any MySQL-compatible JDBC database.
+ */
+public class DBDriver implements SampleStore {
 
     private static final String LOG = "[DBDriver]";
 
@@ -17,15 +26,46 @@ public class DBDriver {
     private static final String DB_USER = "root";
     private static final String DB_PASS = "SmartGarden_123!";
 
+    // type -> table and value column
+    private static final Map<String, String[]> TABLES = Map.of(
+            "light", new String[]{"light", "value"},
+            "soilMoisture", new String[]{"soil_moisture", "value"},
+            "temperature", new String[]{"temperature", "value"},
+            "pH", new String[]{"pH", "value"},
+            "irrigation", new String[]{"irrigation", "active"},
+            "fertilizer", new String[]{"fertilizer", "mode"},
+            "grow_light", new String[]{"grow_light", "active"},
+            "fan", new String[]{"fan", "active"},
+            "heater", new String[]{"heater", "active"});
+
     private Connection connection;
     private Map<String, PreparedStatement> insertStatements;
+    // sensor tables with an explicit timestamp, for the samples held by the compression
+    private Map<String, PreparedStatement> insertAtStatements;
     private PreparedStatement insertActuatorMode;
+    private PreparedStatement insertCompression;
+
+    private final AtomicInteger pendingWrites = new AtomicInteger();
+
+    private static final Histogram INSERT_LATENCY = Metrics.histogram(
+            "smartgarden_db_insert_seconds", "Time to insert one row, including the wait for the connection", "table");
 
     public DBDriver() {
+        this(DB_URL, DB_USER, DB_PASS);
+    }
+
+    /**
+     * Connects to any MySQL-compatible JDBC URL (benchmarks use an embedded H2
+     * database in MySQL mode).
+     */
+    public DBDriver(String url, String user, String password) {
         insertStatements = new HashMap<>();
+        insertAtStatements = new HashMap<>();
+        Metrics.gauge("smartgarden_db_queue_depth", "Inserts waiting for or holding the DB connection",
+                pendingWrites::get);
 
         try {
-            connection = DriverManager.getConnection(DB_URL, DB_USER, DB_PASS);
+            connection = DriverManager.getConnection(url, user, password);
 
             insertStatements.put("light", connection.prepareStatement("INSERT INTO light (value) VALUES (?)"));
             insertStatements.put("soilMoisture", connection.prepareStatement("INSERT INTO soil_moisture (value) VALUES (?)"));
@@ -39,13 +79,97 @@ public class DBDriver {
             insertStatements.put("heater", connection.prepareStatement("INSERT INTO heater (active) VALUES (?)"));
             insertActuatorMode = connection.prepareStatement("INSERT INTO actuator_mode (actuator, mode) VALUES (?, ?)");
 
+            insertAtStatements.put("light", connection.prepareStatement("INSERT INTO light (value, timestamp) VALUES (?, ?)"));
+            insertAtStatements.put("soilMoisture", connection.prepareStatement("INSERT INTO soil_moisture (value, timestamp) VALUES (?, ?)"));
+            insertAtStatements.put("temperature", connection.prepareStatement("INSERT INTO temperature (value, timestamp) VALUES (?, ?)"));
+            insertAtStatements.put("pH", connection.prepareStatement("INSERT INTO pH (value, timestamp) VALUES (?, ?)"));
+
+            // error bound of the stored sensor series, from the given timestamp on
+            try (Statement st = connection.createStatement()) {
+                st.execute("CREATE TABLE IF NOT EXISTS sample_compression (id BIGINT AUTO_INCREMENT PRIMARY KEY, "
+                        + "sensor VARCHAR(32), method VARCHAR(16), deviation FLOAT, "
+                        + "timestamp TIMESTAMP DEFAULT CURRENT_TIMESTAMP)");
+            }
+            insertCompression = connection.prepareStatement(
+                    "INSERT INTO sample_compression (sensor, method, deviation) VALUES (?, ?, ?)");
+
         } catch (SQLException e) {
             ConsoleUtils.printError(LOG + " Error connecting to DB: " + e.getMessage());
             e.printStackTrace();
         }
     }
 
+    /**
+     * The JDBC connection is shared by the MQTT, CoAP and control threads, so
+     * writes are serialised; callers waiting for it show up as queue depth.
+     */
+    @Override
     public boolean insertSample(String type, float value, Float level) {
+        pendingWrites.incrementAndGet();
+        long start = System.nanoTime();
+        try {
+            synchronized (this) {
+                return doInsertSample(type, value, level);
+            }
+        } finally {
+            pendingWrites.decrementAndGet();
+            INSERT_LATENCY.observeSince(type, start);
+        }
+    }
+
+    @Override
+    public boolean insertSample(String type, float value, long timestampMillis) {
+        pendingWrites.incrementAndGet();
+        long start = System.nanoTime();
+        try {
+            synchronized (this) {
+                return doInsertSampleAt(type, value, timestampMillis);
+            }
+        } finally {
+            pendingWrites.decrementAndGet();
+            INSERT_LATENCY.observeSince(type, start);
+        }
+    }
+
+    private boolean doInsertSampleAt(String type, float value, long timestampMillis) {
+        try {
+            if (connection == null || connection.isClosed()) {
+                ConsoleUtils.printError(LOG + " Cannot insert sample: DB connection is closed.");
+                return false;
+            }
+
+            PreparedStatement stmt = insertAtStatements.get(type);
+            if (stmt == null) {
+                ConsoleUtils.printError(LOG + " Unknown sensor type: " + type);
+                return false;
+            }
+            stmt.setFloat(1, value);
+            stmt.setTimestamp(2, new Timestamp(timestampMillis));
+            stmt.executeUpdate();
+            return true;
+
+        } catch (SQLException e) {
+            ConsoleUtils.printError(LOG + " Failed to insert sample: " + e.getMessage());
+            return false;
+        }
+    }
+
+    @Override
+    public synchronized boolean insertCompression(String sensor, String method, float deviation) {
+        try {
+            if (connection == null || connection.isClosed() || insertCompression == null) return false;
+            insertCompression.setString(1, sensor);
+            insertCompression.setString(2, method);
+            insertCompression.setFloat(3, deviation);
+            insertCompression.executeUpdate();
+            return true;
+        } catch (SQLException e) {
+            ConsoleUtils.printError(LOG + " Failed to record compression of " + sensor + ": " + e.getMessage());
+            return false;
+        }
+    }
+
+    private boolean doInsertSample(String type, float value, Float level) {
         try {
             if (connection == null || connection.isClosed()) {
                 ConsoleUtils.printError(LOG + " Cannot insert sample: DB connection is closed.");
@@ -77,7 +201,21 @@ public class DBDriver {
         }
     }
     
+    @Override
     public boolean insertModeEvent(String actuator, String mode) {
+        pendingWrites.incrementAndGet();
+        long start = System.nanoTime();
+        try {
+            synchronized (this) {
+                return doInsertModeEvent(actuator, mode);
+            }
+        } finally {
+            pendingWrites.decrementAndGet();
+            INSERT_LATENCY.observeSince("actuator_mode", start);
+        }
+    }
+
+    private boolean doInsertModeEvent(String actuator, String mode) {
 	  try {
 	    if (connection == null || connection.isClosed()) return false;
 	    insertActuatorMode.setString(1, actuator);
@@ -90,11 +228,43 @@ public class DBDriver {
 	  }
     }
 
-    public void close() {
+    @Override
+    public synchronized long scan(String type, long fromMillis, long toMillis, SampleVisitor visitor) {
+        String[] table = TABLES.get(type);
+        if (table == null) {
+            ConsoleUtils.printError(LOG + " Unknown data type: " + type);
+            return 0;
+        }
+
+        if (connection == null) return 0;
+
+        long count = 0;
+        try (PreparedStatement stmt = connection.prepareStatement("SELECT timestamp, " + table[1] + " FROM " + table[0]
+                + " WHERE timestamp >= ? AND timestamp < ? ORDER BY id")) {
+            stmt.setTimestamp(1, new Timestamp(fromMillis));
+            stmt.setTimestamp(2, new Timestamp(toMillis));
+            try (ResultSet rs = stmt.executeQuery()) {
+                while (rs.next()) {
+                    visitor.visit(rs.getTimestamp(1).getTime(), rs.getFloat(2));
+                    count++;
+                }
+            }
+        } catch (SQLException e) {
+            ConsoleUtils.printError(LOG + " Failed to scan " + type + ": " + e.getMessage());
+        }
+        return count;
+    }
+
+    @Override
+    public synchronized void close() {
         try {
             for (PreparedStatement stmt : insertStatements.values()) {
                 if (stmt != null) stmt.close();
             }
+            for (PreparedStatement stmt : insertAtStatements.values()) {
+                if (stmt != null) stmt.close();
+            }
+            if (insertCompression != null) insertCompression.close();
             
             if (insertActuatorMode != null) insertActuatorMode.close();
             if (connection != null) connection.close();
@@ -0,0 +1,196 @@
+package org.unipi.smartgarden.db;
+
+import org.unipi.smartgarden.metrics.Counter;
+import org.unipi.smartgarden.metrics.Metrics;
+import org.unipi.smartgarden.util.ConsoleUtils;
+
+import java.util.Map;
+import java.util.concurrent.ConcurrentHashMap;
+
+/**
+ * SampleCompressor - Sits in front of SampleStore.insertSample for the sensor
+ * series and stores only the samples needed to rebuild each series within a
+ * fixed error bound (the deviation, in the unit of the sensor):
+ *
+ * - swinging door: the linear interpolation between two stored rows is within
+ *   the deviation of every sample received in between. The last sample is held
+ *   until the next one shows the trend changed, so a stored row may be written
+ *   one or more periods after it was received (with its own timestamp). The
+ *   row ends the segment on the door, so its value may differ from the sample
+ *   by up to the deviation.
+ * - deadband: a sample is stored when it moves more than the deviation away
+ *   from the last stored one; holding the last stored value rebuilds the series.
+ *
+ * Each series is also stored at least every MAX_GAP_MS. The method and bound in
+ * use are written to sample_compression at startup, so the dashboards know how
+ * to draw the series (linear or step) and the error band.
+ */
+public class SampleCompressor {
+
+    private static final String LOG = "[Compression]";
+    private static final long MAX_GAP_MS = 15 * 60 * 1000;
+
+    public enum Method { NONE, DEADBAND, SWINGING_DOOR }
+
+    // bound used when the configuration gives none: about the noise of the nodes
+    private static final Map<String, Float> DEFAULT_DEVIATIONS = Map.of(
+            "temperature", 0.2f,
+            "pH", 0.03f,
+            "soilMoisture", 0.5f,
+            "light", 1.0f);
+
+    private static final Counter RECEIVED = Metrics.counter(
+            "smartgarden_compression_received_total", "Sensor samples offered to the compression", "sensor");
+    private static final Counter STORED = Metrics.counter(
+            "smartgarden_compression_stored_total", "Sensor samples written to the database", "sensor");
+
+    private final SampleStore db;
+    private final Map<String, Method> methods = new ConcurrentHashMap<>();
+    private final Map<String, Float> deviations = new ConcurrentHashMap<>();
+    // sensor -> series state; the sensor tables have no device column, so the
+    // samples of every node of a sensor make up one series, as they are stored
+    private final Map<String, Series> series = new ConcurrentHashMap<>();
+
+    public SampleCompressor(SampleStore db) {
+        this.db = db;
+    }
+
+    /**
+     * Sets the method and bound of a sensor (null deviation: the default one)
+     * and records it in the database.
+     */
+    public void configure(String sensor, Method method, Float deviation) {
+        float bound = deviation != null ? deviation : DEFAULT_DEVIATIONS.getOrDefault(sensor, 0f);
+        if (bound <= 0f) method = Method.NONE;
+        methods.put(sensor, method);
+        deviations.put(sensor, bound);
+        db.insertCompression(sensor, method.name().toLowerCase(), bound);
+        ConsoleUtils.println(LOG + " " + sensor + ": " + method.name().toLowerCase()
+                + (method == Method.NONE ? "" : ", deviation " + bound));
+    }
+
+    /**
+     * Method named in the configuration ("swinging-door", "deadband", "none");
+     * swinging door when missing.
+     */
+    public static Method parseMethod(String name) {
+        if (name == null) return Method.SWINGING_DOOR;
+        return Method.valueOf(name.trim().toUpperCase().replace('-', '_'));
+    }
+
+    /**
+     * Takes a sample of a sensor received at atMillis. Returns
+     * false when a row it had to write could not be stored; a sample left out
+     * by the compression counts as stored, since the series rebuilds it.
+     */
+    public boolean offer(String sensor, float value, long atMillis) {
+        RECEIVED.inc(sensor);
+        Method method = methods.getOrDefault(sensor, Method.NONE);
+        if (method == Method.NONE) {
+            return store(sensor, value, atMillis);
+        }
+
+        Series s = series.computeIfAbsent(sensor, k -> new Series(sensor, method, deviations.get(sensor)));
+        synchronized (s) {
+            return s.offer(value, atMillis);
+        }
+    }
+
+    /**
+     * Stores the samples held by the swinging door, so the series end at the
+     * last value received. Called at shutdown, before the DB is closed.
+     */
+    public void flush() {
+        for (Series s : series.values()) {
+            synchronized (s) {
+                s.flush();
+            }
+        }
+    }
+
+    private boolean store(String sensor, float value, long atMillis) {
+        if (!db.insertSample(sensor, value, atMillis)) return false;
+        STORED.inc(sensor);
+        return true;
+    }
+
+    private class Series {
+
+        private final String sensor;
+        private final Method method;
+        private final float deviation;
+
+        private boolean started;
+        private long anchorAt;      // last stored sample
+        private float anchorValue;
+        private boolean holding;    // a sample newer than the anchor is not stored yet
+        private long lastAt;
+        private float lastValue;
+        // the door: slopes (per ms) from the anchor that keep every sample since within the bound
+        private double upperSlope;
+        private double lowerSlope;
+
+        Series(String sensor, Method method, float deviation) {
+            this.sensor = sensor;
+            this.method = method;
+            this.deviation = deviation;
+        }
+
+        boolean offer(float value, long at) {
+            if (!started) {
+                started = true;
+                return archive(value, at);
+            }
+
+            if (method == Method.DEADBAND) {
+                if (Math.abs(value - anchorValue) > deviation || at - anchorAt >= MAX_GAP_MS) {
+                    return archive(value, at);
+                }
+                return true;
+            }
+
+            boolean stored = true;
+            if (holding && lastAt - anchorAt >= MAX_GAP_MS) {
+                stored = archiveHeld();
+            }
+
+            long dt = Math.max(1, at - anchorAt);
+            double upper = (value + deviation - anchorValue) / dt;
+            double lower = (value - deviation - anchorValue) / dt;
+
+            if (holding && Math.max(lowerSlope, lower) > Math.min(upperSlope, upper)) {
+                // the door closed: the held sample ends the segment and starts the next one
+                stored &= archiveHeld();
+                dt = Math.max(1, at - anchorAt);
+                upper = (value + deviation - anchorValue) / dt;
+                lower = (value - deviation - anchorValue) / dt;
+            }
+            upperSlope = holding ? Math.min(upperSlope, upper) : upper;
+            lowerSlope = holding ? Math.max(lowerSlope, lower) : lower;
+
+            holding = true;
+            lastAt = at;
+            lastValue = value;
+            return stored;
+        }
+
+        void flush() {
+            if (holding) archiveHeld();
+        }
+
+        // the held sample moved onto the door, so the segment bounds every sample in it
+        private boolean archiveHeld() {
+            long dt = Math.max(1, lastAt - anchorAt);
+            double slope = Math.min(Math.max((lastValue - anchorValue) / (double) dt, lowerSlope), upperSlope);
+            return archive((float) (anchorValue + slope * dt), lastAt);
+        }
+
+        private boolean archive(float value, long at) {
+            boolean stored = store(sensor, value, at);
+            anchorAt = at;
+            anchorValue = value;
+            holding = false;
+            return stored;
+        }
+    }
+}
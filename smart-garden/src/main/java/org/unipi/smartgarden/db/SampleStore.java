@@ -0,0 +1,46 @@
+package org.unipi.smartgarden.db;
+
+/**
+ * SampleStore - Where the backend keeps sensor samples, actuator states and
+ * mode events. DBDriver stores them in MySQL (or any MySQL-compatible JDBC
+ * database), SegmentStore in local segment files for deployments without a
+ * database server.
+ *
+ * Sample types are the sensor names (temperature, pH, light, soilMoisture) and
+ * the actuator names; actuator values are 0/1, fertilizer 0 off, 1 acidic,
+ * 2 alkaline. Writes return false when the sample could not be stored.
+ */
+public interface SampleStore extends AutoCloseable {
+
+    /**
+     * Sample received now.
+     */
+    boolean insertSample(String type, float value, Float level);
+
+    /**
+     * Sensor sample taken at an earlier time (milliseconds since the epoch).
+     */
+    boolean insertSample(String type, float value, long timestampMillis);
+
+    boolean insertModeEvent(String actuator, String mode);
+
+    /**
+     * Records the compression applied to a sensor series from now on.
+     */
+    boolean insertCompression(String sensor, String method, float deviation);
+
+    /**
+     * Calls the visitor for every sample of a type with from <= timestamp < to,
+     * in insertion order, and returns how many there were.
+     */
+    long scan(String type, long fromMillis, long toMillis, SampleVisitor visitor);
+
+    @Override
+    void close();
+
+    @FunctionalInterface
+    interface SampleVisitor {
+
+        void visit(long timestampMillis, float value);
+    }
+}
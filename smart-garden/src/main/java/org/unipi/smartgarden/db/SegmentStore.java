@@ -0,0 +1,430 @@
+package org.unipi.smartgarden.db;
+
+import org.unipi.smartgarden.metrics.Counter;
+import org.unipi.smartgarden.metrics.Metrics;
+import org.unipi.smartgarden.util.ConsoleUtils;
+
+import java.io.IOException;
+import java.nio.BufferUnderflowException;
+import java.nio.ByteBuffer;
+import java.nio.channels.FileChannel;
+import java.nio.charset.StandardCharsets;
+import java.nio.file.DirectoryStream;
+import java.nio.file.Files;
+import java.nio.file.Path;
+import java.nio.file.StandardOpenOption;
+import java.util.Arrays;
+import java.util.HashSet;
+import java.util.Map;
+import java.util.Set;
+import java.util.TreeMap;
+import java.util.concurrent.ConcurrentHashMap;
+import java.util.concurrent.Executors;
+import java.util.concurrent.ScheduledExecutorService;
+import java.util.concurrent.TimeUnit;
+import java.util.regex.Pattern;
+
+/**
+ * SegmentStore - Embedded, append-only SampleStore for deployments without a
+ * database server.
+ *
+ * Each sample type has its own directory with one segment file per UTC day,
+ * [dir]/[type]/[day start millis].seg. A segment is a sequence of blocks, each
+ * a 32-byte header (payload length, sample count, first, min and max
+ * timestamp) and a payload with one entry per sample: the timestamp as a
+ * zig-zag varint delta-of-delta, then the value XORed with the previous one
+ * (one byte with the trailing zero count + 1, 0 for an equal value, and the
+ * shifted XOR as a varint). Regular samples take 2-4 bytes instead of a row.
+ *
+ * Samples are buffered per type in an open block, written when it is full or
+ * every FLUSH_INTERVAL_S seconds, so a crash loses at most that much; a block
+ * torn by a crash is cut off the end of the file before the next append.
+ * Range scans memory-map the segments and skip the blocks outside the range
+ * by their header. Mode events and compression settings are rare and go to
+ * CSV files next to the segments.
+ */
+public class SegmentStore implements SampleStore {
+
+    private static final String LOG = "[Segment Store]";
+
+    static final long PARTITION_MS = 24 * 60 * 60 * 1000L;
+    private static final int BLOCK_SAMPLES = 1024;
+    private static final long FLUSH_INTERVAL_S = 10;
+    private static final int HEADER_BYTES = 32;
+    private static final String SEGMENT_SUFFIX = ".seg";
+    private static final Pattern TYPE_NAME = Pattern.compile("[A-Za-z_]+");
+
+    private static final Counter BYTES_WRITTEN = Metrics.counter(
+            "smartgarden_store_bytes_written_total", "Bytes appended to the segment files", "type");
+
+    private final Path dir;
+    private final Map<String, Series> series = new ConcurrentHashMap<>();
+    private final ScheduledExecutorService flusher = Executors.newSingleThreadScheduledExecutor(r -> {
+        Thread t = new Thread(r, "segment-flush");
+        t.setDaemon(true);
+        return t;
+    });
+    private volatile boolean closed;
+
+    public SegmentStore(Path dir) throws IOException {
+        this.dir = dir;
+        Files.createDirectories(dir);
+        flusher.scheduleWithFixedDelay(this::flushAll, FLUSH_INTERVAL_S, FLUSH_INTERVAL_S, TimeUnit.SECONDS);
+        ConsoleUtils.println(LOG + " Storing samples under " + dir.toAbsolutePath());
+    }
+
+    @Override
+    public boolean insertSample(String type, float value, Float level) {
+        return insertSample(type, value, System.currentTimeMillis());
+    }
+
+    @Override
+    public boolean insertSample(String type, float value, long timestampMillis) {
+        if (closed) return false;
+        if (!TYPE_NAME.matcher(type).matches()) {
+            ConsoleUtils.printError(LOG + " Invalid data type: " + type);
+            return false;
+        }
+        Series s = series.computeIfAbsent(type, Series::new);
+        try {
+            s.append(timestampMillis, value);
+            return true;
+        } catch (IOException e) {
+            ConsoleUtils.printError(LOG + " Failed to write " + type + ": " + e.getMessage());
+            return false;
+        }
+    }
+
+    @Override
+    public boolean insertModeEvent(String actuator, String mode) {
+        return appendLine("actuator_mode.csv", System.currentTimeMillis() + "," + actuator + "," + mode);
+    }
+
+    @Override
+    public boolean insertCompression(String sensor, String method, float deviation) {
+        return appendLine("sample_compression.csv",
+                System.currentTimeMillis() + "," + sensor + "," + method + "," + deviation);
+    }
+
+    private synchronized boolean appendLine(String file, String line) {
+        if (closed) return false;
+        try {
+            Files.writeString(dir.resolve(file), line + "\n", StandardCharsets.UTF_8,
+                    StandardOpenOption.CREATE, StandardOpenOption.APPEND);
+            return true;
+        } catch (IOException e) {
+            ConsoleUtils.printError(LOG + " Failed to write " + file + ": " + e.getMessage());
+            return false;
+        }
+    }
+
+    @Override
+    public long scan(String type, long fromMillis, long toMillis, SampleVisitor visitor) {
+        if (!TYPE_NAME.matcher(type).matches() || fromMillis >= toMillis) return 0;
+
+        // partition start -> segment
+        Map<Long, Path> segments = new TreeMap<>();
+        Path typeDir = dir.resolve(type);
+        if (Files.isDirectory(typeDir)) {
+            try (DirectoryStream<Path> files = Files.newDirectoryStream(typeDir, "*" + SEGMENT_SUFFIX)) {
+                for (Path file : files) {
+                    long start = partitionOf(file);
+                    if (start + PARTITION_MS > fromMillis && start < toMillis) segments.put(start, file);
+                }
+            } catch (IOException e) {
+                ConsoleUtils.printError(LOG + " Cannot list " + typeDir + ": " + e.getMessage());
+                return 0;
+            }
+        }
+
+        Series open = series.get(type);
+        long count = 0;
+        boolean openScanned = false;
+        for (Map.Entry<Long, Path> entry : segments.entrySet()) {
+            if (open != null && open.isOpen(entry.getKey())) {
+                count += open.scanOpen(entry.getValue(), fromMillis, toMillis, visitor);
+                openScanned = true;
+            } else {
+                count += scanSegment(entry.getValue(), Long.MAX_VALUE, fromMillis, toMillis, visitor);
+            }
+        }
+        if (open != null && !openScanned) {
+            count += open.scanOpen(null, fromMillis, toMillis, visitor);
+        }
+        return count;
+    }
+
+    // the blocks in the first maxSize bytes of a segment
+    private static long scanSegment(Path file, long maxSize, long from, long to, SampleVisitor visitor) {
+        try (FileChannel channel = FileChannel.open(file, StandardOpenOption.READ)) {
+            long size = Math.min(channel.size(), maxSize);
+            if (size == 0) return 0;
+            ByteBuffer segment = channel.map(FileChannel.MapMode.READ_ONLY, 0, size);
+
+            long count = 0;
+            int pos = 0;
+            while (pos + HEADER_BYTES <= size) {
+                int length = segment.getInt(pos);
+                if (length < 0 || pos + HEADER_BYTES + (long) length > size) break;  // torn block
+                int samples = segment.getInt(pos + 4);
+                long first = segment.getLong(pos + 8);
+                long min = segment.getLong(pos + 16);
+                long max = segment.getLong(pos + 24);
+                if (max >= from && min < to) {
+                    try {
+                        count += decode(segment, pos + HEADER_BYTES, length, samples, first, from, to, visitor);
+                    } catch (BufferUnderflowException | IndexOutOfBoundsException e) {
+                        // the header holds, the payload does not: skip the block like a torn one
+                        ConsoleUtils.printError(LOG + " Corrupt block at " + pos + " in " + file + ", skipped");
+                    }
+                }
+                pos += HEADER_BYTES + length;
+            }
+            return count;
+        } catch (IOException e) {
+            ConsoleUtils.printError(LOG + " Cannot read " + file + ": " + e.getMessage());
+            return 0;
+        }
+    }
+
+    // reads at most length bytes from offset: a corrupt payload underflows instead of reading on
+    private static long decode(ByteBuffer buffer, int offset, int length, int samples, long first,
+                               long from, long to, SampleVisitor visitor) {
+        ByteBuffer in = buffer.duplicate();
+        in.limit(offset + length);
+        in.position(offset);
+
+        long count = 0;
+        long ts = first;
+        long delta = 0;
+        int bits = 0;
+        for (int i = 0; i < samples; i++) {
+            delta += unzigzag(readVarLong(in));
+            ts += delta;
+            int trailing = in.get() & 0xff;
+            if (trailing != 0) bits ^= (int) (readVarLong(in) << (trailing - 1));
+
+            if (ts >= from && ts < to) {
+                visitor.visit(ts, Float.intBitsToFloat(bits));
+                count++;
+            }
+        }
+        return count;
+    }
+
+    /**
+     * Writes the open blocks; run periodically and at close.
+     */
+    public void flushAll() {
+        for (Series s : series.values()) {
+            try {
+                s.flush();
+            } catch (IOException e) {
+                ConsoleUtils.printError(LOG + " Failed to flush " + s.type + ": " + e.getMessage());
+            }
+        }
+    }
+
+    @Override
+    public void close() {
+        flusher.shutdown();
+        flushAll();
+        closed = true;
+        ConsoleUtils.println(LOG + " Closed.");
+    }
+
+    static long partitionOf(long timestampMillis) {
+        return Math.floorDiv(timestampMillis, PARTITION_MS) * PARTITION_MS;
+    }
+
+    private static long partitionOf(Path segment) {
+        String name = segment.getFileName().toString();
+        try {
+            return Long.parseLong(name.substring(0, name.length() - SEGMENT_SUFFIX.length()));
+        } catch (NumberFormatException e) {
+            return Long.MIN_VALUE / 2;  // not ours, never in range
+        }
+    }
+
+    // cuts a block left incomplete by a crash, so the next one is appended after the last good one
+    private static void repair(Path file) throws IOException {
+        if (!Files.exists(file)) return;
+        try (FileChannel channel = FileChannel.open(file, StandardOpenOption.READ, StandardOpenOption.WRITE)) {
+            long size = channel.size();
+            long pos = 0;
+            ByteBuffer header = ByteBuffer.allocate(4);
+            while (pos + HEADER_BYTES <= size) {
+                header.clear();
+                channel.read(header, pos);
+                int length = header.getInt(0);
+                if (length < 0 || pos + HEADER_BYTES + (long) length > size) break;
+                pos += HEADER_BYTES + length;
+            }
+            if (pos < size) {
+                ConsoleUtils.printError(LOG + " Cutting a torn block off " + file);
+                channel.truncate(pos);
+            }
+        }
+    }
+
+    private static long zigzag(long v) {
+        return (v << 1) ^ (v >> 63);
+    }
+
+    private static long unzigzag(long v) {
+        return (v >>> 1) ^ -(v & 1);
+    }
+
+    private static long readVarLong(ByteBuffer in) {
+        long value = 0;
+        int shift = 0;
+        byte b;
+        do {
+            b = in.get();
+            value |= (long) (b & 0x7f) << shift;
+            shift += 7;
+        } while (b < 0);
+        return value;
+    }
+
+    private class Series {
+
+        private final String type;
+        private final Path typeDir;
+        private final Block block = new Block();
+        private final Set<Path> repaired = new HashSet<>();
+        private long partition;  // of the open block, valid while it has samples
+
+        Series(String type) {
+            this.type = type;
+            this.typeDir = dir.resolve(type);
+        }
+
+        synchronized void append(long ts, float value) throws IOException {
+            long p = partitionOf(ts);
+            if (block.count > 0 && p != partition) flush();
+            partition = p;
+            block.add(ts, value);
+            if (block.count >= BLOCK_SAMPLES) flush();
+        }
+
+        synchronized void flush() throws IOException {
+            if (block.count == 0) return;
+
+            Path file = typeDir.resolve(partition + SEGMENT_SUFFIX);
+            if (repaired.add(file)) {
+                Files.createDirectories(typeDir);
+                repair(file);
+            }
+            ByteBuffer data = block.toBuffer();
+            int size = data.remaining();
+            try (FileChannel channel = FileChannel.open(file, StandardOpenOption.CREATE,
+                    StandardOpenOption.WRITE, StandardOpenOption.APPEND)) {
+                while (data.hasRemaining()) channel.write(data);
+            }
+            BYTES_WRITTEN.add(type, size);
+            block.reset();
+        }
+
+        synchronized boolean isOpen(long partitionStart) {
+            return block.count > 0 && partition == partitionStart;
+        }
+
+        // the segment of the open partition (null if none yet), then the open block. The
+        // segment size and a copy of the block are taken under the lock, so a flush cannot
+        // move samples meanwhile, and decoded outside it, so a slow visitor does not hold
+        // up append
+        long scanOpen(Path segment, long from, long to, SampleVisitor visitor) {
+            long segmentSize = 0;
+            byte[] bytes = null;
+            int samples = 0;
+            long first = 0;
+            synchronized (this) {
+                if (segment != null) {
+                    try {
+                        segmentSize = Files.size(segment);
+                    } catch (IOException e) {
+                        segmentSize = 0;  // not written yet
+                    }
+                }
+                if (block.count > 0 && block.max >= from && block.min < to) {
+                    bytes = Arrays.copyOf(block.bytes, block.length);
+                    samples = block.count;
+                    first = block.first;
+                }
+            }
+
+            long count = segmentSize > 0 ? scanSegment(segment, segmentSize, from, to, visitor) : 0;
+            if (bytes != null) {
+                count += decode(ByteBuffer.wrap(bytes), 0, bytes.length, samples, first, from, to, visitor);
+            }
+            return count;
+        }
+    }
+
+    // samples not written yet, already encoded
+    private static class Block {
+
+        private byte[] bytes = new byte[256];
+        private int length;
+        private int count;
+        private long first;
+        private long min;
+        private long max;
+        private long previousTs;
+        private long previousDelta;
+        private int previousBits;
+
+        void add(long ts, float value) {
+            if (count == 0) {
+                first = min = max = previousTs = ts;
+                previousDelta = 0;
+                previousBits = 0;
+            }
+            long delta = ts - previousTs;
+            writeVarLong(zigzag(delta - previousDelta));
+            previousDelta = delta;
+            previousTs = ts;
+
+            int bits = Float.floatToRawIntBits(value);
+            int xor = bits ^ previousBits;
+            previousBits = bits;
+            if (xor == 0) {
+                writeByte(0);
+            } else {
+                int trailing = Integer.numberOfTrailingZeros(xor);
+                writeByte(trailing + 1);
+                writeVarLong((xor >>> trailing) & 0xffffffffL);
+            }
+
+            min = Math.min(min, ts);
+            max = Math.max(max, ts);
+            count++;
+        }
+
+        ByteBuffer toBuffer() {
+            ByteBuffer buffer = ByteBuffer.allocate(HEADER_BYTES + length);
+            buffer.putInt(length).putInt(count).putLong(first).putLong(min).putLong(max);
+            buffer.put(bytes, 0, length);
+            return buffer.flip();
+        }
+
+        void reset() {
+            length = 0;
+            count = 0;
+        }
+
+        private void writeVarLong(long v) {
+            while ((v & ~0x7fL) != 0) {
+                writeByte((int) ((v & 0x7f) | 0x80));
+                v >>>= 7;
+            }
+            writeByte((int) v);
+        }
+
+        private void writeByte(int b) {
+            if (length == bytes.length) bytes = Arrays.copyOf(bytes, length * 2);
+            bytes[length++] = (byte) b;
+        }
+    }
+}
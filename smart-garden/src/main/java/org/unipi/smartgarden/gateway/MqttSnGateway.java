@@ -0,0 +1,325 @@
+package org.unipi.smartgarden.gateway;
+
+import org.eclipse.paho.client.mqttv3.IMqttDeliveryToken;
+import org.eclipse.paho.client.mqttv3.MqttCallbackExtended;
+import org.eclipse.paho.client.mqttv3.MqttClient;
+import org.eclipse.paho.client.mqttv3.MqttConnectOptions;
+import org.eclipse.paho.client.mqttv3.MqttException;
+import org.eclipse.paho.client.mqttv3.MqttMessage;
+import org.eclipse.paho.client.mqttv3.persist.MemoryPersistence;
+import org.unipi.smartgarden.util.AsyncLogger;
+import org.unipi.smartgarden.util.ConsoleUtils;
+
+import java.io.IOException;
+import java.net.DatagramPacket;
+import java.net.DatagramSocket;
+import java.net.InetSocketAddress;
+import java.net.SocketAddress;
+import java.nio.charset.StandardCharsets;
+import java.util.Arrays;
+import java.util.Map;
+import java.util.Set;
+import java.util.concurrent.ConcurrentHashMap;
+import java.util.concurrent.ExecutorService;
+import java.util.concurrent.Executors;
+
+/**
+ * MqttSnGateway - Aggregating MQTT-SN v1.2 gateway for the sensor nodes built
+ * with MAKE_WITH_MQTT_SN=1. Nodes talk UDP to the gateway using predefined topic
+ * ids (see mqtt-sn-client.h); the gateway keeps one MQTT connection to the broker,
+ * forwards the nodes' PUBLISH to the matching topics and fans out the broker
+ * messages to the nodes subscribed to them. The backend sees plain MQTT.
+ * Only QoS 0 and predefined topic ids are supported.
+ *
+ * java -cp smartgarden-app-...-jar-with-dependencies.jar org.unipi.smartgarden.gateway.MqttSnGateway
+ *      --port 1885 --broker tcp://localhost:1883
+ */
+public class MqttSnGateway implements MqttCallbackExtended {
+
+    private static final String LOG = "[MQTT-SN Gateway]";
+    private static final String CLIENT_ID = "SmartGardenMqttSnGateway";
+
+    // predefined topic ids, index = id; keep in sync with mqtt-sn-client.h
+    static final String[] TOPICS = {
+            null, "temperature", "pH", "light", "soilMoisture",
+            "grow_light", "irrigation", "fertilizer", "fan", "heater", "smartgarden/time",
+            "smartgarden/rate"
+    };
+    // smartgarden/rate/<client id>: one id for all the nodes, routed by session
+    private static final int RATE_TOPIC_ID = 11;
+    private static final String RATE_TOPIC_PREFIX = TOPICS[RATE_TOPIC_ID] + "/";
+
+    private static final int CONNECT = 0x04;
+    private static final int CONNACK = 0x05;
+    private static final int PUBLISH = 0x0C;
+    private static final int SUBSCRIBE = 0x12;
+    private static final int SUBACK = 0x13;
+    private static final int PINGREQ = 0x16;
+    private static final int PINGRESP = 0x17;
+    private static final int DISCONNECT = 0x18;
+
+    private static final int TOPIC_ID_PREDEFINED = 0x01;
+    private static final int RC_ACCEPTED = 0x00;
+    private static final int RC_INVALID_TOPIC = 0x02;
+    private static final int RC_NOT_SUPPORTED = 0x03;
+
+    private static final int MAX_PACKET = 255;
+
+    private final DatagramSocket socket;
+    private final MqttClient broker;
+    private final Map<SocketAddress, Session> sessions = new ConcurrentHashMap<>();
+    // last (retained) rate message per client id, replayed when the node subscribes
+    private final Map<String, byte[]> rates = new ConcurrentHashMap<>();
+    // subscribing blocks, so it never runs on the Paho callback thread
+    private final ExecutorService subscriber = Executors.newSingleThreadExecutor(r -> {
+        Thread t = new Thread(r, "mqtt-sn-subscribe");
+        t.setDaemon(true);
+        return t;
+    });
+
+    private volatile boolean running = true;
+
+    public MqttSnGateway(int port, String brokerUri) throws IOException, MqttException {
+        socket = new DatagramSocket(new InetSocketAddress(port));
+
+        broker = new MqttClient(brokerUri, CLIENT_ID, new MemoryPersistence());
+        broker.setCallback(this);
+        MqttConnectOptions options = new MqttConnectOptions();
+        options.setAutomaticReconnect(true);
+        options.setCleanSession(true);
+        broker.connect(options);
+        subscribe();
+        ConsoleUtils.println(LOG + " Listening on UDP port " + port + ", broker " + brokerUri);
+    }
+
+    // the node subscriptions are local: the gateway listens to every mapped topic once
+    private void subscribe() throws MqttException {
+        for (int id = 1; id < TOPICS.length; id++) {
+            broker.subscribe(id == RATE_TOPIC_ID ? RATE_TOPIC_PREFIX + "+" : TOPICS[id], 0);
+        }
+    }
+
+    public static void main(String[] args) throws Exception {
+        int port = 1885;
+        String brokerUri = "tcp://localhost:1883";
+        for (int i = 0; i + 1 < args.length; i += 2) {
+            switch (args[i]) {
+                case "--port" -> port = Integer.parseInt(args[i + 1]);
+                case "--broker" -> brokerUri = args[i + 1];
+                default -> throw new IllegalArgumentException("Unknown option: " + args[i]);
+            }
+        }
+
+        ConsoleUtils.setConsoleLevel(AsyncLogger.Level.INFO);
+        MqttSnGateway gateway = new MqttSnGateway(port, brokerUri);
+        Runtime.getRuntime().addShutdownHook(new Thread(gateway::close));
+        gateway.run();
+    }
+
+    /**
+     * Receive loop; returns when the gateway is closed.
+     */
+    public void run() {
+        byte[] buffer = new byte[MAX_PACKET];
+        while (running) {
+            DatagramPacket packet = new DatagramPacket(buffer, buffer.length);
+            try {
+                socket.receive(packet);
+            } catch (IOException e) {
+                if (running) ConsoleUtils.printError(LOG + " Receive failed: " + e.getMessage());
+                continue;
+            }
+            expireSessions();
+            handle(packet.getSocketAddress(), Arrays.copyOf(packet.getData(), packet.getLength()));
+        }
+    }
+
+    private void handle(SocketAddress from, byte[] data) {
+        if (data.length < 2) return;
+        int length = data[0] & 0xff;
+        if (length < 2 || length > data.length) return;
+
+        int type = data[1] & 0xff;
+        Session session = sessions.get(from);
+        if (session != null) {
+            session.touch();
+        } else if (type == SUBSCRIBE || type == PUBLISH || type == PINGREQ) {
+            // expired or from before a gateway restart: the node must connect again
+            ConsoleUtils.debug(LOG + " No session for " + from + ", sending DISCONNECT");
+            send(from, new byte[]{2, DISCONNECT});
+            return;
+        }
+
+        switch (type) {
+            case CONNECT -> {
+                if (length < 6) return;
+                int keepAlive = u16(data, 4);
+                String clientId = new String(data, 6, length - 6, StandardCharsets.UTF_8);
+                sessions.put(from, new Session(clientId, keepAlive));
+                ConsoleUtils.println(LOG + " " + clientId + " connected from " + from);
+                send(from, new byte[]{3, CONNACK, RC_ACCEPTED});
+            }
+            case SUBSCRIBE -> {
+                if (length < 7) return;
+                int msgId = u16(data, 3);
+                int topicId = u16(data, 5);
+                int rc;
+                if ((data[2] & 0x03) != TOPIC_ID_PREDEFINED) {
+                    rc = RC_NOT_SUPPORTED;
+                } else if (topicName(topicId) == null) {
+                    rc = RC_INVALID_TOPIC;
+                } else {
+                    session.topics.add(topicId);
+                    rc = RC_ACCEPTED;
+                }
+                send(from, new byte[]{8, SUBACK, 0, (byte) (topicId >> 8), (byte) topicId,
+                        (byte) (msgId >> 8), (byte) msgId, (byte) rc});
+
+                byte[] rate = rates.get(session.clientId);
+                if (rc == RC_ACCEPTED && topicId == RATE_TOPIC_ID && rate != null) {
+                    send(from, publishPacket(RATE_TOPIC_ID, rate));
+                }
+            }
+            case PUBLISH -> {
+                if (length < 7) return;
+                String topic = topicName(u16(data, 3));
+                if ((data[2] & 0x03) != TOPIC_ID_PREDEFINED || topic == null) return;
+                try {
+                    broker.publish(topic, Arrays.copyOfRange(data, 7, length), 0, false);
+                } catch (MqttException e) {
+                    ConsoleUtils.printError(LOG + " Forward of " + topic + " from " + session.clientId
+                            + " failed: " + e.getMessage());
+                }
+            }
+            case PINGREQ -> send(from, new byte[]{2, PINGRESP});
+            case DISCONNECT -> {
+                if (sessions.remove(from) != null) {
+                    ConsoleUtils.println(LOG + " " + session.clientId + " disconnected");
+                }
+                send(from, new byte[]{2, DISCONNECT});
+            }
+            default -> ConsoleUtils.debug(LOG + " Ignoring message type " + type + " from " + from);
+        }
+    }
+
+    @Override
+    public void messageArrived(String topic, MqttMessage message) {
+        String rateClient = topic.startsWith(RATE_TOPIC_PREFIX) ? topic.substring(RATE_TOPIC_PREFIX.length()) : null;
+        int topicId = rateClient != null ? RATE_TOPIC_ID : topicId(topic);
+        if (topicId == 0) return;
+
+        if (rateClient != null) {
+            if (message.getPayload().length == 0) {
+                rates.remove(rateClient);
+                return;
+            }
+            rates.put(rateClient, message.getPayload());
+        }
+
+        byte[] packet = publishPacket(topicId, message.getPayload());
+        for (Map.Entry<SocketAddress, Session> entry : sessions.entrySet()) {
+            Session session = entry.getValue();
+            if (session.topics.contains(topicId) && (rateClient == null || rateClient.equals(session.clientId))) {
+                send(entry.getKey(), packet);
+            }
+        }
+    }
+
+    private static byte[] publishPacket(int topicId, byte[] payload) {
+        int length = Math.min(7 + payload.length, MAX_PACKET);
+        byte[] packet = new byte[length];
+        packet[0] = (byte) length;
+        packet[1] = PUBLISH;
+        packet[2] = TOPIC_ID_PREDEFINED;
+        packet[3] = (byte) (topicId >> 8);
+        packet[4] = (byte) topicId;
+        System.arraycopy(payload, 0, packet, 7, length - 7);
+        return packet;
+    }
+
+    @Override
+    public void connectComplete(boolean reconnect, String serverURI) {
+        if (!reconnect) return;
+        // clean session: the broker forgot the subscriptions
+        subscriber.execute(() -> {
+            try {
+                subscribe();
+                ConsoleUtils.println(LOG + " Reconnected to " + serverURI + ", subscriptions restored");
+            } catch (MqttException e) {
+                ConsoleUtils.printError(LOG + " Resubscribe failed: " + e.getMessage());
+            }
+        });
+    }
+
+    @Override
+    public void connectionLost(Throwable cause) {
+        ConsoleUtils.printError(LOG + " Broker connection lost: " + cause.getMessage());
+    }
+
+    @Override
+    public void deliveryComplete(IMqttDeliveryToken token) {
+    }
+
+    // a node that missed 1.5 keep-alive periods is gone (MQTT-SN 6.6)
+    private void expireSessions() {
+        long now = System.currentTimeMillis();
+        sessions.entrySet().removeIf(entry -> {
+            Session s = entry.getValue();
+            boolean expired = s.keepAliveSeconds > 0 && now - s.lastSeen > s.keepAliveSeconds * 1500L;
+            if (expired) ConsoleUtils.println(LOG + " " + s.clientId + " timed out");
+            return expired;
+        });
+    }
+
+    private void send(SocketAddress to, byte[] packet) {
+        try {
+            socket.send(new DatagramPacket(packet, packet.length, to));
+        } catch (IOException e) {
+            ConsoleUtils.printError(LOG + " Send to " + to + " failed: " + e.getMessage());
+        }
+    }
+
+    public void close() {
+        running = false;
+        subscriber.shutdownNow();
+        socket.close();
+        try {
+            if (broker.isConnected()) broker.disconnect();
+            broker.close();
+        } catch (MqttException e) {
+            ConsoleUtils.printError(LOG + " Error closing broker connection: " + e.getMessage());
+        }
+    }
+
+    static String topicName(int topicId) {
+        return topicId > 0 && topicId < TOPICS.length ? TOPICS[topicId] : null;
+    }
+
+    static int topicId(String topic) {
+        for (int id = 1; id < TOPICS.length; id++) {
+            if (TOPICS[id].equals(topic)) return id;
+        }
+        return 0;
+    }
+
+    private static int u16(byte[] data, int offset) {
+        return ((data[offset] & 0xff) << 8) | (data[offset + 1] & 0xff);
+    }
+
+    private static class Session {
+
+        private final String clientId;
+        private final int keepAliveSeconds;
+        private final Set<Integer> topics = ConcurrentHashMap.newKeySet();
+        private volatile long lastSeen = System.currentTimeMillis();
+
+        Session(String clientId, int keepAliveSeconds) {
+            this.clientId = clientId;
+            this.keepAliveSeconds = keepAliveSeconds;
+        }
+
+        void touch() {
+            lastSeen = System.currentTimeMillis();
+        }
+    }
+}
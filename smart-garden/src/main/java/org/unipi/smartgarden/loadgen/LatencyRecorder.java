@@ -0,0 +1,57 @@
+package org.unipi.smartgarden.loadgen;
+
+import java.util.Arrays;
+import java.util.concurrent.atomic.AtomicInteger;
+import java.util.concurrent.atomic.AtomicLong;
+import java.util.concurrent.atomic.AtomicLongArray;
+
+/**
+ * LatencyRecorder - Keeps raw latency samples (ms) in a fixed array so exact
+ * percentiles can be computed at report time. Past capacity, samples are
+ * still counted but no longer stored.
+ */
+public class LatencyRecorder {
+
+    private final AtomicLongArray samples;
+    private final AtomicInteger next = new AtomicInteger();
+    private final AtomicLong count = new AtomicLong();
+
+    public LatencyRecorder(int capacity) {
+        this.samples = new AtomicLongArray(capacity);
+    }
+
+    public void record(long millis) {
+        count.incrementAndGet();
+        int i = next.getAndIncrement();
+        if (i < samples.length()) {
+            samples.set(i, millis);
+        }
+    }
+
+    public long getCount() {
+        return count.get();
+    }
+
+    /**
+     * "p50=.. p90=.. p99=.. max=.. ms" over the stored samples.
+     */
+    public String summary() {
+        int n = Math.min(next.get(), samples.length());
+        if (n == 0) return "no samples";
+
+        long[] sorted = new long[n];
+        for (int i = 0; i < n; i++) {
+            sorted[i] = samples.get(i);
+        }
+        Arrays.sort(sorted);
+        return "p50=" + percentile(sorted, 0.50)
+                + " p90=" + percentile(sorted, 0.90)
+                + " p99=" + percentile(sorted, 0.99)
+                + " max=" + sorted[n - 1] + " ms (n=" + n + ")";
+    }
+
+    private static long percentile(long[] sorted, double p) {
+        int index = (int) Math.ceil(p * sorted.length) - 1;
+        return sorted[Math.max(0, Math.min(index, sorted.length - 1))];
+    }
+}
@@ -0,0 +1,269 @@
+package org.unipi.smartgarden.loadgen;
+
+import org.eclipse.paho.client.mqttv3.MqttClient;
+import org.eclipse.paho.client.mqttv3.MqttException;
+import org.eclipse.paho.client.mqttv3.MqttMessage;
+import org.eclipse.paho.client.mqttv3.persist.MemoryPersistence;
+import org.unipi.smartgarden.coap.COAPNetworkController;
+import org.unipi.smartgarden.coap.SimulatedActuatorNode;
+import org.unipi.smartgarden.db.DBDriver;
+import org.unipi.smartgarden.db.SampleStore;
+import org.unipi.smartgarden.db.SegmentStore;
+import org.unipi.smartgarden.mqtt.MQTTHandler;
+import org.unipi.smartgarden.mqtt.SampleListener;
+import org.unipi.smartgarden.util.AsyncLogger;
+import org.unipi.smartgarden.util.ConsoleUtils;
+
+import java.nio.file.Path;
+import java.util.ArrayList;
+import java.util.List;
+import java.util.Map;
+import java.util.Random;
+import java.util.UUID;
+import java.util.concurrent.Executors;
+import java.util.concurrent.ScheduledExecutorService;
+import java.util.concurrent.TimeUnit;
+import java.util.concurrent.atomic.AtomicLong;
+
+/**
+ * LoadGenerator - Soak test for the single-node backend. Runs the real ingest
+ * and CoAP paths in-process against a local Mosquitto, driven by N virtual
+ * sensors publishing at a fixed rate and M simulated actuator nodes receiving
+ * commands, then reports sustained throughput and latency percentiles.
+ *
+ * java -cp smartgarden-app-...-jar-with-dependencies.jar org.unipi.smartgarden.loadgen.LoadGenerator
+ *      --sensors 40 --rate 5 --actuators 4 --command-rate 20 --duration 300 --report-every 30
+ *      [--db-url jdbc:... | --data-dir loadgen-data]
+ */
+public class LoadGenerator {
+
+    private static final String LOG = "[Load Generator]";
+
+    private static final String[] SENSOR_TYPES = {"temperature", "pH", "light", "soilMoisture"};
+    private static final List<String> ACTUATORS = List.of("fertilizer", "irrigation", "grow_light", "fan", "heater");
+
+    private static final int PUBLISHER_CLIENTS = 4;
+    private static final int NODE_BASE_PORT = 25683;
+    private static final int MAX_STORED_SAMPLES = 1_000_000;
+
+    // options
+    private int sensors = 20;
+    private double rate = 1.0;          // publishes per second per sensor
+    private int actuatorNodes = 2;
+    private double commandRate = 5.0;   // commands per second, over all nodes
+    private int durationSeconds = 60;
+    private int reportEverySeconds = 0; // 0 = final report only
+    private String brokerUri = "tcp://localhost:1883";
+    private int controllerPort = 5683;
+    private String dbUrl;
+    private String dbUser;
+    private String dbPassword;
+    private String dataDir;             // SegmentStore instead of MySQL
+
+    private final AtomicLong published = new AtomicLong();
+    private final AtomicLong persisted = new AtomicLong();
+    private final AtomicLong publishErrors = new AtomicLong();
+    private final AtomicLong commandFailures = new AtomicLong();
+    private final LatencyRecorder ingestLatency = new LatencyRecorder(MAX_STORED_SAMPLES);
+    private final LatencyRecorder commandLatency = new LatencyRecorder(MAX_STORED_SAMPLES);
+
+    public static void main(String[] args) throws Exception {
+        LoadGenerator generator = new LoadGenerator();
+        generator.parse(args);
+        generator.run();
+        ConsoleUtils.closeLogger();
+        System.exit(0);
+    }
+
+    private void parse(String[] args) {
+        for (int i = 0; i + 1 < args.length; i += 2) {
+            String value = args[i + 1];
+            switch (args[i]) {
+                case "--sensors" -> sensors = Integer.parseInt(value);
+                case "--rate" -> rate = Double.parseDouble(value);
+                case "--actuators" -> actuatorNodes = Integer.parseInt(value);
+                case "--command-rate" -> commandRate = Double.parseDouble(value);
+                case "--duration" -> durationSeconds = Integer.parseInt(value);
+                case "--report-every" -> reportEverySeconds = Integer.parseInt(value);
+                case "--broker" -> brokerUri = value;
+                case "--coap-port" -> controllerPort = Integer.parseInt(value);
+                case "--db-url" -> dbUrl = value;
+                case "--db-user" -> dbUser = value;
+                case "--db-pass" -> dbPassword = value;
+                case "--data-dir" -> dataDir = value;
+                default -> throw new IllegalArgumentException("Unknown option: " + args[i]);
+            }
+        }
+    }
+
+    private void run() throws Exception {
+        ConsoleUtils.setConsoleLevel(AsyncLogger.Level.INFO);
+        ConsoleUtils.println(LOG + " " + sensors + " sensors x " + rate + " msg/s, " + actuatorNodes
+                + " actuator nodes x " + commandRate + " cmd/s, " + durationSeconds + " s");
+
+        // backend under test
+        SampleStore db = dataDir != null ? new SegmentStore(Path.of(dataDir))
+                : dbUrl == null ? new DBDriver() : new DBDriver(dbUrl, dbUser, dbPassword);
+        Map<String, String> topics = Map.of("temperature", "temperature", "pH", "pH",
+                "light", "light", "soilMoisture", "soilMoisture");
+        // own client ids and a clean session: a backend running on the same broker is left alone
+        String runId = UUID.randomUUID().toString().substring(0, 8);
+        MQTTHandler mqttHandler = MQTTHandler.withCleanSession(topics, db, brokerUri, "SmartGardenLoad-" + runId);
+        mqttHandler.addSampleListener(new SampleListener() {
+            @Override
+            public void onSample(String sensorName, float value) {
+            }
+
+            // only samples the store accepted
+            @Override
+            public void onSamplePersisted(String sensorName, float value, long sentAtMillis) {
+                persisted.incrementAndGet();
+                if (sentAtMillis > 0) {
+                    ingestLatency.record(System.currentTimeMillis() - sentAtMillis);
+                }
+            }
+        });
+        COAPNetworkController controller = new COAPNetworkController(ACTUATORS, db, controllerPort);
+
+        // simulated actuator nodes, registered through the real registration resource
+        List<SimulatedActuatorNode> nodes = new ArrayList<>();
+        for (int i = 0; i < actuatorNodes; i++) {
+            SimulatedActuatorNode node = new SimulatedActuatorNode(NODE_BASE_PORT + i, ACTUATORS);
+            node.start();
+            if (!node.registerWith("coap://127.0.0.1:" + controllerPort + "/registration", ACTUATORS)) {
+                ConsoleUtils.printError(LOG + " Registration failed for node on port " + node.getPort());
+            }
+            nodes.add(node);
+        }
+
+        // virtual sensors
+        List<MqttClient> publishers = new ArrayList<>();
+        for (int k = 0; k < Math.min(PUBLISHER_CLIENTS, sensors); k++) {
+            MqttClient client = new MqttClient(brokerUri, "SmartGardenLoad-" + runId + "-" + k,
+                    new MemoryPersistence());
+            client.connect();
+            publishers.add(client);
+        }
+
+        ScheduledExecutorService scheduler = Executors.newScheduledThreadPool(
+                Math.max(2, Runtime.getRuntime().availableProcessors()));
+
+        long sensorPeriodMicros = Math.max(1, (long) (1_000_000 / rate));
+        Random random = new Random();
+        for (int i = 0; i < sensors; i++) {
+            String topic = SENSOR_TYPES[i % SENSOR_TYPES.length];
+            MqttClient client = publishers.get(i % publishers.size());
+            float[] value = {initialValue(topic)};
+            scheduler.scheduleAtFixedRate(() -> {
+                value[0] += (random.nextFloat() - 0.5f) * 0.2f;
+                publish(client, topic, value[0]);
+            }, random.nextInt((int) Math.min(sensorPeriodMicros, Integer.MAX_VALUE)), sensorPeriodMicros,
+                    TimeUnit.MICROSECONDS);
+        }
+
+        // command load: round-robin over every (node, actuator), toggling each time
+        if (commandRate > 0 && !nodes.isEmpty()) {
+            long commandPeriodMicros = Math.max(1, (long) (1_000_000 / commandRate));
+            AtomicLong sequence = new AtomicLong();
+            scheduler.scheduleAtFixedRate(() -> {
+                long n = sequence.getAndIncrement();
+                SimulatedActuatorNode node = nodes.get((int) (n % nodes.size()));
+                String actuator = ACTUATORS.get((int) ((n / nodes.size()) % ACTUATORS.size()));
+                String command = commandFor(actuator, n / ((long) nodes.size() * ACTUATORS.size()));
+                long start = System.nanoTime();
+                controller.sendCommandAsync(actuator, node.uriOf(actuator), command).whenComplete((ok, e) -> {
+                    if (e == null && Boolean.TRUE.equals(ok)) {
+                        commandLatency.record((System.nanoTime() - start) / 1_000_000);
+                    } else {
+                        commandFailures.incrementAndGet();
+                    }
+                });
+            }, 0, commandPeriodMicros, TimeUnit.MICROSECONDS);
+        }
+
+        // run, with interim reports in soak mode
+        long start = System.currentTimeMillis();
+        long end = start + durationSeconds * 1000L;
+        long lastReport = start;
+        long lastPersisted = 0;
+        while (System.currentTimeMillis() < end) {
+            long sleep = reportEverySeconds > 0
+                    ? Math.min(reportEverySeconds * 1000L, end - System.currentTimeMillis())
+                    : end - System.currentTimeMillis();
+            Thread.sleep(Math.max(1, sleep));
+
+            long now = System.currentTimeMillis();
+            if (reportEverySeconds > 0 && now < end) {
+                long stored = persisted.get();
+                ConsoleUtils.println(LOG + " [" + (now - start) / 1000 + " s] ingest "
+                        + String.format("%.1f", (stored - lastPersisted) * 1000.0 / (now - lastReport))
+                        + " msg/s, sample->DB " + ingestLatency.summary());
+                lastPersisted = stored;
+                lastReport = now;
+            }
+        }
+
+        scheduler.shutdownNow();
+        // let in-flight samples and commands drain before the final report
+        Thread.sleep(2000);
+        report(System.currentTimeMillis() - start - 2000);
+
+        for (MqttClient client : publishers) {
+            try {
+                client.disconnect();
+                client.close();
+            } catch (MqttException e) {
+                ConsoleUtils.printError(LOG + " Error closing publisher: " + e.getMessage());
+            }
+        }
+        for (SimulatedActuatorNode node : nodes) {
+            node.close();
+        }
+        controller.close();
+        mqttHandler.close();
+        db.close();
+    }
+
+    private void publish(MqttClient client, String topic, float value) {
+        String json = "{\"" + topic + "\":" + String.format("%.2f", value)
+                + ",\"ts\":" + System.currentTimeMillis() + "}";
+        try {
+            client.publish(topic, new MqttMessage(json.getBytes()));
+            published.incrementAndGet();
+        } catch (MqttException e) {
+            publishErrors.incrementAndGet();
+        }
+    }
+
+    private void report(long elapsedMillis) {
+        long sent = published.get();
+        long persisted = this.persisted.get();
+        double seconds = elapsedMillis / 1000.0;
+
+        ConsoleUtils.println(LOG + " ===== Results over " + String.format("%.0f", seconds) + " s =====");
+        ConsoleUtils.println(LOG + " Published: " + sent + " (" + publishErrors.get() + " publish errors)");
+        ConsoleUtils.println(LOG + " Persisted: " + persisted + " ("
+                + String.format("%.2f", sent == 0 ? 0.0 : 100.0 * (sent - persisted) / sent) + "% not persisted)");
+        ConsoleUtils.println(LOG + " Sustained ingest: " + String.format("%.1f", persisted / seconds) + " msg/s"
+                + " (offered " + String.format("%.1f", sensors * rate) + " msg/s)");
+        ConsoleUtils.println(LOG + " Sample->DB latency: " + ingestLatency.summary());
+        ConsoleUtils.println(LOG + " Command latency: " + commandLatency.summary()
+                + ", failed: " + commandFailures.get());
+    }
+
+    private static float initialValue(String topic) {
+        return switch (topic) {
+            case "temperature" -> 22.0f;
+            case "pH" -> 6.75f;
+            case "light" -> 50.0f;
+            default -> 40.0f;
+        };
+    }
+
+    private static String commandFor(String actuator, long round) {
+        if ("fertilizer".equals(actuator)) {
+            return round % 2 == 0 ? "acidic" : "off";
+        }
+        return round % 2 == 0 ? "on" : "off";
+    }
+}
@@ -0,0 +1,54 @@
+package org.unipi.smartgarden.metrics;
+
+import java.util.Map;
+import java.util.concurrent.ConcurrentHashMap;
+import java.util.concurrent.atomic.LongAdder;
+
+/**
+ * Counter - Monotonic count, optionally split by one label.
+ */
+public class Counter extends Metric {
+
+    private static final String NO_LABEL = "";
+
+    private final Map<String, LongAdder> values = new ConcurrentHashMap<>();
+
+    Counter(String name, String help, String labelName) {
+        super(name, help, labelName);
+    }
+
+    public void inc() {
+        inc(NO_LABEL);
+    }
+
+    public void inc(String labelValue) {
+        values.computeIfAbsent(labelValue, k -> new LongAdder()).increment();
+    }
+
+    public void add(String labelValue, long amount) {
+        values.computeIfAbsent(labelValue, k -> new LongAdder()).add(amount);
+    }
+
+    public long get(String labelValue) {
+        LongAdder adder = values.get(labelValue);
+        return adder == null ? 0 : adder.sum();
+    }
+
+    @Override
+    protected String type() {
+        return "counter";
+    }
+
+    @Override
+    protected void writeSamples(StringBuilder out) {
+        if (values.isEmpty() && labelName == null) {
+            out.append(name).append(" 0\n");
+            return;
+        }
+        for (Map.Entry<String, LongAdder> entry : values.entrySet()) {
+            String label = NO_LABEL.equals(entry.getKey()) ? null : entry.getKey();
+            out.append(name).append(labels(label, null, null))
+               .append(' ').append(entry.getValue().sum()).append('\n');
+        }
+    }
+}
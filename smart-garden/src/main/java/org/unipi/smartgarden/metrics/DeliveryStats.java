@@ -0,0 +1,117 @@
+package org.unipi.smartgarden.metrics;
+
+import java.util.ArrayList;
+import java.util.List;
+import java.util.Map;
+import java.util.concurrent.ConcurrentSkipListMap;
+
+/**
+ * DeliveryStats - End-to-end delivery quality per device, from the "seq" and
+ * "ts" fields the firmware adds to every publish and CoAP representation. A
+ * CoAP resource is tracked on its own, from its observe notifications: its
+ * sequence number advances with each state change, so GETs are not counted.
+ *
+ * A sequence number ahead of the next expected one counts the skipped numbers
+ * as missing; one that shows up later inside the window is counted as
+ * reordered, and one further behind with an older device timestamp as late,
+ * so actual loss is missing - reordered - late. A number behind the highest
+ * one with a newer device timestamp means the device rebooted and restarts
+ * the tracking; so does a number far behind when the timestamps are not known.
+ */
+public final class DeliveryStats {
+
+    private static final int WINDOW = 64;
+
+    private static final Histogram LATENCY = Metrics.histogram("smartgarden_delivery_latency_seconds",
+            "Device timestamp to backend (stored for samples, received for CoAP)", "device");
+    private static final Counter RECEIVED = Metrics.counter(
+            "smartgarden_delivery_received_total", "Messages received with a sequence number", "device");
+    private static final Counter MISSING = Metrics.counter(
+            "smartgarden_delivery_missing_total", "Sequence numbers skipped when they were due", "device");
+    private static final Counter REORDERED = Metrics.counter(
+            "smartgarden_delivery_reordered_total", "Messages that arrived after a later sequence number", "device");
+    private static final Counter DUPLICATES = Metrics.counter(
+            "smartgarden_delivery_duplicates_total", "Sequence numbers received twice", "device");
+    private static final Counter LATE = Metrics.counter(
+            "smartgarden_delivery_late_total", "Messages that arrived more than the window behind", "device");
+    private static final Counter RESTARTS = Metrics.counter(
+            "smartgarden_delivery_restarts_total", "Sequence restarts (device reboots)", "device");
+
+    private static final Map<String, Window> windows = new ConcurrentSkipListMap<>();
+
+    private DeliveryStats() {
+    }
+
+    /**
+     * Records one message. deviceTimeMillis is 0 until the device clock is synced,
+     * and receivedAtMillis is the backend time the latency is measured at.
+     */
+    public static void record(String device, long seq, long deviceTimeMillis, long receivedAtMillis) {
+        RECEIVED.inc(device);
+        if (deviceTimeMillis > 0) {
+            LATENCY.observe(device, Math.max(0, receivedAtMillis - deviceTimeMillis) / 1000.0);
+        }
+        windows.computeIfAbsent(device, d -> new Window()).accept(device, seq, deviceTimeMillis);
+    }
+
+    /**
+     * One line per device: received, lost, reordered, late, duplicates, restarts.
+     */
+    public static List<String> summary() {
+        List<String> lines = new ArrayList<>();
+        for (String device : windows.keySet()) {
+            long missing = MISSING.get(device);
+            long reordered = REORDERED.get(device);
+            long late = LATE.get(device);
+            lines.add(device + ": received " + RECEIVED.get(device) + ", lost " + (missing - reordered - late)
+                    + ", reordered " + reordered + ", late " + late + ", duplicates " + DUPLICATES.get(device)
+                    + ", restarts " + RESTARTS.get(device));
+        }
+        return lines;
+    }
+
+    private static class Window {
+
+        private long last = -1;
+        private long lastTime;  // device time of last, 0 if not known
+        private long seen; // bit i set: last - i was received
+
+        synchronized void accept(String device, long seq, long deviceTime) {
+            boolean timed = deviceTime > 0 && lastTime > 0;
+            if (last < 0) {
+                restart(seq, deviceTime);
+                return;
+            }
+
+            if (seq > last) {
+                if (seq - last > 1) MISSING.add(device, seq - last - 1);
+                seen = (seq - last >= WINDOW) ? 1 : (seen << (seq - last)) | 1;
+                last = seq;
+                if (deviceTime > 0) lastTime = deviceTime;
+            } else if (timed && deviceTime > lastTime) {
+                // behind in sequence yet sent later: the numbering started over
+                RESTARTS.inc(device);
+                restart(seq, deviceTime);
+            } else if (last - seq < WINDOW) {
+                long bit = 1L << (last - seq);
+                if ((seen & bit) != 0) {
+                    DUPLICATES.inc(device);
+                } else {
+                    REORDERED.inc(device);
+                    seen |= bit;
+                }
+            } else if (timed) {
+                LATE.inc(device);
+            } else {
+                RESTARTS.inc(device);
+                restart(seq, deviceTime);
+            }
+        }
+
+        private void restart(long seq, long deviceTime) {
+            last = seq;
+            lastTime = deviceTime;
+            seen = 1;
+        }
+    }
+}
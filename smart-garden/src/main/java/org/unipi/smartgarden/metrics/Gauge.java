@@ -0,0 +1,28 @@
+package org.unipi.smartgarden.metrics;
+
+import java.util.function.DoubleSupplier;
+
+/**
+ * Gauge - Value read from its owner at scrape time.
+ */
+public class Gauge extends Metric {
+
+    private final DoubleSupplier supplier;
+    private final String type;
+
+    Gauge(String name, String help, DoubleSupplier supplier, String type) {
+        super(name, help, null);
+        this.supplier = supplier;
+        this.type = type;
+    }
+
+    @Override
+    protected String type() {
+        return type;
+    }
+
+    @Override
+    protected void writeSamples(StringBuilder out) {
+        out.append(name).append(' ').append(format(supplier.getAsDouble())).append('\n');
+    }
+}
@@ -0,0 +1,94 @@
+package org.unipi.smartgarden.metrics;
+
+import java.util.Map;
+import java.util.concurrent.ConcurrentHashMap;
+import java.util.concurrent.atomic.DoubleAdder;
+import java.util.concurrent.atomic.LongAdder;
+
+/**
+ * Histogram - Latency distribution in seconds over fixed buckets, optionally
+ * split by one label.
+ */
+public class Histogram extends Metric {
+
+    // 1 ms .. 10 s, fits DB inserts as well as CoAP round trips over 6LoWPAN
+    public static final double[] DEFAULT_BUCKETS =
+            {0.001, 0.0025, 0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1, 2.5, 5, 10};
+
+    private static final String NO_LABEL = "";
+
+    private final double[] buckets;
+    private final Map<String, Series> series = new ConcurrentHashMap<>();
+
+    private static class Series {
+        final LongAdder[] counts;
+        final DoubleAdder sum = new DoubleAdder();
+        final LongAdder count = new LongAdder();
+
+        Series(int buckets) {
+            counts = new LongAdder[buckets];
+            for (int i = 0; i < buckets; i++) {
+                counts[i] = new LongAdder();
+            }
+        }
+    }
+
+    Histogram(String name, String help, String labelName, double[] buckets) {
+        super(name, help, labelName);
+        this.buckets = buckets;
+    }
+
+    public void observe(double seconds) {
+        observe(NO_LABEL, seconds);
+    }
+
+    public void observe(String labelValue, double seconds) {
+        Series s = series.computeIfAbsent(labelValue, k -> new Series(buckets.length));
+        for (int i = 0; i < buckets.length; i++) {
+            if (seconds <= buckets[i]) {
+                s.counts[i].increment();
+                break;
+            }
+        }
+        s.sum.add(seconds);
+        s.count.increment();
+    }
+
+    /**
+     * Observes the time elapsed since startNanos (a System.nanoTime() value).
+     */
+    public void observeSince(String labelValue, long startNanos) {
+        observe(labelValue, (System.nanoTime() - startNanos) / 1e9);
+    }
+
+    public void observeSince(long startNanos) {
+        observeSince(NO_LABEL, startNanos);
+    }
+
+    @Override
+    protected String type() {
+        return "histogram";
+    }
+
+    @Override
+    protected void writeSamples(StringBuilder out) {
+        for (Map.Entry<String, Series> entry : series.entrySet()) {
+            String label = NO_LABEL.equals(entry.getKey()) ? null : entry.getKey();
+            Series s = entry.getValue();
+
+            long cumulative = 0;
+            for (int i = 0; i < buckets.length; i++) {
+                cumulative += s.counts[i].sum();
+                out.append(name).append("_bucket").append(labels(label, "le", format(buckets[i])))
+                   .append(' ').append(cumulative).append('\n');
+            }
+            long count = s.count.sum();
+            out.append(name).append("_bucket").append(labels(label, "le", "+Inf"))
+               .append(' ').append(count).append('\n');
+            out.append(name).append("_sum").append(labels(label, null, null))
+               .append(' ').append(s.sum.sum()).append('\n');
+            out.append(name).append("_count").append(labels(label, null, null))
+               .append(' ').append(count).append('\n');
+        }
+    }
+}
@@ -0,0 +1,55 @@
+package org.unipi.smartgarden.metrics;
+
+/**
+ * Metric - A metric family, rendered in the Prometheus text exposition format.
+ */
+public abstract class Metric {
+
+    protected final String name;
+    protected final String help;
+    protected final String labelName; // null for unlabelled metrics
+
+    protected Metric(String name, String help, String labelName) {
+        this.name = name;
+        this.help = help;
+        this.labelName = labelName;
+    }
+
+    public String getName() {
+        return name;
+    }
+
+    protected abstract String type();
+
+    protected abstract void writeSamples(StringBuilder out);
+
+    void write(StringBuilder out) {
+        out.append("# HELP ").append(name).append(' ').append(help).append('\n');
+        out.append("# TYPE ").append(name).append(' ').append(type()).append('\n');
+        writeSamples(out);
+    }
+
+    // {label="value"} or {label="value",le="0.5"}; empty when there is nothing to print
+    protected String labels(String labelValue, String extraName, String extraValue) {
+        StringBuilder sb = new StringBuilder();
+        if (labelName != null && labelValue != null) {
+            sb.append(labelName).append("=\"").append(escape(labelValue)).append('"');
+        }
+        if (extraName != null) {
+            if (sb.length() > 0) sb.append(',');
+            sb.append(extraName).append("=\"").append(extraValue).append('"');
+        }
+        return sb.length() == 0 ? "" : "{" + sb + "}";
+    }
+
+    protected static String format(double value) {
+        if (value == Math.rint(value) && !Double.isInfinite(value)) {
+            return Long.toString((long) value);
+        }
+        return Double.toString(value);
+    }
+
+    private static String escape(String value) {
+        return value.replace("\\", "\\\\").replace("\"", "\\\"").replace("\n", "\\n");
+    }
+}
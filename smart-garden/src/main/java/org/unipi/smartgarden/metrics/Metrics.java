@@ -0,0 +1,50 @@
+package org.unipi.smartgarden.metrics;
+
+import java.util.Map;
+import java.util.concurrent.ConcurrentSkipListMap;
+import java.util.function.DoubleSupplier;
+
+/**
+ * Metrics - Process-wide registry of the backend metrics. Registering the same
+ * name twice returns the metric already registered.
+ */
+public class Metrics {
+
+    private static final Map<String, Metric> registry = new ConcurrentSkipListMap<>();
+
+    private Metrics() {
+    }
+
+    public static Counter counter(String name, String help) {
+        return counter(name, help, null);
+    }
+
+    public static Counter counter(String name, String help, String labelName) {
+        return (Counter) registry.computeIfAbsent(name, n -> new Counter(n, help, labelName));
+    }
+
+    public static Histogram histogram(String name, String help, String labelName) {
+        return (Histogram) registry.computeIfAbsent(name,
+                n -> new Histogram(n, help, labelName, Histogram.DEFAULT_BUCKETS));
+    }
+
+    public static void gauge(String name, String help, DoubleSupplier supplier) {
+        registry.put(name, new Gauge(name, help, supplier, "gauge"));
+    }
+
+    // counter owned by another component (e.g. an AtomicLong it already keeps)
+    public static void counterFunction(String name, String help, DoubleSupplier supplier) {
+        registry.put(name, new Gauge(name, help, supplier, "counter"));
+    }
+
+    /**
+     * Renders every registered metric in the Prometheus text format.
+     */
+    public static String scrape() {
+        StringBuilder out = new StringBuilder(4096);
+        for (Metric metric : registry.values()) {
+            metric.write(out);
+        }
+        return out.toString();
+    }
+}
@@ -0,0 +1,61 @@
+package org.unipi.smartgarden.metrics;
+
+import com.sun.net.httpserver.HttpExchange;
+import com.sun.net.httpserver.HttpServer;
+import org.unipi.smartgarden.util.ConsoleUtils;
+
+import java.io.IOException;
+import java.io.OutputStream;
+import java.net.InetSocketAddress;
+import java.nio.charset.StandardCharsets;
+import java.util.concurrent.ExecutorService;
+import java.util.concurrent.Executors;
+
+/**
+ * MetricsServer - Serves GET /metrics for Prometheus, using the HTTP server
+ * bundled with the JDK.
+ */
+public class MetricsServer {
+
+    private static final String LOG = "[Metrics]";
+    private static final String CONTENT_TYPE = "text/plain; version=0.0.4; charset=utf-8";
+
+    private final HttpServer server;
+    private final ExecutorService executor = Executors.newSingleThreadExecutor(r -> {
+        Thread t = new Thread(r, "metrics-http");
+        t.setDaemon(true);
+        return t;
+    });
+
+    public MetricsServer(int port) throws IOException {
+        server = HttpServer.create(new InetSocketAddress(port), 0);
+        server.createContext("/metrics", this::handle);
+        server.setExecutor(executor);
+        server.start();
+        ConsoleUtils.println(LOG + " Metrics available at http://localhost:" + port + "/metrics");
+    }
+
+    private void handle(HttpExchange exchange) throws IOException {
+        try {
+            if (!"GET".equals(exchange.getRequestMethod())) {
+                exchange.sendResponseHeaders(405, -1);
+                return;
+            }
+
+            byte[] body = Metrics.scrape().getBytes(StandardCharsets.UTF_8);
+            exchange.getResponseHeaders().set("Content-Type", CONTENT_TYPE);
+            exchange.sendResponseHeaders(200, body.length);
+            try (OutputStream os = exchange.getResponseBody()) {
+                os.write(body);
+            }
+        } finally {
+            exchange.close();
+        }
+    }
+
+    public void close() {
+        server.stop(0);
+        executor.shutdown();
+        ConsoleUtils.println(LOG + " Metrics server stopped.");
+    }
+}
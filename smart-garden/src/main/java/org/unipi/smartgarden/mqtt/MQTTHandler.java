@@ -1,44 +1,212 @@
 package org.unipi.smartgarden.mqtt;
 
 import org.eclipse.paho.client.mqttv3.*;
-import org.unipi.smartgarden.db.DBDriver;
+import org.eclipse.paho.client.mqttv3.persist.MemoryPersistence;
+import org.unipi.smartgarden.db.SampleCompressor;
+import org.unipi.smartgarden.db.SampleStore;
+import org.unipi.smartgarden.metrics.Counter;
+import org.unipi.smartgarden.metrics.DeliveryStats;
+import org.unipi.smartgarden.metrics.Metrics;
 import org.unipi.smartgarden.util.ConsoleUtils;
 
+import java.util.ArrayList;
 import java.util.HashMap;
+import java.util.List;
 import java.util.Map;
+import java.util.concurrent.ConcurrentHashMap;
+import java.util.concurrent.CopyOnWriteArrayList;
+import java.util.concurrent.Executors;
+import java.util.concurrent.ScheduledExecutorService;
+import java.util.concurrent.ThreadLocalRandom;
+import java.util.concurrent.TimeUnit;
+import java.util.concurrent.atomic.AtomicBoolean;
+import java.util.concurrent.atomic.AtomicInteger;
 
 public class MQTTHandler implements MqttCallback {
 
     private static final String LOG = "[MQTT Handler]";
     private static final String BROKER_URI = "tcp://localhost:1883";
     private static final String CLIENT_ID = "SmartGardenApp";
-
-    private final DBDriver db;
+    // latest value of each sensor, shared between the instances of a cluster
+    private static final String CLUSTER_LATEST_TOPIC = "smartgarden/cluster/latest/";
+    // wall clock for the sensor nodes, which timestamp their samples with it
+    private static final String TIME_TOPIC = "smartgarden/time";
+    private static final long TIME_BEACON_INTERVAL_S = 60;
+
+    // reconnect backoff: 0.5 s doubling up to 30 s, +-20 % jitter
+    private static final long RECONNECT_MIN_MS = 500;
+    private static final long RECONNECT_MAX_MS = 30_000;
+    private static final int OUTBOUND_CAPACITY = 1000;
+
+    private final SampleStore db;
     private final Map<String, String> sensorTopics; // sensorName -> topic
     private final Map<String, Float> latestValues;  // sensorName -> last value
+    private final List<SampleListener> sampleListeners = new CopyOnWriteArrayList<>();
+    private final String instanceId;  // null when not clustered
+    private volatile SampleCompressor compressor;  // null: every sample is stored
+
+    private final List<String> subscriptions = new ArrayList<>();
+    private final OutboundBuffer outbound = new OutboundBuffer(OUTBOUND_CAPACITY, OutboundBuffer.DropPolicy.DROP_OLDEST);
+    private final AtomicInteger reconnectAttempts = new AtomicInteger();
+    // set while a thread publishes from the outbound buffer or past it, so the order holds
+    private final AtomicBoolean sending = new AtomicBoolean();
+    private volatile boolean closing;
 
     private MqttClient client;
+    private MqttConnectOptions connectOptions;
+    private ScheduledExecutorService scheduler;
+
+    private static final Counter MESSAGES = Metrics.counter(
+            "smartgarden_mqtt_messages_total", "MQTT messages received", "topic");
+    private static final Counter PARSE_ERRORS = Metrics.counter(
+            "smartgarden_mqtt_parse_errors_total", "MQTT messages that could not be parsed", "topic");
+    private static final Counter STORE_ERRORS = Metrics.counter(
+            "smartgarden_mqtt_store_errors_total", "Sensor samples that could not be stored", "sensor");
+    private static final Counter RECONNECTS = Metrics.counter(
+            "smartgarden_mqtt_reconnects_total", "Successful reconnections to the broker after a lost or failed connection");
+
+    public MQTTHandler(Map<String, String> configuredSensors, SampleStore db) {
+        this(configuredSensors, db, BROKER_URI);
+    }
+
+    /**
+     * With a null brokerUri the handler runs offline: samples can still be fed
+     * to messageArrived (benchmarks, replay) and publishing is a no-op.
+     */
+    public MQTTHandler(Map<String, String> configuredSensors, SampleStore db, String brokerUri) {
+        this(configuredSensors, db, brokerUri, null, null);
+    }
+
+    /**
+     * Clustered mode: the sensor topics are consumed through the $share/<shareGroup>/
+     * subscription, so the broker hands each sample to one instance only. Every
+     * ingested value is then republished on smartgarden/cluster/latest/<sensor>
+     * so all instances keep the latest readings and can run their control rules.
+     */
+    public MQTTHandler(Map<String, String> configuredSensors, SampleStore db, String brokerUri,
+                       String instanceId, String shareGroup) {
+        this(configuredSensors, db, brokerUri, instanceId, shareGroup,
+                instanceId == null ? CLIENT_ID : CLIENT_ID + "-" + instanceId, false);
+    }
+
+    /**
+     * A handler with its own client id and a clean session, so it neither takes
+     * over the session of a running backend nor receives the messages queued
+     * for it (load tests).
+     */
+    public static MQTTHandler withCleanSession(Map<String, String> configuredSensors, SampleStore db,
+                                               String brokerUri, String clientId) {
+        return new MQTTHandler(configuredSensors, db, brokerUri, null, null, clientId, true);
+    }
 
-    public MQTTHandler(Map<String, String> configuredSensors, DBDriver db) {
+    private MQTTHandler(Map<String, String> configuredSensors, SampleStore db, String brokerUri,
+                        String instanceId, String shareGroup, String clientId, boolean cleanSession) {
         this.db = db;
         this.sensorTopics = configuredSensors;
-        this.latestValues = new HashMap<>();
+        this.latestValues = new ConcurrentHashMap<>();
+        this.instanceId = instanceId;
+
+        if (brokerUri == null) {
+            ConsoleUtils.println(LOG + " Running without a broker connection.");
+            return;
+        }
+
+        for (String topic : sensorTopics.values()) {
+            subscriptions.add(shareGroup == null ? topic : "$share/" + shareGroup + "/" + topic);
+        }
+        if (instanceId != null) {
+            subscriptions.add(CLUSTER_LATEST_TOPIC + "+");
+        }
+        Metrics.gauge("smartgarden_mqtt_connected", "1 while the broker connection is up",
+                () -> client != null && client.isConnected() ? 1 : 0);
+
+        // the client id is stable and the session persistent (unless cleanSession): the
+        // broker keeps the subscriptions and the QoS 1 messages while the backend is away
+        connectOptions = new MqttConnectOptions();
+        connectOptions.setCleanSession(cleanSession);
+        connectOptions.setKeepAliveInterval(15);
+        connectOptions.setConnectionTimeout(5);
+        connectOptions.setMaxInflight(64);
+
+        scheduler = Executors.newSingleThreadScheduledExecutor(r -> {
+            Thread t = new Thread(r, "mqtt-handler");
+            t.setDaemon(true);
+            return t;
+        });
 
         try {
-            client = new MqttClient(BROKER_URI, CLIENT_ID);
+            client = cleanSession
+                    ? new MqttClient(brokerUri, clientId, new MemoryPersistence())
+                    : new MqttClient(brokerUri, clientId);
             client.setCallback(this);
-            client.connect();
+        } catch (MqttException e) {
+            ConsoleUtils.printError(LOG + " Invalid broker " + brokerUri + ": " + e.getMessage());
+            client = null;
+            return;
+        }
+        if (!connect()) scheduleReconnect();
+        scheduler.scheduleAtFixedRate(this::publishTime, TIME_BEACON_INTERVAL_S, TIME_BEACON_INTERVAL_S, TimeUnit.SECONDS);
+    }
 
-            for (Map.Entry<String, String> entry : sensorTopics.entrySet()) {
-                client.subscribe(entry.getValue());
-                ConsoleUtils.println(LOG + " Subscribed to topic: " + entry.getValue());
-                latestValues.put(entry.getKey(), null);
+    // connects, subscribes again and sends what was published meanwhile
+    private synchronized boolean connect() {
+        if (closing) return false;
+        try {
+            if (!client.isConnected()) client.connect(connectOptions);
+            for (String filter : subscriptions) {
+                client.subscribe(filter, 1);
+                ConsoleUtils.println(LOG + " Subscribed to topic: " + filter);
             }
-
         } catch (MqttException e) {
             ConsoleUtils.printError(LOG + " Failed to connect or subscribe: " + e.getMessage());
-            e.printStackTrace();
+            return false;
         }
+        reconnectAttempts.set(0);
+        publishTime();
+        flushOutbound();
+        return true;
+    }
+
+    private void scheduleReconnect() {
+        if (closing) return;
+        int attempt = reconnectAttempts.getAndIncrement();
+        long delay = Math.min(RECONNECT_MAX_MS, RECONNECT_MIN_MS << Math.min(attempt, 6));
+        delay = (long) (delay * ThreadLocalRandom.current().nextDouble(0.8, 1.2));
+        ConsoleUtils.println(LOG + " Reconnecting in " + delay + " ms");
+        scheduler.schedule(() -> {
+            if (connect()) {
+                RECONNECTS.inc();
+            } else {
+                scheduleReconnect();
+            }
+        }, delay, TimeUnit.MILLISECONDS);
+    }
+
+    // one thread at a time; a message queued while another one sends is picked up
+    // by that thread's check of the buffer after it lets go
+    private void flushOutbound() {
+        while (isConnected() && outbound.size() > 0 && sending.compareAndSet(false, true)) {
+            OutboundBuffer.Message message;
+            int sent = 0;
+            try {
+                while ((message = outbound.poll()) != null) {
+                    try {
+                        client.publish(message.topic, message.payload, message.qos, message.retained);
+                        sent++;
+                    } catch (MqttException e) {
+                        outbound.requeue(message);  // lost again: the next connect goes on from here
+                        return;
+                    }
+                }
+            } finally {
+                sending.set(false);
+                if (sent > 0) ConsoleUtils.println(LOG + " Sent " + sent + " buffered messages");
+            }
+        }
+    }
+
+    public boolean isConnected() {
+        return client != null && client.isConnected();
     }
 
     public void printSensorStatus() {
@@ -56,14 +224,46 @@ public class MQTTHandler implements MqttCallback {
         return latestValues.get(sensorName);
     }
 
+    public Map<String, Float> getLatestValues() {
+        return new HashMap<>(latestValues);
+    }
+
+    /**
+     * Seeds the latest value of a sensor from a snapshot, without storing it
+     * again or notifying the listeners.
+     */
+    public void restoreLatestValue(String sensorName, float value) {
+        if (sensorTopics.containsKey(sensorName)) {
+            latestValues.putIfAbsent(sensorName, value);
+        }
+    }
+
+    /**
+     * Routes the sensor samples to the database through the compressor.
+     */
+    public void setCompressor(SampleCompressor compressor) {
+        this.compressor = compressor;
+    }
+
+    public void addSampleListener(SampleListener listener) {
+        sampleListeners.add(listener);
+    }
+
     @Override
     public void connectionLost(Throwable cause) {
         ConsoleUtils.printError(LOG + " Connection lost: " + cause.getMessage());
+        scheduleReconnect();
     }
 
 	@Override
 	public void messageArrived(String topic, MqttMessage message) {
 	    String payload = new String(message.getPayload()).trim();
+	    MESSAGES.inc(topic);
+
+	    if (topic.startsWith(CLUSTER_LATEST_TOPIC)) {
+	        onClusterSample(topic.substring(CLUSTER_LATEST_TOPIC.length()), payload);
+	        return;
+	    }
 
 	    try {
 		String sensorName = getSensorNameFromTopic(topic);
@@ -77,8 +277,38 @@ public class MQTTHandler implements MqttCallback {
 		        float value = (float) doubleVal;
 
 		        latestValues.put(sensorName, value);
-		        db.insertSample(sensorName, value, null);
-		        ConsoleUtils.println(LOG + " Inserted " + value + " for sensor: " + sensorName);
+		        // notify before the DB insert so the control logic reacts without waiting on MySQL
+		        for (SampleListener listener : sampleListeners) {
+		            listener.onSample(sensorName, value);
+		        }
+		        Object device = jsonMap.get("dev");
+		        SampleCompressor c = compressor;
+		        boolean stored = c != null
+		                ? c.offer(sensorName, value, System.currentTimeMillis())
+		                : db.insertSample(sensorName, value, null);
+		        shareWithCluster(sensorName, value);
+		        if (device != null) {
+		            for (SampleListener listener : sampleListeners) {
+		                listener.onDeviceSample(device.toString(), sensorName, value);
+		            }
+		        }
+		        if (!stored) {
+		            STORE_ERRORS.inc(sensorName);
+		            ConsoleUtils.printError(LOG + " Could not store " + value + " for sensor: " + sensorName);
+		            return;
+		        }
+		        ConsoleUtils.debug(LOG + " Inserted " + value + " for sensor: " + sensorName);
+
+		        Object ts = jsonMap.get("ts");
+		        long sentAt = ts instanceof Number ? ((Number) ts).longValue() : 0L;
+		        Object seq = jsonMap.get("seq");
+		        if (seq instanceof Number) {
+		            DeliveryStats.record(device != null ? device.toString() : topic,
+		                    ((Number) seq).longValue(), sentAt, System.currentTimeMillis());
+		        }
+		        for (SampleListener listener : sampleListeners) {
+		            listener.onSamplePersisted(sensorName, value, sentAt);
+		        }
 		    } else {
 		        ConsoleUtils.printError(LOG + " JSON does not contain expected key: " + sensorName);
 		    }
@@ -87,11 +317,46 @@ public class MQTTHandler implements MqttCallback {
 		}
 
 	    } catch (Exception e) {
+		PARSE_ERRORS.inc(topic);
 		ConsoleUtils.printError(LOG + " Failed to parse JSON payload: " + payload);
 		e.printStackTrace();
 	    }
 	}
 
+    private void shareWithCluster(String sensorName, float value) {
+        if (instanceId == null) return;
+        String json = "{\"value\":" + value + ",\"from\":\"" + instanceId + "\"}";
+        publish(CLUSTER_LATEST_TOPIC + sensorName, json, 1, false, true);
+    }
+
+    // a sample ingested by another instance: already in the DB, only update the view
+    private void onClusterSample(String sensorName, String payload) {
+        try {
+            JsonSample sample = new com.google.gson.Gson().fromJson(payload, JsonSample.class);
+            if (sample == null || instanceId.equals(sample.from) || !sensorTopics.containsKey(sensorName)) return;
+
+            acceptSample(sensorName, sample.value);
+        } catch (Exception e) {
+            ConsoleUtils.printError(LOG + " Invalid cluster sample for " + sensorName + ": " + payload);
+        }
+    }
+
+    /**
+     * Takes a sample that is already stored elsewhere (another cluster instance,
+     * replay): updates the latest value and notifies the listeners, no DB insert.
+     */
+    public void acceptSample(String sensorName, float value) {
+        latestValues.put(sensorName, value);
+        for (SampleListener listener : sampleListeners) {
+            listener.onSample(sensorName, value);
+        }
+    }
+
+    private static class JsonSample {
+        float value;
+        String from;
+    }
+
     private String getSensorNameFromTopic(String topic) {
         for (Map.Entry<String, String> entry : sensorTopics.entrySet()) {
             if (entry.getValue().equals(topic)) {
@@ -107,9 +372,15 @@ public class MQTTHandler implements MqttCallback {
     }
 
     public void close() {
+        if (client == null) return;
+        closing = true;
+        scheduler.shutdownNow();
+        if (outbound.size() > 0) {
+            ConsoleUtils.printError(LOG + " " + outbound.size() + " buffered messages not sent");
+        }
         try {
             ConsoleUtils.println(LOG + " Disconnecting...");
-            client.disconnect();
+            if (client.isConnected()) client.disconnect();
             client.close();
         } catch (MqttException e) {
             ConsoleUtils.printError(LOG + " Error during MQTT client shutdown: " + e.getMessage());
@@ -118,15 +389,59 @@ public class MQTTHandler implements MqttCallback {
 
     // ---------------------- PUBLISHING METHODS FOR ACTUATOR CONTROL ----------------------
 
-    public void sendCommand(String topic, String command) {
+    /**
+     * Publishes now if connected and nothing older is waiting, otherwise queues
+     * the message in the outbound buffer behind the others, so messages reach
+     * the broker in the order they were published.
+     */
+    private void publish(String topic, String payload, int qos, boolean retained, boolean coalesce) {
+        if (client == null) return;
+        byte[] bytes = payload.getBytes();
+        if (client.isConnected() && sending.compareAndSet(false, true)) {
+            boolean sent = false;
+            try {
+                if (outbound.size() == 0) {
+                    client.publish(topic, bytes, qos, retained);
+                    sent = true;
+                }
+            } catch (MqttException e) {
+                ConsoleUtils.debug(LOG + " Publish to " + topic + " failed, buffering: " + e.getMessage());
+            } finally {
+                sending.set(false);
+            }
+            if (sent) {
+                flushOutbound();  // queued by others meanwhile
+                return;
+            }
+        }
+        outbound.offer(new OutboundBuffer.Message(topic, bytes, qos, retained), coalesce);
+        flushOutbound();
+    }
+
+    // not buffered: a stale time is worse than none, and connect() sends a fresh one
+    private void publishTime() {
+        if (!isConnected()) return;
         try {
-            client.publish(topic, new MqttMessage(command.getBytes()));
-            ConsoleUtils.println(LOG + " Published command to " + topic + ": " + command);
+            client.publish(TIME_TOPIC, new MqttMessage(Long.toString(System.currentTimeMillis()).getBytes()));
         } catch (MqttException e) {
-            ConsoleUtils.printError(LOG + " Failed to publish command to " + topic + ": " + e.getMessage());
+            ConsoleUtils.printError(LOG + " Failed to publish time: " + e.getMessage());
         }
     }
 
+    public void sendCommand(String topic, String command) {
+        publish(topic, command, 1, false, true);
+        ConsoleUtils.debug(LOG + " Published command to " + topic + ": " + command);
+    }
+
+    /**
+     * Publishes a retained message, for per-node settings the node must get back
+     * when it (re)subscribes.
+     */
+    public void publishRetained(String topic, String payload) {
+        publish(topic, payload, 0, true, true);
+        ConsoleUtils.debug(LOG + " Published retained " + topic + ": " + payload);
+    }
+
     public void simulateFan(String state) {
         sendCommand("fan", state);  // "on" or "off"
     }
@@ -150,13 +465,9 @@ public class MQTTHandler implements MqttCallback {
     // ---------------------- SENSOR SIMULATION METHOD ----------------------
 
     public void simulateSensor(String sensorTopic, float value) {
-        try {
-            String json = "{\"" + sensorTopic + "\":" + value + "}";
-            client.publish(sensorTopic, new MqttMessage(json.getBytes()));
-            ConsoleUtils.println(LOG + " Simulated sensor value for " + sensorTopic + ": " + json);
-        } catch (MqttException e) {
-            ConsoleUtils.printError(LOG + " Failed to simulate sensor data for " + sensorTopic + ": " + e.getMessage());
-        }
+        String json = "{\"" + sensorTopic + "\":" + value + "}";
+        publish(sensorTopic, json, 1, false, false);
+        ConsoleUtils.debug(LOG + " Simulated sensor value for " + sensorTopic + ": " + json);
     }
 }
 
@@ -0,0 +1,93 @@
+package org.unipi.smartgarden.mqtt;
+
+import org.unipi.smartgarden.metrics.Counter;
+import org.unipi.smartgarden.metrics.Metrics;
+
+import java.util.ArrayDeque;
+import java.util.Deque;
+import java.util.Iterator;
+
+/**
+ * OutboundBuffer - Bounded queue of the messages published while the broker
+ * connection is down, sent in order once it is back. When it is full,
+ * DROP_OLDEST makes room by dropping the head and DROP_NEWEST refuses the new
+ * message. A message offered with coalesce replaces the queued one of the same
+ * topic: only the last actuator command or setting of a topic matters.
+ */
+public class OutboundBuffer {
+
+    public enum DropPolicy { DROP_OLDEST, DROP_NEWEST }
+
+    private static final Counter BUFFERED = Metrics.counter(
+            "smartgarden_mqtt_outbound_buffered_total", "Messages queued while the broker was unreachable");
+    private static final Counter DROPPED = Metrics.counter(
+            "smartgarden_mqtt_outbound_dropped_total", "Queued messages dropped because the buffer was full", "policy");
+    private static final Counter COALESCED = Metrics.counter(
+            "smartgarden_mqtt_outbound_coalesced_total", "Queued messages replaced by a newer one for the same topic");
+
+    private final int capacity;
+    private final DropPolicy policy;
+    private final Deque<Message> queue = new ArrayDeque<>();  // guarded by this
+
+    public OutboundBuffer(int capacity, DropPolicy policy) {
+        this.capacity = capacity;
+        this.policy = policy;
+        Metrics.gauge("smartgarden_mqtt_outbound_buffer_depth", "Messages waiting for the broker", this::size);
+    }
+
+    /**
+     * Queues a message; false if it was dropped.
+     */
+    public synchronized boolean offer(Message message, boolean coalesce) {
+        if (coalesce) {
+            for (Iterator<Message> it = queue.iterator(); it.hasNext(); ) {
+                if (it.next().topic.equals(message.topic)) {
+                    it.remove();
+                    COALESCED.inc();
+                    break;
+                }
+            }
+        }
+        if (queue.size() >= capacity) {
+            if (policy == DropPolicy.DROP_NEWEST) {
+                DROPPED.inc("newest");
+                return false;
+            }
+            queue.pollFirst();
+            DROPPED.inc("oldest");
+        }
+        queue.addLast(message);
+        BUFFERED.inc();
+        return true;
+    }
+
+    public synchronized Message poll() {
+        return queue.pollFirst();
+    }
+
+    /**
+     * Puts back a message whose publish failed, ahead of the others.
+     */
+    public synchronized void requeue(Message message) {
+        queue.addFirst(message);
+    }
+
+    public synchronized int size() {
+        return queue.size();
+    }
+
+    public static final class Message {
+
+        final String topic;
+        final byte[] payload;
+        final int qos;
+        final boolean retained;
+
+        public Message(String topic, byte[] payload, int qos, boolean retained) {
+            this.topic = topic;
+            this.payload = payload;
+            this.qos = qos;
+            this.retained = retained;
+        }
+    }
+}
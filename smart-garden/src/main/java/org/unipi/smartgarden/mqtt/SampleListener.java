@@ -0,0 +1,27 @@
+package org.unipi.smartgarden.mqtt;
+
+/**
+ * SampleListener - Notified by the MQTTHandler every time a sensor sample
+ * is accepted. Implementations are called on the MQTT callback thread and
+ * must return quickly (no network or DB I/O).
+ */
+public interface SampleListener {
+
+    void onSample(String sensorName, float value);
+
+    /**
+     * Called only when the store accepted the sample: written to the DB, or
+     * left out by the compression because the stored series rebuilds it. Not
+     * called when the write failed. sentAtMillis is the "ts" field of the
+     * payload (publisher clock), or 0 when absent.
+     */
+    default void onSamplePersisted(String sensorName, float value, long sentAtMillis) {
+    }
+
+    /**
+     * Called for every sample whose payload names the publishing node (the
+     * "dev" field), whether or not it could be stored.
+     */
+    default void onDeviceSample(String device, String sensorName, float value) {
+    }
+}
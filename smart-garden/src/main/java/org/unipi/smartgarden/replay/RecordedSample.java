@@ -0,0 +1,162 @@
+package org.unipi.smartgarden.replay;
+
+import org.unipi.smartgarden.db.SampleStore;
+import org.unipi.smartgarden.util.ConsoleUtils;
+
+import java.io.BufferedReader;
+import java.io.IOException;
+import java.nio.charset.StandardCharsets;
+import java.nio.file.Files;
+import java.nio.file.Path;
+import java.sql.Connection;
+import java.sql.DriverManager;
+import java.sql.PreparedStatement;
+import java.sql.ResultSet;
+import java.sql.SQLException;
+import java.sql.Timestamp;
+import java.time.LocalDateTime;
+import java.time.ZoneId;
+import java.time.format.DateTimeFormatter;
+import java.util.ArrayList;
+import java.util.Collections;
+import java.util.Comparator;
+import java.util.List;
+import java.util.regex.Matcher;
+import java.util.regex.Pattern;
+
+/**
+ * RecordedSample - One historical sensor reading, loaded from the sensor tables
+ * or from the "Inserted" lines of smartgarden.log.
+ */
+public class RecordedSample {
+
+    private static final String LOG = "[Replay]";
+
+    private static final String[][] SENSOR_TABLES = {
+            {"temperature", "temperature"}, {"pH", "pH"}, {"soilMoisture", "soil_moisture"}, {"light", "light"}};
+
+    // "[ts] [LEVEL] msg" of AsyncLogger, or "[ts] msg" of the logs written before it
+    private static final Pattern LOG_LINE = Pattern.compile(
+            "^\\[(\\d{4}-\\d{2}-\\d{2} \\d{2}:\\d{2}:\\d{2})] (?:\\[\\w+] )?\\[MQTT Handler] Inserted (\\S+) for sensor: (\\S+)$");
+    private static final DateTimeFormatter LOG_TIMESTAMP = DateTimeFormatter.ofPattern("yyyy-MM-dd HH:mm:ss");
+
+    private final String sensor;
+    private final long time;
+    private final float value;
+
+    public RecordedSample(String sensor, long time, float value) {
+        this.sensor = sensor;
+        this.time = time;
+        this.value = value;
+    }
+
+    public String getSensor() {
+        return sensor;
+    }
+
+    public long getTime() {
+        return time;
+    }
+
+    public float getValue() {
+        return value;
+    }
+
+    /**
+     * Samples of the four sensor tables between from and to (either may be
+     * null), in time order.
+     */
+    public static List<RecordedSample> fromDatabase(String url, String user, String password,
+                                                    Timestamp from, Timestamp to) throws SQLException {
+        String where = (from != null ? " AND timestamp >= ?" : "") + (to != null ? " AND timestamp <= ?" : "");
+        StringBuilder sql = new StringBuilder();
+        for (String[] sensorTable : SENSOR_TABLES) {
+            if (sql.length() > 0) sql.append(" UNION ALL ");
+            sql.append("SELECT '").append(sensorTable[0]).append("' AS sensor, value, timestamp FROM ")
+                    .append(sensorTable[1]).append(" WHERE value IS NOT NULL").append(where);
+        }
+        sql.append(" ORDER BY timestamp");
+
+        List<RecordedSample> samples = new ArrayList<>();
+        try (Connection connection = DriverManager.getConnection(url, user, password);
+             PreparedStatement stmt = connection.prepareStatement(sql.toString())) {
+            int index = 1;
+            for (int i = 0; i < SENSOR_TABLES.length; i++) {
+                if (from != null) stmt.setTimestamp(index++, from);
+                if (to != null) stmt.setTimestamp(index++, to);
+            }
+            try (ResultSet rs = stmt.executeQuery()) {
+                while (rs.next()) {
+                    samples.add(new RecordedSample(rs.getString(1), rs.getTimestamp(3).getTime(), rs.getFloat(2)));
+                }
+            }
+        }
+        return samples;
+    }
+
+    /**
+     * Samples of the four sensors in a SampleStore between from and to (either
+     * may be null), in time order.
+     */
+    public static List<RecordedSample> fromStore(SampleStore store, Timestamp from, Timestamp to) {
+        long start = from != null ? from.getTime() : Long.MIN_VALUE;
+        long end = to != null ? to.getTime() + 1 : Long.MAX_VALUE;
+
+        List<RecordedSample> samples = new ArrayList<>();
+        for (String[] sensorTable : SENSOR_TABLES) {
+            String sensor = sensorTable[0];
+            store.scan(sensor, start, end, (time, value) -> samples.add(new RecordedSample(sensor, time, value)));
+        }
+        samples.sort(Comparator.comparingLong(RecordedSample::getTime));
+        return samples;
+    }
+
+    /**
+     * Samples logged by the MQTT handler, in time order, from logFile and its
+     * rotated files (logFile.1, logFile.2, ...). Log timestamps have a one
+     * second resolution; samples of the same second keep the file order.
+     */
+    public static List<RecordedSample> fromLog(Path logFile) throws IOException {
+        List<RecordedSample> samples = new ArrayList<>();
+        ZoneId zone = ZoneId.systemDefault();
+
+        for (Path file : withRotated(logFile)) {
+            int lines = 0;
+            int matched = 0;
+            try (BufferedReader reader = Files.newBufferedReader(file, StandardCharsets.UTF_8)) {
+                String line;
+                while ((line = reader.readLine()) != null) {
+                    lines++;
+                    Matcher m = LOG_LINE.matcher(line);
+                    if (!m.matches()) continue;
+                    try {
+                        long time = LocalDateTime.parse(m.group(1), LOG_TIMESTAMP).atZone(zone).toInstant().toEpochMilli();
+                        samples.add(new RecordedSample(m.group(3), time, Float.parseFloat(m.group(2))));
+                        matched++;
+                    } catch (RuntimeException e) {
+                        // truncated or garbled line: skip it
+                    }
+                }
+            }
+            if (lines > 0 && matched == 0) {
+                ConsoleUtils.printError(LOG + " No sample lines among the " + lines + " lines of " + file
+                        + ", is it a smartgarden.log?");
+            }
+        }
+        samples.sort(Comparator.comparingLong(RecordedSample::getTime)); // stable
+        return samples;
+    }
+
+    // the rotated files first, oldest to newest, then logFile
+    private static List<Path> withRotated(Path logFile) {
+        List<Path> files = new ArrayList<>();
+        files.add(logFile);
+        for (int i = 1; ; i++) {
+            Path rotated = logFile.resolveSibling(logFile.getFileName() + "." + i);
+            if (!Files.isRegularFile(rotated)) break;
+            files.add(rotated);
+        }
+        Collections.reverse(files);
+        return files;
+    }
+}
@@ -0,0 +1,83 @@
+package org.unipi.smartgarden.replay;
+
+import org.unipi.smartgarden.control.ActuatorCommandBus;
+import org.unipi.smartgarden.control.ActuatorGateway;
+
+import java.time.Clock;
+import java.util.ArrayList;
+import java.util.List;
+import java.util.Map;
+import java.util.TreeMap;
+import java.util.concurrent.CompletableFuture;
+
+/**
+ * ReplayActuators - In-memory actuators for the replay engine. Commands apply
+ * instantly at the virtual clock time and are recorded, with the same
+ * redundancy filtering and heater/fan exclusion as the ActuatorCommandBus.
+ */
+public class ReplayActuators implements ActuatorGateway {
+
+    private final Clock clock;
+    private final Map<String, String> states = new TreeMap<>();
+    private final Map<String, Integer> switches = new TreeMap<>();
+    private final List<String> commandLog = new ArrayList<>(); // "time,actuator,state"
+
+    public ReplayActuators(Clock clock, List<String> actuators) {
+        this.clock = clock;
+        for (String actuator : actuators) {
+            states.put(actuator, "off");
+            switches.put(actuator, 0);
+        }
+    }
+
+    @Override
+    public CompletableFuture<Outcome> submit(String actuator, String command) {
+        String desired = ActuatorCommandBus.normalize(actuator, command);
+        if (desired == null || !states.containsKey(actuator)) {
+            return CompletableFuture.completedFuture(Outcome.FAILED);
+        }
+        if (desired.equals(states.get(actuator))) {
+            return CompletableFuture.completedFuture(Outcome.UNCHANGED);
+        }
+
+        states.put(actuator, desired);
+        switches.merge(actuator, 1, Integer::sum);
+        commandLog.add(clock.instant() + "," + actuator + "," + desired);
+
+        if ("heater".equals(actuator) && "on".equals(desired)) {
+            submit("fan", "off");
+        } else if ("fan".equals(actuator) && "on".equals(desired)) {
+            submit("heater", "off");
+        }
+        return CompletableFuture.completedFuture(Outcome.SWITCHED);
+    }
+
+    @Override
+    public CompletableFuture<String> currentState(String actuator) {
+        return CompletableFuture.completedFuture(states.get(actuator));
+    }
+
+    @Override
+    public CompletableFuture<Void> refreshStates(List<String> toRefresh) {
+        // nothing changes behind the replay's back
+        return CompletableFuture.completedFuture(null);
+    }
+
+    @Override
+    public boolean owns(String actuator) {
+        return true;
+    }
+
+    @Override
+    public void logModeEvent(String actuator, String mode) {
+        // modes are not replayed
+    }
+
+    public Map<String, Integer> getSwitchCounts() {
+        return switches;
+    }
+
+    public List<String> getCommandLog() {
+        return commandLog;
+    }
+}
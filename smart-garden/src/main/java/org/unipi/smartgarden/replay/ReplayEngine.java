@@ -0,0 +1,173 @@
+package org.unipi.smartgarden.replay;
+
+import com.google.gson.Gson;
+import org.unipi.smartgarden.configuration.Configuration;
+import org.unipi.smartgarden.control.ActuatorPolicy;
+import org.unipi.smartgarden.control.ControlLogicThread;
+import org.unipi.smartgarden.control.ControlRules;
+import org.unipi.smartgarden.db.SegmentStore;
+import org.unipi.smartgarden.mqtt.MQTTHandler;
+import org.unipi.smartgarden.util.AsyncLogger;
+import org.unipi.smartgarden.util.ConsoleUtils;
+
+import java.io.IOException;
+import java.io.Reader;
+import java.nio.charset.StandardCharsets;
+import java.nio.file.Files;
+import java.nio.file.Path;
+import java.sql.Timestamp;
+import java.util.ArrayList;
+import java.util.HashMap;
+import java.util.List;
+import java.util.Map;
+
+/**
+ * ReplayEngine - Streams recorded sensor samples through the control rules on
+ * a virtual clock, with in-memory actuators, as fast as the CPU allows. Used to
+ * evaluate threshold changes in ControlRules against real history before
+ * deploying them.
+ *
+ * java -cp smartgarden-app-...-jar-with-dependencies.jar org.unipi.smartgarden.replay.ReplayEngine
+ *      --log smartgarden.log | --db-url jdbc:mysql://... | --data-dir smartgarden-data
+ *      [--from "2025-06-01 00:00:00"] [--to ...]
+ *      [--config devices.json] [--out replay-commands.csv]
+ */
+public class ReplayEngine {
+
+    private static final String LOG = "[Replay]";
+    private static final List<String> ACTUATORS = List.of("fertilizer", "irrigation", "grow_light", "fan", "heater");
+    private static final List<String> SENSORS = List.of("temperature", "pH", "soilMoisture", "light");
+    // longer gaps between two samples of a sensor are outages, not time out of range
+    private static final long MAX_GAP_MS = 10 * 60_000;
+
+    public static void main(String[] args) throws Exception {
+        String logFile = null;
+        String dbUrl = null;
+        String dataDir = null;
+        String dbUser = "root";
+        String dbPassword = "";
+        Timestamp from = null;
+        Timestamp to = null;
+        String out = "replay-commands.csv";
+        String config = null;
+
+        for (int i = 0; i + 1 < args.length; i += 2) {
+            String value = args[i + 1];
+            switch (args[i]) {
+                case "--log" -> logFile = value;
+                case "--db-url" -> dbUrl = value;
+                case "--data-dir" -> dataDir = value;
+                case "--db-user" -> dbUser = value;
+                case "--db-pass" -> dbPassword = value;
+                case "--from" -> from = Timestamp.valueOf(value);
+                case "--to" -> to = Timestamp.valueOf(value);
+                case "--out" -> out = value;
+                case "--config" -> config = value;
+                default -> throw new IllegalArgumentException("Unknown option: " + args[i]);
+            }
+        }
+
+        ConsoleUtils.setConsoleLevel(AsyncLogger.Level.INFO);
+        List<RecordedSample> samples;
+        if (logFile != null) {
+            samples = RecordedSample.fromLog(Path.of(logFile));
+        } else if (dbUrl != null) {
+            samples = RecordedSample.fromDatabase(dbUrl, dbUser, dbPassword, from, to);
+        } else if (dataDir != null) {
+            try (SegmentStore store = new SegmentStore(Path.of(dataDir))) {
+                samples = RecordedSample.fromStore(store, from, to);
+            }
+        } else {
+            ConsoleUtils.printError(LOG + " Give --log <file>, --db-url <jdbc url> or --data-dir <dir>");
+            ConsoleUtils.closeLogger();
+            return;
+        }
+        ConsoleUtils.println(LOG + " Loaded " + samples.size() + " samples");
+
+        ActuatorPolicy policy = ActuatorPolicy.none();
+        if (config != null) {
+            try (Reader reader = Files.newBufferedReader(Path.of(config), StandardCharsets.UTF_8)) {
+                policy = new ActuatorPolicy(new Gson().fromJson(reader, Configuration.class).getPolicies());
+            }
+        }
+
+        new ReplayEngine().replay(samples, policy, Path.of(out));
+        ConsoleUtils.closeLogger();
+    }
+
+    public void replay(List<RecordedSample> samples, ActuatorPolicy policy, Path commandsOut) throws IOException {
+        if (samples.isEmpty()) return;
+
+        VirtualClock clock = new VirtualClock(samples.get(0).getTime());
+        ReplayActuators actuators = new ReplayActuators(clock, ACTUATORS);
+        Map<String, String> topics = new HashMap<>();
+        for (String sensor : SENSORS) {
+            topics.put(sensor, sensor);
+        }
+        MQTTHandler mqttHandler = new MQTTHandler(topics, null, null);
+        ControlLogicThread control = new ControlLogicThread(mqttHandler, actuators, policy, clock);
+        mqttHandler.addSampleListener(control);
+
+        Map<String, Long> outOfRange = new HashMap<>();
+        Map<String, RecordedSample> previous = new HashMap<>();
+
+        long wallStart = System.nanoTime();
+        for (RecordedSample sample : samples) {
+            // debounced evaluations and sweeps that fall before this sample
+            long due;
+            while ((due = control.nextDueTime()) < sample.getTime()) {
+                clock.set(Math.max(due, clock.millis()));
+                control.runDuePasses();
+            }
+
+            clock.set(sample.getTime());
+            if (!SENSORS.contains(sample.getSensor())) continue;
+
+            RecordedSample last = previous.put(sample.getSensor(), sample);
+            if (last != null && !inRange(last.getSensor(), last.getValue())) {
+                long gap = sample.getTime() - last.getTime();
+                if (gap <= MAX_GAP_MS) outOfRange.merge(sample.getSensor(), gap, Long::sum);
+            }
+
+            mqttHandler.acceptSample(sample.getSensor(), sample.getValue());
+            control.runDuePasses();
+        }
+        double wallSeconds = (System.nanoTime() - wallStart) / 1e9;
+
+        long span = samples.get(samples.size() - 1).getTime() - samples.get(0).getTime();
+        ConsoleUtils.println(LOG + " Replayed " + formatDuration(span) + " of history in "
+                + String.format("%.2f", wallSeconds) + " s ("
+                + String.format("%.0f", span / 1000.0 / Math.max(wallSeconds, 1e-6)) + "x real time)");
+        ConsoleUtils.println(LOG + " Commands issued: " + actuators.getCommandLog().size());
+        for (Map.Entry<String, Integer> entry : actuators.getSwitchCounts().entrySet()) {
+            ConsoleUtils.println(LOG + "   " + entry.getKey() + ": " + entry.getValue() + " switches");
+        }
+        ConsoleUtils.println(LOG + " Time out of range:");
+        for (String sensor : SENSORS) {
+            long millis = outOfRange.getOrDefault(sensor, 0L);
+            ConsoleUtils.println(LOG + "   " + sensor + ": " + formatDuration(millis)
+                    + String.format(" (%.1f%%)", span == 0 ? 0.0 : 100.0 * millis / span));
+        }
+
+        List<String> lines = new ArrayList<>();
+        lines.add("time,actuator,state");
+        lines.addAll(actuators.getCommandLog());
+        Files.write(commandsOut, lines, StandardCharsets.UTF_8);
+        ConsoleUtils.println(LOG + " Commands written to " + commandsOut);
+    }
+
+    private static boolean inRange(String sensor, float value) {
+        return switch (sensor) {
+            case "temperature" -> value >= ControlRules.TEMP_LOWER && value <= ControlRules.TEMP_UPPER;
+            case "pH" -> value >= ControlRules.PH_LOWER && value <= ControlRules.PH_UPPER;
+            case "soilMoisture" -> value >= ControlRules.MOISTURE_LOWER && value <= ControlRules.MOISTURE_UPPER;
+            case "light" -> value >= ControlRules.LIGHT_LOWER;
+            default -> true;
+        };
+    }
+
+    private static String formatDuration(long millis) {
+        long s = millis / 1000;
+        return String.format("%dd %02dh %02dm %02ds", s / 86400, (s / 3600) % 24, (s / 60) % 60, s % 60);
+    }
+}
@@ -0,0 +1,42 @@
+package org.unipi.smartgarden.replay;
+
+import java.time.Clock;
+import java.time.Instant;
+import java.time.ZoneId;
+import java.time.ZoneOffset;
+
+/**
+ * VirtualClock - Clock that only moves when the replay engine sets it.
+ */
+public class VirtualClock extends Clock {
+
+    private volatile long millis;
+
+    public VirtualClock(long startMillis) {
+        this.millis = startMillis;
+    }
+
+    public void set(long millis) {
+        this.millis = millis;
+    }
+
+    @Override
+    public long millis() {
+        return millis;
+    }
+
+    @Override
+    public Instant instant() {
+        return Instant.ofEpochMilli(millis);
+    }
+
+    @Override
+    public ZoneId getZone() {
+        return ZoneOffset.UTC;
+    }
+
+    @Override
+    public Clock withZone(ZoneId zone) {
+        throw new UnsupportedOperationException("VirtualClock is UTC only");
+    }
+}
@@ -0,0 +1,157 @@
+package org.unipi.smartgarden.snapshot;
+
+import com.google.gson.Gson;
+import org.unipi.smartgarden.coap.ActuatorEndpoint;
+import org.unipi.smartgarden.coap.COAPNetworkController;
+import org.unipi.smartgarden.control.ActuatorCommandBus;
+import org.unipi.smartgarden.control.ControlLogicThread;
+import org.unipi.smartgarden.mqtt.MQTTHandler;
+import org.unipi.smartgarden.util.ConsoleUtils;
+
+import java.io.IOException;
+import java.io.Reader;
+import java.io.Writer;
+import java.nio.charset.StandardCharsets;
+import java.nio.file.Files;
+import java.nio.file.Path;
+import java.nio.file.StandardCopyOption;
+import java.util.ArrayList;
+import java.util.List;
+import java.util.Map;
+import java.util.concurrent.Executors;
+import java.util.concurrent.ScheduledExecutorService;
+import java.util.concurrent.TimeUnit;
+
+/**
+ * SnapshotManager - Periodically writes the warm state of the backend (latest
+ * sensor values, actuator states, modes, registered endpoints) to a small JSON
+ * file, and restores it at startup so control resumes on the first pass
+ * instead of waiting for new samples and registrations.
+ */
+public class SnapshotManager {
+
+    private static final String LOG = "[Snapshot]";
+    private static final long SAVE_INTERVAL_S = 30;
+    // older sensor values are not trusted to drive actuators after a restart
+    private static final long MAX_SAMPLE_AGE_MS = 15 * 60_000;
+
+    private final Path file;
+    private final MQTTHandler mqttHandler;
+    private final COAPNetworkController coapController;
+    private final ActuatorCommandBus commandBus;
+    private final ControlLogicThread controlLogic;
+    private final Gson gson = new Gson();
+
+    private final ScheduledExecutorService scheduler = Executors.newSingleThreadScheduledExecutor(r -> {
+        Thread t = new Thread(r, "snapshot");
+        t.setDaemon(true);
+        return t;
+    });
+
+    public SnapshotManager(String fileName, MQTTHandler mqttHandler, COAPNetworkController coapController,
+                           ActuatorCommandBus commandBus, ControlLogicThread controlLogic) {
+        this.file = Path.of(fileName);
+        this.mqttHandler = mqttHandler;
+        this.coapController = coapController;
+        this.commandBus = commandBus;
+        this.controlLogic = controlLogic;
+    }
+
+    /**
+     * Loads the last snapshot, if any, into the running components. Returns
+     * true when actuator endpoints were restored, i.e. commands can be sent
+     * without waiting for the nodes to register again.
+     */
+    public boolean restore() {
+        if (!Files.exists(file)) {
+            ConsoleUtils.println(LOG + " No snapshot found, cold start.");
+            return false;
+        }
+
+        StateSnapshot snapshot;
+        try (Reader reader = Files.newBufferedReader(file, StandardCharsets.UTF_8)) {
+            snapshot = gson.fromJson(reader, StateSnapshot.class);
+        } catch (Exception e) {
+            ConsoleUtils.printError(LOG + " Cannot read " + file + ", cold start: " + e.getMessage());
+            return false;
+        }
+        if (snapshot == null) return false;
+
+        long age = System.currentTimeMillis() - snapshot.getSavedAt();
+        ConsoleUtils.println(LOG + " Restoring snapshot taken " + age / 1000 + " s ago");
+
+        for (Map.Entry<String, Integer> entry : snapshot.getOscoreIds().entrySet()) {
+            coapController.bindOscore(entry.getKey(), entry.getValue());
+        }
+        for (StateSnapshot.Registration registration : snapshot.getRegistrations()) {
+            coapController.registerActuator(registration.getActuator(), registration.getUri(), registration.getZone());
+        }
+        for (Map.Entry<String, String> entry : snapshot.getEndpoints().entrySet()) {
+            coapController.registerActuator(entry.getKey(), entry.getValue());
+        }
+        // a node may be gone or at another address by now
+        coapController.probeNodes();
+        for (Map.Entry<String, String> entry : snapshot.getActuatorStates().entrySet()) {
+            commandBus.restoreState(entry.getKey(), entry.getValue());
+        }
+        if (age <= MAX_SAMPLE_AGE_MS) {
+            for (Map.Entry<String, Float> entry : snapshot.getSensorValues().entrySet()) {
+                mqttHandler.restoreLatestValue(entry.getKey(), entry.getValue());
+            }
+        } else {
+            ConsoleUtils.println(LOG + " Sensor values too old, waiting for fresh samples.");
+        }
+        controlLogic.restoreModes(snapshot.getManualOverrides(),
+                snapshot.isGrowLightManualMode(), snapshot.isGrowLightOn());
+
+        return coapController.getRegistry().size() > 0;
+    }
+
+    public void start() {
+        scheduler.scheduleWithFixedDelay(this::save, SAVE_INTERVAL_S, SAVE_INTERVAL_S, TimeUnit.SECONDS);
+    }
+
+    /**
+     * Writes the current state. The file is replaced atomically, so a crash
+     * during the write leaves the previous snapshot intact.
+     */
+    public void save() {
+        StateSnapshot snapshot = new StateSnapshot();
+        snapshot.setSavedAt(System.currentTimeMillis());
+        snapshot.setSensorValues(mqttHandler.getLatestValues());
+        snapshot.setActuatorStates(commandBus.getKnownStates());
+        List<StateSnapshot.Registration> registrations = new ArrayList<>();
+        for (ActuatorEndpoint endpoint : coapController.getRegistry().all()) {
+            registrations.add(new StateSnapshot.Registration(endpoint.getActuator(), endpoint.getUri(), endpoint.getZone()));
+        }
+        snapshot.setRegistrations(registrations);
+        snapshot.setOscoreIds(coapController.getOscoreBindings());
+        snapshot.setManualOverrides(controlLogic.getManualOverrides());
+        snapshot.setGrowLightManualMode(controlLogic.isGrowLightManual());
+        snapshot.setGrowLightOn(controlLogic.isGrowLightOn());
+
+        Path tmp = file.resolveSibling(file.getFileName() + ".tmp");
+        try {
+            try (Writer writer = Files.newBufferedWriter(tmp, StandardCharsets.UTF_8)) {
+                gson.toJson(snapshot, writer);
+            }
+            Files.move(tmp, file, StandardCopyOption.REPLACE_EXISTING, StandardCopyOption.ATOMIC_MOVE);
+            ConsoleUtils.debug(LOG + " Snapshot written to " + file);
+        } catch (IOException e) {
+            ConsoleUtils.printError(LOG + " Failed to write snapshot: " + e.getMessage());
+        }
+    }
+
+    /**
+     * Stops the periodic writes and takes a last snapshot.
+     */
+    public void close() {
+        scheduler.shutdown();
+        try {
+            scheduler.awaitTermination(2, TimeUnit.SECONDS);
+        } catch (InterruptedException e) {
+            Thread.currentThread().interrupt();
+        }
+        save();
+    }
+}
@@ -0,0 +1,131 @@
+package org.unipi.smartgarden.snapshot;
+
+import java.util.ArrayList;
+import java.util.HashMap;
+import java.util.List;
+import java.util.Map;
+
+/**
+ * StateSnapshot - What the backend needs to resume control right after a
+ * restart, serialized with Gson.
+ */
+public class StateSnapshot {
+
+    private long savedAt;
+    private Map<String, Float> sensorValues = new HashMap<>();     // sensorName -> last value
+    private Map<String, String> actuatorStates = new HashMap<>();  // actuator -> on/off/acidic/...
+    private Map<String, String> endpoints = new HashMap<>();       // actuator -> resource URI, older snapshots
+    private List<Registration> registrations = new ArrayList<>();  // every node resource
+    private Map<String, Integer> oscoreIds = new HashMap<>();      // node (host:port) -> OSCORE id
+    private Map<String, Boolean> manualOverrides = new HashMap<>();
+    private boolean growLightManualMode;
+    private boolean growLightOn;
+
+    public StateSnapshot() {
+        // required by Gson
+    }
+
+    public long getSavedAt() {
+        return savedAt;
+    }
+
+    public void setSavedAt(long savedAt) {
+        this.savedAt = savedAt;
+    }
+
+    public Map<String, Float> getSensorValues() {
+        return sensorValues;
+    }
+
+    public void setSensorValues(Map<String, Float> sensorValues) {
+        this.sensorValues = sensorValues;
+    }
+
+    public Map<String, String> getActuatorStates() {
+        return actuatorStates;
+    }
+
+    public void setActuatorStates(Map<String, String> actuatorStates) {
+        this.actuatorStates = actuatorStates;
+    }
+
+    public Map<String, String> getEndpoints() {
+        return endpoints;
+    }
+
+    public void setEndpoints(Map<String, String> endpoints) {
+        this.endpoints = endpoints;
+    }
+
+    public List<Registration> getRegistrations() {
+        return registrations;
+    }
+
+    public void setRegistrations(List<Registration> registrations) {
+        this.registrations = registrations;
+    }
+
+    public Map<String, Integer> getOscoreIds() {
+        return oscoreIds;
+    }
+
+    public void setOscoreIds(Map<String, Integer> oscoreIds) {
+        this.oscoreIds = oscoreIds;
+    }
+
+    public Map<String, Boolean> getManualOverrides() {
+        return manualOverrides;
+    }
+
+    public void setManualOverrides(Map<String, Boolean> manualOverrides) {
+        this.manualOverrides = manualOverrides;
+    }
+
+    public boolean isGrowLightManualMode() {
+        return growLightManualMode;
+    }
+
+    public void setGrowLightManualMode(boolean growLightManualMode) {
+        this.growLightManualMode = growLightManualMode;
+    }
+
+    public boolean isGrowLightOn() {
+        return growLightOn;
+    }
+
+    public void setGrowLightOn(boolean growLightOn) {
+        this.growLightOn = growLightOn;
+    }
+
+    /**
+     * An actuator resource of a node, as registered.
+     */
+    public static class Registration {
+
+        private String actuator;
+        private String uri;
+        private int zone;
+
+        public Registration() {
+            // required by Gson
+        }
+
+        public Registration(String actuator, String uri, int zone) {
+            this.actuator = actuator;
+            this.uri = uri;
+            this.zone = zone;
+        }
+
+        public String getActuator() {
+            return actuator;
+        }
+
+        public String getUri() {
+            return uri;
+        }
+
+        public int getZone() {
+            return zone;
+        }
+    }
+}
@@ -0,0 +1,275 @@
+package org.unipi.smartgarden.util;
+
+import java.io.BufferedWriter;
+import java.io.File;
+import java.io.FileOutputStream;
+import java.io.IOException;
+import java.io.OutputStreamWriter;
+import java.io.PrintStream;
+import java.nio.charset.StandardCharsets;
+import java.time.Instant;
+import java.time.ZoneId;
+import java.time.format.DateTimeFormatter;
+import java.util.concurrent.atomic.AtomicLong;
+import java.util.concurrent.atomic.AtomicLongArray;
+import java.util.concurrent.locks.LockSupport;
+
+/**
+ * AsyncLogger - Log records are put in a bounded lock-free ring buffer by the
+ * calling threads and written to the console and to a rotating log file by a
+ * single background thread. Callers never block: when the buffer is full the
+ * record is dropped and counted.
+ */
+public class AsyncLogger {
+
+    public enum Level { DEBUG, INFO, WARN, ERROR }
+
+    private static final int CAPACITY = 8192;            // power of two
+    private static final long MAX_FILE_BYTES = 10L * 1024 * 1024;
+    private static final int MAX_ROTATED_FILES = 5;      // smartgarden.log.1 .. .5
+    private static final long IDLE_PARK_NANOS = 10_000_000L;
+    private static final int NEWLINE_BYTES = System.lineSeparator().length();
+
+    private static final DateTimeFormatter TIMESTAMP =
+            DateTimeFormatter.ofPattern("yyyy-MM-dd HH:mm:ss").withZone(ZoneId.systemDefault());
+
+    private static class Record {
+        final long time;
+        final Level level;
+        final String message;
+        final boolean console;
+        final boolean newline;
+
+        Record(long time, Level level, String message, boolean console, boolean newline) {
+            this.time = time;
+            this.level = level;
+            this.message = message;
+            this.console = console;
+            this.newline = newline;
+        }
+    }
+
+    // Bounded multi-producer / single-consumer ring: a slot is free for position p
+    // when its sequence is p, and holds a record for p when its sequence is p + 1.
+    private final Record[] slots = new Record[CAPACITY];
+    private final AtomicLongArray sequences = new AtomicLongArray(CAPACITY);
+    private final AtomicLong tail = new AtomicLong();
+    private long head = 0; // consumer only
+
+    private final AtomicLong dropped = new AtomicLong();
+
+    private final File logFile;
+    private final PrintStream console;
+    private BufferedWriter fileOut;  // drainer thread only
+    private long fileBytes;          // drainer thread only, UTF-8 bytes written
+
+    // drainer thread only: timestamp formatted once per second
+    private long cachedSecond = -1;
+    private String cachedTimestamp;
+
+    private final Thread drainer;
+    private volatile boolean running = true;
+    private volatile boolean idle = false;
+
+    public AsyncLogger(String fileName, PrintStream console) {
+        this.logFile = new File(fileName);
+        this.console = console;
+
+        for (int i = 0; i < CAPACITY; i++) {
+            sequences.set(i, i);
+        }
+
+        openFile();
+
+        drainer = new Thread(this::drain, "async-logger");
+        drainer.setDaemon(true);
+        drainer.start();
+    }
+
+    /**
+     * Queues a record. Returns false (and counts a drop) if the ring is full or
+     * the logger is closed.
+     */
+    public boolean log(Level level, String message, boolean toConsole, boolean newline) {
+        if (!running) return false;
+
+        Record record = new Record(System.currentTimeMillis(), level, message, toConsole, newline);
+
+        long pos = tail.get();
+        while (true) {
+            int index = (int) (pos & (CAPACITY - 1));
+            long diff = sequences.get(index) - pos;
+            if (diff == 0) {
+                if (tail.compareAndSet(pos, pos + 1)) {
+                    slots[index] = record;
+                    sequences.set(index, pos + 1);
+                    break;
+                }
+                pos = tail.get();
+            } else if (diff < 0) {
+                dropped.incrementAndGet();
+                return false;
+            } else {
+                pos = tail.get();
+            }
+        }
+
+        if (idle) {
+            LockSupport.unpark(drainer);
+        }
+        return true;
+    }
+
+    public long getDroppedCount() {
+        return dropped.get();
+    }
+
+    /**
+     * Writes every queued record and stops the background thread.
+     */
+    public void close() {
+        running = false;
+        LockSupport.unpark(drainer);
+        try {
+            drainer.join(2000);
+        } catch (InterruptedException e) {
+            Thread.currentThread().interrupt();
+        }
+    }
+
+    private boolean hasNext() {
+        int index = (int) (head & (CAPACITY - 1));
+        return sequences.get(index) == head + 1;
+    }
+
+    private Record poll() {
+        if (!hasNext()) return null;
+
+        int index = (int) (head & (CAPACITY - 1));
+        Record record = slots[index];
+        slots[index] = null;
+        sequences.set(index, head + CAPACITY);
+        head++;
+        return record;
+    }
+
+    private void drain() {
+        while (true) {
+            Record record = poll();
+            if (record != null) {
+                write(record);
+                continue;
+            }
+
+            // nothing queued: flush what was written, then sleep until woken up
+            flush();
+            if (!running) break;
+
+            // re-check after publishing idle, so a producer that missed the flag is not left waiting
+            idle = true;
+            if (!hasNext() && running) {
+                LockSupport.parkNanos(IDLE_PARK_NANOS);
+            }
+            idle = false;
+        }
+
+        if (fileOut != null) {
+            try {
+                fileOut.close();
+            } catch (IOException e) {
+                console.println("Warning: Unable to close log file: " + e.getMessage());
+            }
+        }
+    }
+
+    private void write(Record record) {
+        if (record.console) {
+            if (record.newline) {
+                console.println(record.message);
+            } else {
+                console.print(record.message);
+                console.flush();
+            }
+        }
+
+        if (fileOut == null) return;
+
+        String line = "[" + timestamp(record.time) + "] [" + record.level + "] " + record.message;
+        try {
+            fileOut.write(line);
+            fileOut.newLine();
+            fileBytes += utf8Length(line) + NEWLINE_BYTES;
+            if (fileBytes >= MAX_FILE_BYTES) {
+                rotate();
+            }
+        } catch (IOException e) {
+            console.println("Warning: Unable to write log file, file logging disabled: " + e.getMessage());
+            fileOut = null;
+        }
+    }
+
+    // encoded size of the line, counted without encoding it a second time
+    private static int utf8Length(String s) {
+        int bytes = 0;
+        for (int i = 0; i < s.length(); i++) {
+            char c = s.charAt(i);
+            if (c < 0x80) {
+                bytes++;
+            } else if (c < 0x800) {
+                bytes += 2;
+            } else if (Character.isHighSurrogate(c) && i + 1 < s.length() && Character.isLowSurrogate(s.charAt(i + 1))) {
+                bytes += 4;
+                i++;
+            } else {
+                bytes += 3;
+            }
+        }
+        return bytes;
+    }
+
+    private String timestamp(long millis) {
+        long second = millis / 1000;
+        if (second != cachedSecond) {
+            cachedSecond = second;
+            cachedTimestamp = TIMESTAMP.format(Instant.ofEpochSecond(second));
+        }
+        return cachedTimestamp;
+    }
+
+    private void flush() {
+        if (fileOut == null) return;
+        try {
+            fileOut.flush();
+        } catch (IOException e) {
+            console.println("Warning: Unable to flush log file: " + e.getMessage());
+        }
+    }
+
+    private void openFile() {
+        try {
+            fileOut = new BufferedWriter(new OutputStreamWriter(
+                    new FileOutputStream(logFile, true), StandardCharsets.UTF_8));
+            fileBytes = logFile.length();
+        } catch (IOException e) {
+            console.println("Warning: Unable to enable file logging.");
+            fileOut = null;
+        }
+    }
+
+    // smartgarden.log -> .1 -> .2 ... the oldest one is deleted
+    private void rotate() throws IOException {
+        fileOut.close();
+
+        String base = logFile.getPath();
+        new File(base + "." + MAX_ROTATED_FILES).delete();
+        for (int i = MAX_ROTATED_FILES - 1; i >= 1; i--) {
+            File from = new File(base + "." + i);
+            if (from.exists()) {
+                from.renameTo(new File(base + "." + (i + 1)));
+            }
+        }
+        logFile.renameTo(new File(base + ".1"));
+
+        openFile();
+    }
+}
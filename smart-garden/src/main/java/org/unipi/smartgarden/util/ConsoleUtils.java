@@ -1,71 +1,69 @@
 package org.unipi.smartgarden.util;
 
-import java.io.PrintStream;
-import java.io.FileNotFoundException;
-import java.io.FileOutputStream;
-import java.time.LocalDateTime;
-import java.time.format.DateTimeFormatter;
+import org.unipi.smartgarden.util.AsyncLogger.Level;
 
 public class ConsoleUtils {
 
     private static volatile boolean typing = false;
-    private static final Object lock = new Object();
-
-    private static boolean fileLoggingEnabled = false;
-    private static PrintStream fileOut;
-
-    static {
-        try {
-            fileOut = new PrintStream(new FileOutputStream("smartgarden.log", true));
-            fileLoggingEnabled = true;
-        } catch (FileNotFoundException e) {
-            System.err.println("Warning: Unable to enable file logging.");
-            fileLoggingEnabled = false;
-        }
-    }
+
+    // messages below this level only go to the log file
+    private static volatile Level consoleLevel = Level.DEBUG;
+
+    private static final AsyncLogger logger = new AsyncLogger("smartgarden.log", System.out);
+    private static volatile boolean closed = false;
 
     public static void setTyping(boolean state) {
-        synchronized (lock) {
-            typing = state;
-        }
+        typing = state;
+    }
+
+    public static void setConsoleLevel(Level level) {
+        consoleLevel = level;
+    }
+
+    public static Level getConsoleLevel() {
+        return consoleLevel;
     }
 
     public static void println(String msg) {
-        synchronized (lock) {
-            if (!typing) {
-                System.out.println(msg);
-            }
-            if (fileLoggingEnabled) {
-                logToFile(msg);
-            }
-        }
+        log(Level.INFO, msg, true);
     }
 
     public static void print(String msg) {
-        synchronized (lock) {
-            if (!typing) {
-                System.out.print(msg);
-            }
-            if (fileLoggingEnabled) {
-                logToFile(msg);
-            }
-        }
+        log(Level.INFO, msg, false);
+    }
+
+    /**
+     * Per-message chatter (every sample, every command). Always written to the
+     * log file, shown on the console only when the console level allows it.
+     */
+    public static void debug(String msg) {
+        log(Level.DEBUG, msg, true);
     }
 
     public static void printError(String msg) {
-        println("\u001B[31m" + msg + "\u001B[0m");
+        log(Level.ERROR, "\u001B[31m" + msg + "\u001B[0m", true);
     }
 
-    private static void logToFile(String msg) {
-        String timestamp = LocalDateTime.now().format(DateTimeFormatter.ofPattern("yyyy-MM-dd HH:mm:ss"));
-        fileOut.println("[" + timestamp + "] " + msg);
+    public static long getDroppedCount() {
+        return logger.getDroppedCount();
     }
 
-    public static void closeLogger() {
-        if (fileOut != null) {
-            fileOut.close();
+    private static void log(Level level, String msg, boolean newline) {
+        // decide now: the typing flag may change before the record is written
+        boolean toConsole = !typing && level.compareTo(consoleLevel) >= 0;
+
+        if (closed) {
+            if (toConsole) {
+                if (newline) System.out.println(msg);
+                else System.out.print(msg);
+            }
+            return;
         }
+        logger.log(level, msg, toConsole, newline);
     }
-}
-
 
+    public static void closeLogger() {
+        closed = true;
+        logger.close();
+    }
+}